@@ -0,0 +1,172 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "wait_strategy.hpp"
+
+namespace conflation
+{
+
+const int DEPTH_LEVELS = 5;
+
+struct PriceLevel {
+    double price;
+    int quantity;
+};
+
+// Latest known state of one instrument: BBO plus the first DEPTH_LEVELS of each side
+struct MarketSnapshot {
+    uint32_t symbol_id;
+    int bid_levels;
+    int offer_levels;
+    PriceLevel bids[DEPTH_LEVELS];
+    PriceLevel offers[DEPTH_LEVELS];
+
+    PriceLevel best_bid() const { return bids[0]; }
+    PriceLevel best_offer() const { return offers[0]; }
+};
+
+struct ConsumerMetrics {
+    uint64_t delivered;   // snapshots handed to the consumer
+    uint64_t conflated;   // intermediate updates the consumer never saw
+};
+
+// Single writer, many readers. The writer overwrites the per-symbol slot and flags it
+// as dirty for every consumer; it never waits on them. Each consumer drains its own dirty
+// set whenever it wants, so a slow consumer only skips intermediate versions of a symbol.
+class ConflationBuffer {
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> seq{0}; // seqlock: odd while the writer is copying
+        MarketSnapshot snapshot;
+    };
+
+    struct alignas(64) Consumer {
+        std::unique_ptr<std::atomic<uint64_t>[]> dirty; // one bit per symbol, set by the writer
+        std::vector<uint64_t> last_version;              // private to the consumer thread
+        std::atomic<uint64_t> delivered{0};
+        std::atomic<uint64_t> conflated{0};
+    };
+
+    int num_symbols;
+    int dirty_words;
+    std::unique_ptr<Slot[]> slots;
+    std::unique_ptr<Consumer[]> consumers;
+    int max_consumers;
+    std::atomic<int> num_consumers{0};
+    wait::WakeSignal updates;
+
+    bool read_slot(uint32_t symbol_id, MarketSnapshot& out, uint64_t& version) const {
+        const Slot& slot = slots[symbol_id];
+        while (true) {
+            uint64_t before = slot.seq.load(std::memory_order_acquire);
+            if (before & 1)
+                continue; // writer in progress
+            std::memcpy(&out, &slot.snapshot, sizeof(MarketSnapshot));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) == before) {
+                version = before / 2;
+                return version != 0;
+            }
+        }
+    }
+
+public:
+    ConflationBuffer(int num_symbols, int max_consumers)
+        : num_symbols(num_symbols), dirty_words((num_symbols + 63) / 64),
+          slots(new Slot[num_symbols]), consumers(new Consumer[max_consumers]),
+          max_consumers(max_consumers) {
+        for (int i = 0; i < max_consumers; ++i) {
+            consumers[i].dirty.reset(new std::atomic<uint64_t>[dirty_words]);
+            for (int w = 0; w < dirty_words; ++w)
+                consumers[i].dirty[w].store(0, std::memory_order_relaxed);
+            consumers[i].last_version.assign(num_symbols, 0);
+        }
+    }
+
+    // Returns the consumer id to pass to drain(), or -1 when all consumer slots are taken.
+    // The consumer starts at the versions published so far: what it missed before joining
+    // is not counted as conflated. Call it from the consumer's thread, or before it starts.
+    int register_consumer() {
+        int id = num_consumers.load(std::memory_order_relaxed);
+        while (id < max_consumers) {
+            if (num_consumers.compare_exchange_weak(id, id + 1, std::memory_order_acq_rel)) {
+                std::vector<uint64_t>& last_version = consumers[id].last_version;
+                for (int symbol = 0; symbol < num_symbols; ++symbol)
+                    last_version[symbol] = slots[symbol].seq.load(std::memory_order_acquire) / 2;
+                return id;
+            }
+        }
+        return -1;
+    }
+
+    // Book writer side: never blocks, cost is one copy plus one fetch_or per consumer
+    void publish(const MarketSnapshot& snapshot) {
+        uint32_t symbol_id = snapshot.symbol_id;
+        if (symbol_id >= static_cast<uint32_t>(num_symbols))
+            return;
+        Slot& slot = slots[symbol_id];
+        uint64_t seq = slot.seq.load(std::memory_order_relaxed);
+        slot.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(&slot.snapshot, &snapshot, sizeof(MarketSnapshot));
+        slot.seq.store(seq + 2, std::memory_order_release);
+
+        uint64_t bit = 1ULL << (symbol_id & 63);
+        int count = num_consumers.load(std::memory_order_acquire);
+        for (int i = 0; i < count; ++i)
+            consumers[i].dirty[symbol_id >> 6].fetch_or(bit, std::memory_order_release);
+        updates.notify();
+    }
+
+    // Consumer side: calls on_update(const MarketSnapshot&) once per symbol that changed
+    // since the previous drain, with its latest state. Returns the number of snapshots delivered.
+    template <typename Callback>
+    size_t drain(int consumer_id, Callback&& on_update) {
+        Consumer& consumer = consumers[consumer_id];
+        MarketSnapshot snapshot;
+        size_t delivered = 0;
+        uint64_t conflated = 0;
+        for (int w = 0; w < dirty_words; ++w) {
+            if (consumer.dirty[w].load(std::memory_order_relaxed) == 0)
+                continue;
+            uint64_t bits = consumer.dirty[w].exchange(0, std::memory_order_acquire);
+            while (bits) {
+                uint32_t symbol_id = (w << 6) + __builtin_ctzll(bits);
+                bits &= bits - 1;
+                uint64_t version;
+                if (!read_slot(symbol_id, snapshot, version))
+                    continue;
+                uint64_t& last = consumer.last_version[symbol_id];
+                if (version <= last)
+                    continue; // already seen through an earlier dirty flag
+                conflated += version - last - 1;
+                last = version;
+                on_update(snapshot);
+                ++delivered;
+            }
+        }
+        if (delivered) {
+            // release: whoever reads the count in metrics() also sees what on_update did
+            consumer.delivered.fetch_add(delivered, std::memory_order_release);
+            consumer.conflated.fetch_add(conflated, std::memory_order_relaxed);
+        }
+        return delivered;
+    }
+
+    ConsumerMetrics metrics(int consumer_id) const {
+        const Consumer& consumer = consumers[consumer_id];
+        return ConsumerMetrics{consumer.delivered.load(std::memory_order_acquire),
+                               consumer.conflated.load(std::memory_order_relaxed)};
+    }
+
+    // Consumers that run out of work can park on this until the next publish()
+    wait::WakeSignal& wake_signal() { return updates; }
+
+    int consumer_count() const { return num_consumers.load(std::memory_order_acquire); }
+    int symbol_count() const { return num_symbols; }
+};
+
+} // namespace conflation
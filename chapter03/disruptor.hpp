@@ -0,0 +1,150 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "wait_strategy.hpp"
+
+// LMAX Disruptor style ring: one preallocated array of events shared by every stage of a
+// pipeline. The producer claims a slot, fills it in place and publishes its sequence; each
+// stage waits on a barrier (the sequences of the stages it depends on), processes every
+// available event as a batch and then advances its own sequence. No per-stage queues, no
+// copies: downstream stages read what upstream stages wrote into the same slot.
+namespace disruptor
+{
+
+const int64_t INITIAL_SEQUENCE = -1;
+
+struct alignas(64) Sequence {
+    std::atomic<int64_t> value{INITIAL_SEQUENCE};
+
+    int64_t get() const { return value.load(std::memory_order_acquire); }
+    void set(int64_t sequence) { value.store(sequence, std::memory_order_release); }
+};
+
+inline int64_t min_sequence(const std::vector<const Sequence*>& sequences, int64_t minimum) {
+    for (const Sequence* sequence : sequences)
+        minimum = std::min(minimum, sequence->get());
+    return minimum;
+}
+
+// Single producer ring. Gating sequences are the stages at the end of the pipeline: the
+// producer never laps the slowest of them.
+template <typename T>
+class RingBuffer {
+private:
+    int64_t mask;
+    std::unique_ptr<T[]> events;
+    Sequence cursor_sequence;
+    std::vector<const Sequence*> gating;
+    int64_t next_sequence = INITIAL_SEQUENCE; // producer-private
+    int64_t cached_gating = INITIAL_SEQUENCE;
+    wait::WakeSignal published;
+
+public:
+    explicit RingBuffer(size_t capacity) : mask(static_cast<int64_t>(capacity) - 1), events(new T[capacity]) {
+        if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+            throw std::invalid_argument("ring capacity must be a power of two");
+    }
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    void add_gating_sequence(const Sequence& sequence) { gating.push_back(&sequence); }
+
+    // Claims the next slot, spinning while the ring is full
+    int64_t next() {
+        int64_t sequence = ++next_sequence;
+        int64_t wrap_point = sequence - (mask + 1);
+        if (wrap_point > cached_gating) {
+            while (wrap_point > (cached_gating = min_sequence(gating, sequence)))
+                wait::cpu_relax();
+        }
+        return sequence;
+    }
+
+    // Claims the next slot, or returns false when that would lap the slowest stage
+    bool try_next(int64_t& sequence) {
+        int64_t wrap_point = next_sequence + 1 - (mask + 1);
+        if (wrap_point > cached_gating && wrap_point > (cached_gating = min_sequence(gating, next_sequence + 1)))
+            return false;
+        sequence = ++next_sequence;
+        return true;
+    }
+
+    T& operator[](int64_t sequence) { return events[sequence & mask]; }
+    const T& operator[](int64_t sequence) const { return events[sequence & mask]; }
+
+    void publish(int64_t sequence) {
+        cursor_sequence.set(sequence);
+        published.notify();
+    }
+
+    const Sequence& cursor() const { return cursor_sequence; }
+    // Bumped on every publish and every stage advance, for stages that park
+    wait::WakeSignal& signal() { return published; }
+    size_t capacity() const { return static_cast<size_t>(mask + 1); }
+};
+
+// What a stage waits on: the producer cursor for the first stage, upstream stages otherwise
+class SequenceBarrier {
+private:
+    std::vector<const Sequence*> dependencies;
+    wait::WakeSignal& signal;
+    const std::atomic<bool>& running;
+
+public:
+    SequenceBarrier(std::vector<const Sequence*> dependencies, wait::WakeSignal& signal,
+                    const std::atomic<bool>& running)
+        : dependencies(std::move(dependencies)), signal(signal), running(running) {}
+
+    // Highest sequence available to the stage (possibly beyond `sequence`, which makes a
+    // batch), or INITIAL_SEQUENCE - 1 once the pipeline is halted
+    int64_t wait_for(int64_t sequence, const wait::WaitStrategy& waiter) const {
+        int64_t available = INITIAL_SEQUENCE;
+        waiter.wait_until([&]() {
+            available = min_sequence(dependencies, std::numeric_limits<int64_t>::max());
+            return available >= sequence || !running.load(std::memory_order_relaxed);
+        }, &signal);
+        return available >= sequence ? available : INITIAL_SEQUENCE - 1;
+    }
+};
+
+// Runs one stage: handler.on_event(T& event, int64_t sequence, bool end_of_batch) for every
+// event the barrier makes available, then publishes the stage's own sequence once per batch.
+template <typename T, typename Handler>
+class BatchEventProcessor {
+private:
+    RingBuffer<T>& ring;
+    SequenceBarrier barrier;
+    Handler& handler;
+    wait::WaitStrategy waiter;
+    Sequence position;
+
+public:
+    BatchEventProcessor(RingBuffer<T>& ring, std::vector<const Sequence*> dependencies, Handler& handler,
+                        const std::atomic<bool>& running, wait::WaitStrategy waiter = wait::WaitStrategy())
+        : ring(ring), barrier(std::move(dependencies), ring.signal(), running), handler(handler), waiter(waiter) {}
+    BatchEventProcessor(const BatchEventProcessor&) = delete;
+    BatchEventProcessor& operator=(const BatchEventProcessor&) = delete;
+
+    const Sequence& sequence() const { return position; }
+
+    // Returns once the pipeline is halted
+    void run() {
+        int64_t next = position.get() + 1;
+        while (true) {
+            int64_t available = barrier.wait_for(next, waiter);
+            if (available < INITIAL_SEQUENCE)
+                return;
+            for (; next <= available; next++)
+                handler.on_event(ring[next], next, next == available);
+            position.set(available);
+            ring.signal().notify();
+        }
+    }
+};
+
+} // namespace disruptor
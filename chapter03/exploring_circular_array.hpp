@@ -3,6 +3,7 @@
 #include <cmath>
 #include <algorithm>
 #include <iostream>
+#include "latency_tracer.hpp"
 
 namespace circular_array
 {
@@ -240,39 +241,45 @@ public:
         step_value = std::pow(10, precision);
     }
 
-    virtual void add_order(const Order& order, bool is_bid) {        
+    // add/update/delete return false when the price falls outside the book and is discarded
+    virtual bool add_order(const Order& order, bool is_bid) {        
+        TRACE_SCOPE(latency::Stage::BOOK_ADD_ORDER);
         if (is_bid) {
             int index = price_to_index(order.price, true);
             if (index > -1)
                 bids[index] = order;
+            return index > -1;
         } else {
             int index = price_to_index(order.price, false);
             if (index > -1)
                 offers[index] = order;
+            return index > -1;
         }
     }
 
 
-    void update_order(const Order& order, bool is_bid) {
+    virtual bool update_order(const Order& order, bool is_bid) {
         int index = price_to_index(order.price, is_bid);
         if (index == -1)
-            return; 
+            return false; 
         if (is_bid) {
             bids[index] = order;
         } else {
             offers[index] = order;
         }
+        return true;
     }
 
-    void delete_order(const Order& order, bool is_bid) {
+    virtual bool delete_order(const Order& order, bool is_bid) {
         int index = price_to_index(order.price, is_bid);
         if (index == -1)
-            return; 
+            return false; 
         if (is_bid) {
             bids[index] = Order();
         } else {
             offers[index] = Order();
         }
+        return true;
     }
 
     virtual Order get_best_bid() {
@@ -290,6 +297,25 @@ public:
         return *ptr_offer_end;
     }
 
+    // Copies up to max_levels non-empty levels, best price first. Returns how many were copied.
+    int get_depth(bool is_bid, Order* levels, int max_levels) {
+        Order* best = is_bid ? ptr_bid_end : ptr_offer_ini;
+        Order* worst = is_bid ? ptr_bid_ini : ptr_offer_end;
+        if (best == nullptr)
+            return 0;
+        std::vector<Order>& side = is_bid ? bids : offers;
+        int index = best - &side[0];
+        int count = 0;
+        for (int visited = 0; visited < depth && count < max_levels; visited++) {
+            if (side[index].quantity > 0)
+                levels[count++] = side[index];
+            if (&side[index] == worst)
+                break;
+            index = is_bid ? (index - 1 + depth) % depth : (index + 1) % depth;
+        }
+        return count;
+    }
+
     void print_bids()
     {
         for (int i=0; i<bids.size(); i++)
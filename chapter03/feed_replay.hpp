@@ -0,0 +1,290 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "latency_histogram.hpp"
+
+namespace replay
+{
+
+struct CapturedMessage {
+    uint64_t timestamp_ns; // capture time
+    const char* data;      // points into the mapped capture, valid while the reader lives
+    uint32_t length;
+};
+
+// Read-only mapping of a whole capture file: readers hand out views, nothing is copied
+class MappedFile {
+private:
+    const char* base = nullptr;
+    size_t file_size = 0;
+
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("cannot open " + path);
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("cannot stat " + path);
+        }
+        file_size = st.st_size;
+        if (file_size > 0) {
+            void* p = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("cannot mmap " + path);
+            }
+            madvise(p, file_size, MADV_SEQUENTIAL);
+            base = static_cast<const char*>(p);
+        }
+        ::close(fd);
+    }
+    ~MappedFile() {
+        if (base)
+            munmap(const_cast<char*>(base), file_size);
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return base; }
+    size_t size() const { return file_size; }
+};
+
+// Simple length-prefixed log, little endian:
+//   [uint64 timestamp_ns][uint32 length][length bytes of payload] ...
+class BinaryLogReader {
+private:
+    MappedFile file;
+    size_t offset = 0;
+
+public:
+    explicit BinaryLogReader(const std::string& path) : file(path) {}
+
+    bool next(CapturedMessage& msg) {
+        const size_t header = sizeof(uint64_t) + sizeof(uint32_t);
+        if (offset + header > file.size())
+            return false;
+        const char* p = file.data() + offset;
+        std::memcpy(&msg.timestamp_ns, p, sizeof(uint64_t));
+        std::memcpy(&msg.length, p + sizeof(uint64_t), sizeof(uint32_t));
+        if (offset + header + msg.length > file.size())
+            return false; // truncated tail
+        msg.data = p + header;
+        offset += header + msg.length;
+        return true;
+    }
+    void rewind() { offset = 0; }
+};
+
+class BinaryLogWriter {
+private:
+    FILE* out;
+
+public:
+    explicit BinaryLogWriter(const std::string& path) : out(std::fopen(path.c_str(), "wb")) {
+        if (!out)
+            throw std::runtime_error("cannot create " + path);
+    }
+    ~BinaryLogWriter() { std::fclose(out); }
+    BinaryLogWriter(const BinaryLogWriter&) = delete;
+    BinaryLogWriter& operator=(const BinaryLogWriter&) = delete;
+
+    void write(uint64_t timestamp_ns, const char* data, uint32_t length) {
+        std::fwrite(&timestamp_ns, sizeof(timestamp_ns), 1, out);
+        std::fwrite(&length, sizeof(length), 1, out);
+        std::fwrite(data, 1, length, out);
+    }
+};
+
+// Classic libpcap file (microsecond or nanosecond timestamps, either byte order).
+// Each frame is one message: link, IP and UDP/TCP headers are stripped and the transport
+// payload is handed over. Frames without payload (handshakes, ACKs, other protocols) are skipped.
+class PcapReader {
+private:
+    static const uint32_t MAGIC_US = 0xa1b2c3d4;
+    static const uint32_t MAGIC_NS = 0xa1b23c4d;
+    static const uint32_t LINKTYPE_ETHERNET = 1;
+    static const uint32_t LINKTYPE_RAW = 101;
+    static const uint32_t LINKTYPE_LINUX_SLL = 113;
+
+    MappedFile file;
+    size_t offset = 24;
+    bool swapped = false;
+    bool nanosecond = false;
+    uint32_t linktype = LINKTYPE_ETHERNET;
+
+    uint32_t read32(const char* p) const {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return swapped ? __builtin_bswap32(v) : v;
+    }
+    static uint16_t read_be16(const char* p) {
+        return (static_cast<uint8_t>(p[0]) << 8) | static_cast<uint8_t>(p[1]);
+    }
+
+    // Returns false when the frame does not carry a UDP/TCP payload
+    bool strip_headers(const char*& p, uint32_t& len) const {
+        uint16_t ethertype;
+        if (linktype == LINKTYPE_ETHERNET) {
+            if (len < 14) return false;
+            ethertype = read_be16(p + 12);
+            p += 14; len -= 14;
+            if (ethertype == 0x8100 && len >= 4) { // 802.1Q VLAN tag
+                ethertype = read_be16(p + 2);
+                p += 4; len -= 4;
+            }
+        } else if (linktype == LINKTYPE_LINUX_SLL) {
+            if (len < 16) return false;
+            ethertype = read_be16(p + 14);
+            p += 16; len -= 16;
+        } else if (linktype == LINKTYPE_RAW) {
+            if (len < 1) return false;
+            ethertype = ((static_cast<uint8_t>(p[0]) >> 4) == 6) ? 0x86dd : 0x0800;
+        } else {
+            return false;
+        }
+
+        uint8_t protocol;
+        if (ethertype == 0x0800) {
+            if (len < 20) return false;
+            uint32_t ihl = (static_cast<uint8_t>(p[0]) & 0x0f) * 4;
+            uint32_t total = read_be16(p + 2);
+            protocol = static_cast<uint8_t>(p[9]);
+            if (ihl < 20 || total < ihl || len < ihl) return false;
+            len = std::min(len, total); // drop Ethernet padding
+            p += ihl; len -= ihl;
+        } else if (ethertype == 0x86dd) {
+            if (len < 40) return false;
+            protocol = static_cast<uint8_t>(p[6]);
+            p += 40; len -= 40;
+        } else {
+            return false;
+        }
+
+        if (protocol == 17) { // UDP
+            if (len < 8) return false;
+            p += 8; len -= 8;
+        } else if (protocol == 6) { // TCP
+            if (len < 20) return false;
+            uint32_t data_offset = (static_cast<uint8_t>(p[12]) >> 4) * 4;
+            if (data_offset < 20 || len < data_offset) return false;
+            p += data_offset; len -= data_offset;
+        } else {
+            return false;
+        }
+        return len > 0;
+    }
+
+public:
+    explicit PcapReader(const std::string& path) : file(path) {
+        if (file.size() < 24)
+            throw std::runtime_error("not a pcap file: " + path);
+        uint32_t magic;
+        std::memcpy(&magic, file.data(), sizeof(magic));
+        if (magic == MAGIC_US || magic == MAGIC_NS) {
+            nanosecond = (magic == MAGIC_NS);
+        } else if (magic == __builtin_bswap32(MAGIC_US) || magic == __builtin_bswap32(MAGIC_NS)) {
+            swapped = true;
+            nanosecond = (magic == __builtin_bswap32(MAGIC_NS));
+        } else {
+            throw std::runtime_error("unsupported capture format (pcapng?): " + path);
+        }
+        linktype = read32(file.data() + 20);
+    }
+
+    bool next(CapturedMessage& msg) {
+        while (offset + 16 <= file.size()) {
+            const char* rec = file.data() + offset;
+            uint64_t ts_sec = read32(rec);
+            uint64_t ts_frac = read32(rec + 4);
+            uint32_t caplen = read32(rec + 8);
+            if (offset + 16 + caplen > file.size())
+                return false; // truncated tail
+            offset += 16 + caplen;
+
+            const char* p = rec + 16;
+            uint32_t len = caplen;
+            if (!strip_headers(p, len))
+                continue;
+            msg.timestamp_ns = ts_sec * 1000000000ULL + (nanosecond ? ts_frac : ts_frac * 1000);
+            msg.data = p;
+            msg.length = len;
+            return true;
+        }
+        return false;
+    }
+    void rewind() { offset = 24; }
+};
+
+enum class Pace {
+    RECORDED,            // inter-arrival gaps as captured
+    AS_FAST_AS_POSSIBLE, // back to back
+    SPEEDUP              // recorded gaps divided by the speed factor
+};
+
+struct ReplayStats {
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    double wall_seconds = 0;
+    latency::Histogram processing; // handler time per captured message
+    latency::Histogram lateness;   // how far behind schedule each message was injected
+
+    void print(std::ostream& out) const {
+        out << "Replayed " << messages << " messages (" << bytes << " bytes) in "
+            << wall_seconds << " s" << std::endl;
+        processing.print(out, "processing");
+        lateness.print(out, "injection lateness");
+    }
+};
+
+// Feeds every captured message to handler(const CapturedMessage&) on the calling thread.
+// Order is the capture order, so two runs over the same file do exactly the same work.
+// Paced modes busy-wait instead of sleeping to keep the schedule tight.
+template <typename Reader, typename Handler>
+ReplayStats run_replay(Reader& reader, Handler&& handler, Pace pace, double speed = 1.0) {
+    using clock = std::chrono::steady_clock;
+    ReplayStats stats;
+    if (pace == Pace::RECORDED)
+        speed = 1.0;
+
+    CapturedMessage msg;
+    uint64_t first_capture_ns = 0;
+    clock::time_point start = clock::now();
+    bool first = true;
+    while (reader.next(msg)) {
+        if (first) {
+            first_capture_ns = msg.timestamp_ns;
+            start = clock::now();
+            first = false;
+        }
+        if (pace != Pace::AS_FAST_AS_POSSIBLE) {
+            uint64_t offset_ns = msg.timestamp_ns > first_capture_ns ? msg.timestamp_ns - first_capture_ns : 0;
+            clock::time_point due = start + std::chrono::nanoseconds(static_cast<uint64_t>(offset_ns / speed));
+            clock::time_point now = clock::now();
+            while (now < due)
+                now = clock::now();
+            stats.lateness.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - due).count());
+        }
+
+        clock::time_point t0 = clock::now();
+        handler(msg);
+        clock::time_point t1 = clock::now();
+        stats.processing.record(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+        stats.messages++;
+        stats.bytes += msg.length;
+    }
+    stats.wall_seconds = std::chrono::duration<double>(clock::now() - start).count();
+    return stats;
+}
+
+} // namespace replay
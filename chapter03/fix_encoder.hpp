@@ -0,0 +1,300 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+#include "order_state.hpp"
+
+// Outbound FIX 4.4 NewOrderSingle and OrderCancelRequest built from per-session templates. Every
+// per-order value (MsgSeqNum, SendingTime, ClOrdID, Side, OrderQty, Price, TransactTime) lives in a
+// fixed-width, zero-padded slot (FIX allows leading zeros in int and float fields), so the message never
+// changes length: BodyLength is written once, and the CheckSum is kept up to date by adding the
+// difference each patched slot makes. Encoding an order rewrites about 70 bytes and allocates nothing.
+namespace fix
+{
+
+const char SOH = '\x01';
+const size_t MAX_MESSAGE_SIZE = 256;
+const int PRICE_DECIMALS = 4;
+const int64_t PRICE_SCALE = 10000;
+
+const char DIGIT_PAIRS[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+// Sum of the two digits of each pair, for the CheckSum
+const uint8_t DIGIT_PAIR_SUMS[100] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9,
+    1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
+    2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 12,
+    4, 5, 6, 7, 8, 9, 10, 11, 12, 13,
+    5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+    6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    7, 8, 9, 10, 11, 12, 13, 14, 15, 16,
+    8, 9, 10, 11, 12, 13, 14, 15, 16, 17,
+    9, 10, 11, 12, 13, 14, 15, 16, 17, 18};
+
+inline uint32_t write_pair(char* out, uint32_t pair) {
+    std::memcpy(out, DIGIT_PAIRS + 2 * pair, 2);
+    return DIGIT_PAIR_SUMS[pair];
+}
+
+// 8 digits in 32-bit arithmetic, as two independent halves
+inline uint32_t write_8_digits(char* out, uint32_t value) {
+    uint32_t high = value / 10000, low = value % 10000;
+    return write_pair(out, high / 100) + write_pair(out + 2, high % 100) +
+           write_pair(out + 4, low / 100) + write_pair(out + 6, low % 100);
+}
+
+// Writes value right-aligned in width digits, zero padded, and returns the sum of the digits.
+// value must fit.
+inline uint32_t write_digits(char* out, uint64_t value, int width) {
+    uint32_t digits = 0;
+    for (; width >= 8; width -= 8) {
+        uint64_t quotient = value / 100000000;
+        digits += write_8_digits(out + width - 8, static_cast<uint32_t>(value - quotient * 100000000));
+        value = quotient;
+    }
+    uint32_t rest = static_cast<uint32_t>(value);
+    for (; width >= 2; width -= 2) {
+        digits += write_pair(out + width - 2, rest % 100);
+        rest /= 100;
+    }
+    if (width == 1) {
+        *out = static_cast<char>('0' + rest);
+        digits += rest;
+    }
+    return digits;
+}
+
+inline uint32_t byte_sum(const char* data, size_t size) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < size; i++)
+        sum += static_cast<unsigned char>(data[i]);
+    return sum;
+}
+
+inline uint64_t wall_clock_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// Fixed-width slots of one message template. Layout provides `enum Slot` (ending in
+// SLOT_COUNT), WIDTHS, and the first slots of the SendingTime and TransactTime groups
+// (date, hour, minute, second, millis in a row).
+template <typename Layout>
+class TemplateMessage : public Layout {
+protected:
+    typedef typename Layout::Slot Slot;
+    static const int SLOT_COUNT = Layout::SLOT_COUNT;
+
+    char message[MAX_MESSAGE_SIZE];
+    size_t length = 0;
+    size_t checksum_offset = 0;  // the three CheckSum digits
+    uint16_t offsets[SLOT_COUNT];
+    uint32_t slot_sums[SLOT_COUNT];
+    uint64_t limits[SLOT_COUNT]; // 10^width
+    uint32_t sum = 0;            // every byte before "10="
+    uint64_t cached_minute = UINT64_MAX;
+
+    // Returns how much the slot changed the byte sum; encoders add the deltas up and update
+    // sum once, so the slots do not form one dependency chain through memory
+    uint32_t set(Slot slot, uint64_t value) {
+        const int width = Layout::WIDTHS[slot];
+        uint32_t slot_sum = '0' * width + write_digits(message + offsets[slot], value, width);
+        uint32_t delta = slot_sum - slot_sums[slot];
+        slot_sums[slot] = slot_sum;
+        return delta;
+    }
+
+    bool fits(Slot slot, uint64_t value) const { return value < limits[slot]; }
+
+    void append_slot(std::string& body, Slot slot) {
+        offsets[slot] = static_cast<uint16_t>(body.size());
+        body.append(Layout::WIDTHS[slot], '0');
+    }
+
+    void append_time(std::string& body, Slot date) {
+        append_slot(body, date);
+        body += '-';
+        append_slot(body, static_cast<Slot>(date + 1));
+        body += ':';
+        append_slot(body, static_cast<Slot>(date + 2));
+        body += ':';
+        append_slot(body, static_cast<Slot>(date + 3));
+        body += '.';
+        append_slot(body, static_cast<Slot>(date + 4));
+    }
+
+    // Standard header fields every session message starts with
+    void append_header_fields(std::string& body, char msg_type, const std::string& sender_comp_id,
+                              const std::string& target_comp_id) {
+        body += "35="; body += msg_type; body += SOH;
+        body += "34="; append_slot(body, Layout::SEQ_NUM); body += SOH;
+        body += "49=" + sender_comp_id; body += SOH;
+        body += "52="; append_time(body, Layout::SENDING_DATE); body += SOH;
+        body += "56=" + target_comp_id; body += SOH;
+    }
+
+    // Wraps the body in BeginString/BodyLength and the CheckSum trailer
+    void finish(const std::string& body) {
+        std::string header = "8=FIX.4.4";
+        header += SOH;
+        header += "9=" + std::to_string(body.size());
+        header += SOH;
+        std::string full = header + body;
+        checksum_offset = full.size() + 3;
+        full += "10=000";
+        full += SOH;
+        if (full.size() > MAX_MESSAGE_SIZE)
+            throw std::invalid_argument("FIX template does not fit MAX_MESSAGE_SIZE");
+        std::memcpy(message, full.data(), full.size());
+        length = full.size();
+
+        sum = byte_sum(message, checksum_offset - 3);
+        for (int slot = 0; slot < SLOT_COUNT; slot++) {
+            offsets[slot] = static_cast<uint16_t>(offsets[slot] + header.size());
+            slot_sums[slot] = '0' * Layout::WIDTHS[slot];
+            limits[slot] = 1;
+            for (int digit = 0; digit < Layout::WIDTHS[slot] && limits[slot] != UINT64_MAX; digit++)
+                limits[slot] = limits[slot] > UINT64_MAX / 10 ? UINT64_MAX : limits[slot] * 10;
+        }
+    }
+
+    // UTCTimestamp with millis; date, hour and minute only change once a minute
+    uint32_t set_time(uint64_t time_ns) {
+        uint32_t delta = 0;
+        uint64_t millis = time_ns / 1000000;
+        uint64_t minute = millis / 60000;
+        if (minute != cached_minute) {
+            cached_minute = minute;
+            time_t seconds = static_cast<time_t>(minute * 60);
+            tm utc;
+            gmtime_r(&seconds, &utc);
+            uint64_t date = (utc.tm_year + 1900) * 10000ULL + (utc.tm_mon + 1) * 100ULL + utc.tm_mday;
+            for (Slot first : {Layout::SENDING_DATE, Layout::TRANSACT_DATE}) {
+                delta += set(first, date);
+                delta += set(static_cast<Slot>(first + 1), utc.tm_hour);
+                delta += set(static_cast<Slot>(first + 2), utc.tm_min);
+            }
+        }
+        uint64_t second = millis / 1000 % 60;
+        delta += set(static_cast<Slot>(Layout::SENDING_DATE + 3), second);
+        delta += set(static_cast<Slot>(Layout::SENDING_DATE + 4), millis % 1000);
+        delta += set(static_cast<Slot>(Layout::TRANSACT_DATE + 3), second);
+        return delta + set(static_cast<Slot>(Layout::TRANSACT_DATE + 4), millis % 1000);
+    }
+
+    size_t complete(uint32_t delta) {
+        sum += delta;
+        write_digits(message + checksum_offset, sum & 0xff, 3);
+        return length;
+    }
+
+public:
+    // Valid until the next encode()
+    const char* data() const { return message; }
+    size_t size() const { return length; }
+};
+
+// ClOrdID is the OMS order id: 20 digits hold any non-negative int64
+struct NewOrderSingleLayout {
+    enum Slot {
+        SEQ_NUM,
+        SENDING_DATE, SENDING_HOUR, SENDING_MINUTE, SENDING_SECOND, SENDING_MILLIS,
+        CL_ORD_ID, SIDE, ORDER_QTY, PRICE_UNITS, PRICE_FRACTION,
+        TRANSACT_DATE, TRANSACT_HOUR, TRANSACT_MINUTE, TRANSACT_SECOND, TRANSACT_MILLIS,
+        SLOT_COUNT
+    };
+    static constexpr int WIDTHS[SLOT_COUNT] = {
+        9,              // MsgSeqNum
+        8, 2, 2, 2, 3,  // SendingTime YYYYMMDD-HH:MM:SS.sss
+        20, 1, 9,       // ClOrdID, Side, OrderQty
+        8, PRICE_DECIMALS,
+        8, 2, 2, 2, 3,  // TransactTime
+    };
+};
+
+class NewOrderSingleEncoder : public TemplateMessage<NewOrderSingleLayout> {
+public:
+    // Builds the template once; symbol is fixed per session, like the comp ids
+    NewOrderSingleEncoder(const std::string& sender_comp_id, const std::string& target_comp_id,
+                          const std::string& symbol) {
+        std::string body;
+        append_header_fields(body, 'D', sender_comp_id, target_comp_id);
+        body += "11="; append_slot(body, CL_ORD_ID); body += SOH;
+        body += "55=" + symbol; body += SOH;
+        body += "54="; append_slot(body, SIDE); body += SOH;
+        body += "60="; append_time(body, TRANSACT_DATE); body += SOH;
+        body += "38="; append_slot(body, ORDER_QTY); body += SOH;
+        body += "40=2"; body += SOH; // limit
+        body += "44="; append_slot(body, PRICE_UNITS); body += '.';
+        append_slot(body, PRICE_FRACTION); body += SOH;
+        body += "59=0"; body += SOH; // day
+        finish(body);
+    }
+
+    // Patches the template for order and returns the message length, or 0 when a value does
+    // not fit its slot. seq_num is the session's, shared with every other message type.
+    size_t encode(const order_state::OrderRecord& order, uint64_t seq_num, uint64_t sending_time_ns) {
+        int64_t ticks = std::llround(order.price * PRICE_SCALE);
+        if (order.id < 0 || order.quantity <= 0 || ticks < 0 || !fits(SEQ_NUM, seq_num) ||
+            !fits(CL_ORD_ID, static_cast<uint64_t>(order.id)) ||
+            !fits(ORDER_QTY, static_cast<uint64_t>(order.quantity)) ||
+            !fits(PRICE_UNITS, static_cast<uint64_t>(ticks / PRICE_SCALE)))
+            return 0;
+        return complete(set(SEQ_NUM, seq_num) + set_time(sending_time_ns) +
+                        set(CL_ORD_ID, static_cast<uint64_t>(order.id)) + set(SIDE, order.is_bid ? 1 : 2) +
+                        set(ORDER_QTY, static_cast<uint64_t>(order.quantity)) +
+                        set(PRICE_UNITS, static_cast<uint64_t>(ticks / PRICE_SCALE)) +
+                        set(PRICE_FRACTION, static_cast<uint64_t>(ticks % PRICE_SCALE)));
+    }
+};
+
+struct OrderCancelRequestLayout {
+    enum Slot {
+        SEQ_NUM,
+        SENDING_DATE, SENDING_HOUR, SENDING_MINUTE, SENDING_SECOND, SENDING_MILLIS,
+        CL_ORD_ID, ORIG_CL_ORD_ID, SIDE, ORDER_QTY,
+        TRANSACT_DATE, TRANSACT_HOUR, TRANSACT_MINUTE, TRANSACT_SECOND, TRANSACT_MILLIS,
+        SLOT_COUNT
+    };
+    static constexpr int WIDTHS[SLOT_COUNT] = {
+        9,
+        8, 2, 2, 2, 3,
+        20, 20, 1, 9,   // ClOrdID of the request, OrigClOrdID of the order, Side, OrderQty
+        8, 2, 2, 2, 3,
+    };
+};
+
+class OrderCancelRequestEncoder : public TemplateMessage<OrderCancelRequestLayout> {
+public:
+    OrderCancelRequestEncoder(const std::string& sender_comp_id, const std::string& target_comp_id,
+                              const std::string& symbol) {
+        std::string body;
+        append_header_fields(body, 'F', sender_comp_id, target_comp_id);
+        body += "11="; append_slot(body, CL_ORD_ID); body += SOH;
+        body += "41="; append_slot(body, ORIG_CL_ORD_ID); body += SOH;
+        body += "55=" + symbol; body += SOH;
+        body += "54="; append_slot(body, SIDE); body += SOH;
+        body += "60="; append_time(body, TRANSACT_DATE); body += SOH;
+        body += "38="; append_slot(body, ORDER_QTY); body += SOH;
+        finish(body);
+    }
+
+    // Cancels order; request_id is the ClOrdID of the cancel request itself
+    size_t encode(const order_state::OrderRecord& order, uint64_t request_id, uint64_t seq_num,
+                  uint64_t sending_time_ns) {
+        if (order.id < 0 || order.quantity <= 0 || !fits(SEQ_NUM, seq_num) ||
+            !fits(CL_ORD_ID, request_id) || !fits(ORDER_QTY, static_cast<uint64_t>(order.quantity)))
+            return 0;
+        return complete(set(SEQ_NUM, seq_num) + set_time(sending_time_ns) + set(CL_ORD_ID, request_id) +
+                        set(ORIG_CL_ORD_ID, static_cast<uint64_t>(order.id)) + set(SIDE, order.is_bid ? 1 : 2) +
+                        set(ORDER_QTY, static_cast<uint64_t>(order.quantity)));
+    }
+};
+
+} // namespace fix
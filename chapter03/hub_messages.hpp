@@ -0,0 +1,177 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Fixed-layout binary messages published by the messaging hub. Every message is a POD that
+// subscribers read in place by casting the received buffer: no parsing, no allocation.
+// Layout is little endian, 8-byte aligned, and must only change together with WIRE_VERSION.
+// Transports do not all promise aligned buffers (ZeroMQ frames do not): a message that is not
+// aligned is copied into an aligned local the reader provides, then read the same way.
+namespace wire
+{
+
+const uint8_t WIRE_VERSION = 1;
+const int64_t PRICE_SCALE = 100000000; // prices travel as integer 1e-8 units
+
+enum class MessageType : uint8_t {
+    BBO = 1,
+    DEPTH_DELTA = 2,
+    TRADE = 3,
+    ORDER_STATE = 4
+};
+
+enum class Side : uint8_t { BID = 0, OFFER = 1 };
+enum class DepthAction : uint8_t { NEW = 0, CHANGE = 1, DELETE = 2 };
+
+// symbol_id and type come first so the first five bytes can serve as a subscription topic
+struct alignas(8) MessageHeader {
+    uint32_t symbol_id;
+    MessageType type;
+    uint8_t version;
+    uint16_t length;       // size of the whole message, header included
+    uint64_t sequence;     // per publisher, gap detection
+    uint64_t send_time_ns;
+};
+
+struct alignas(8) BboUpdate {
+    MessageHeader header;
+    int64_t bid_price;
+    int64_t offer_price;
+    int32_t bid_quantity;
+    int32_t offer_quantity;
+};
+
+struct alignas(8) DepthDelta {
+    MessageHeader header;
+    int64_t price;
+    int32_t quantity;
+    Side side;
+    DepthAction action;
+    uint8_t level;
+    uint8_t reserved;
+};
+
+struct alignas(8) Trade {
+    MessageHeader header;
+    int64_t price;
+    uint64_t trade_id;
+    int32_t quantity;
+    Side aggressor;
+    uint8_t reserved[3];
+};
+
+struct alignas(8) OrderState {
+    MessageHeader header;
+    uint64_t order_id;
+    int64_t price;
+    int32_t cum_quantity;
+    int32_t leaves_quantity;
+    Side side;
+    uint8_t state;
+    uint8_t reserved[6];
+};
+
+template <typename T>
+struct message_type_of;
+template <> struct message_type_of<BboUpdate> { static const MessageType value = MessageType::BBO; };
+template <> struct message_type_of<DepthDelta> { static const MessageType value = MessageType::DEPTH_DELTA; };
+template <> struct message_type_of<Trade> { static const MessageType value = MessageType::TRADE; };
+template <> struct message_type_of<OrderState> { static const MessageType value = MessageType::ORDER_STATE; };
+
+// The layout is the contract with other processes: catch accidental changes at compile time
+template <typename T, size_t Size>
+constexpr bool check_layout() {
+    static_assert(std::is_trivially_copyable<T>::value, "wire messages must be trivially copyable");
+    static_assert(std::is_standard_layout<T>::value, "wire messages must be standard layout");
+    static_assert(sizeof(T) == Size, "wire message size changed: bump WIRE_VERSION");
+    static_assert(alignof(T) == 8, "wire messages are 8-byte aligned");
+    static_assert(sizeof(T) % 8 == 0, "wire messages are padded to 8 bytes");
+    return true;
+}
+static_assert(check_layout<MessageHeader, 24>(), "");
+static_assert(check_layout<BboUpdate, 48>(), "");
+static_assert(check_layout<DepthDelta, 40>(), "");
+static_assert(check_layout<Trade, 48>(), "");
+static_assert(check_layout<OrderState, 56>(), "");
+static_assert(offsetof(MessageHeader, symbol_id) == 0 && offsetof(MessageHeader, type) == 4, "topic prefix moved");
+static_assert(offsetof(BboUpdate, header) == 0 && offsetof(DepthDelta, header) == 0 &&
+              offsetof(Trade, header) == 0 && offsetof(OrderState, header) == 0, "header must come first");
+
+// Subscription topics. ZeroMQ SUB sockets match on the leading bytes of a message and every
+// message starts with symbol_id then type, so a topic is simply that prefix of the header:
+// 4 bytes for everything about a symbol, 5 bytes for one message type of a symbol.
+const size_t SYMBOL_TOPIC_SIZE = sizeof(uint32_t);
+const size_t TOPIC_SIZE = sizeof(uint32_t) + sizeof(MessageType);
+
+struct Topic {
+    char bytes[TOPIC_SIZE];
+    size_t size;
+};
+
+inline Topic make_topic(uint32_t symbol_id) {
+    Topic topic;
+    std::memcpy(topic.bytes, &symbol_id, SYMBOL_TOPIC_SIZE);
+    topic.size = SYMBOL_TOPIC_SIZE;
+    return topic;
+}
+
+inline Topic make_topic(uint32_t symbol_id, MessageType type) {
+    Topic topic = make_topic(symbol_id);
+    topic.bytes[SYMBOL_TOPIC_SIZE] = static_cast<char>(type);
+    topic.size = TOPIC_SIZE;
+    return topic;
+}
+
+// True when two encoded messages would match exactly the same subscriptions
+inline bool same_topic(const void* a, const void* b) {
+    return std::memcmp(a, b, TOPIC_SIZE) == 0;
+}
+
+inline int64_t to_wire_price(double price) { return static_cast<int64_t>(std::llround(price * PRICE_SCALE)); }
+inline double from_wire_price(int64_t price) { return static_cast<double>(price) / PRICE_SCALE; }
+
+template <typename T>
+inline void init_header(T& msg, uint32_t symbol_id, uint64_t sequence, uint64_t send_time_ns) {
+    msg.header.symbol_id = symbol_id;
+    msg.header.type = message_type_of<T>::value;
+    msg.header.version = WIRE_VERSION;
+    msg.header.length = sizeof(T);
+    msg.header.sequence = sequence;
+    msg.header.send_time_ns = send_time_ns;
+}
+
+// In place when data is aligned for T, otherwise the first sizeof(T) bytes copied into copy
+template <typename T>
+inline const T* aligned_view(const void* data, T& copy) {
+    if (reinterpret_cast<uintptr_t>(data) % alignof(T) == 0)
+        return static_cast<const T*>(data);
+    std::memcpy(&copy, data, sizeof(T));
+    return &copy;
+}
+
+// Validates the buffer and returns the header, or nullptr if it is not a message we understand.
+// copy holds the header when the buffer is not aligned.
+inline const MessageHeader* peek_header(const void* data, size_t size, MessageHeader& copy) {
+    if (size < sizeof(MessageHeader))
+        return nullptr;
+    const MessageHeader* header = aligned_view(data, copy);
+    if (header->version != WIRE_VERSION || header->length > size)
+        return nullptr;
+    return header;
+}
+
+// View of a received buffer as message T, or nullptr on a type or size mismatch. In place when
+// the buffer is aligned, otherwise copy holds the message.
+template <typename T>
+inline const T* message_cast(const void* data, size_t size, T& copy) {
+    MessageHeader header_copy;
+    const MessageHeader* header = peek_header(data, size, header_copy);
+    if (header == nullptr || header->type != message_type_of<T>::value || header->length != sizeof(T))
+        return nullptr;
+    return aligned_view(data, copy);
+}
+
+} // namespace wire
@@ -0,0 +1,179 @@
+#pragma once
+#include <zmq.hpp>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "shm_ring.hpp"
+#include "hub_messages.hpp"
+
+// Transports the messaging hub can publish through. A transport is built from an endpoint
+// string and exposes:
+//   bool send(const void* data, size_t size)   publish one update now
+//   bool queue(const void* data, size_t size)  add one update to the current batch
+//   void flush()                               publish the batch
+namespace hub_transport
+{
+
+// Fixed-size buffers recycled through a lock-free free list. ZeroMQ calls release() from
+// its I/O thread once a message has gone out, while the hub thread acquires, so both ends
+// are lock free (Treiber stack with a tag against ABA).
+class MessagePool {
+private:
+    static const uint32_t NIL = 0xffffffff;
+
+    size_t buffer_size;
+    uint32_t count;
+    std::unique_ptr<char[]> storage;
+    char* base; // storage rounded up to a cache line: every buffer starts on one
+    std::unique_ptr<std::atomic<uint32_t>[]> next;
+    alignas(64) std::atomic<uint64_t> head;
+    alignas(64) std::atomic<uint64_t> exhausted{0};
+
+public:
+    MessagePool(uint32_t count, size_t buffer_size)
+        : buffer_size((buffer_size + 63) & ~size_t(63)), count(count),
+          storage(new char[count * this->buffer_size + 63]),
+          base(reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(storage.get()) + 63) & ~uintptr_t(63))),
+          next(new std::atomic<uint32_t>[count]) {
+        for (uint32_t i = 0; i < count; i++)
+            next[i].store(i + 1 < count ? i + 1 : NIL, std::memory_order_relaxed);
+        head.store(count ? 0 : NIL, std::memory_order_release);
+    }
+
+    // Returns nullptr when every buffer is still owned by ZeroMQ
+    char* acquire() {
+        uint64_t h = head.load(std::memory_order_acquire);
+        while (true) {
+            uint32_t index = static_cast<uint32_t>(h);
+            if (index == NIL) {
+                exhausted.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            uint64_t tagged = ((h >> 32) + 1) << 32 | next[index].load(std::memory_order_relaxed);
+            if (head.compare_exchange_weak(h, tagged, std::memory_order_acq_rel, std::memory_order_acquire))
+                return &base[index * buffer_size];
+        }
+    }
+
+    void release(void* buffer) {
+        uint32_t index = static_cast<uint32_t>((static_cast<char*>(buffer) - base) / buffer_size);
+        uint64_t h = head.load(std::memory_order_relaxed);
+        while (true) {
+            next[index].store(static_cast<uint32_t>(h), std::memory_order_relaxed);
+            uint64_t tagged = ((h >> 32) + 1) << 32 | index;
+            if (head.compare_exchange_weak(h, tagged, std::memory_order_release, std::memory_order_relaxed))
+                return;
+        }
+    }
+
+    // zmq free callback: hint is the pool
+    static void release_callback(void* data, void* hint) {
+        static_cast<MessagePool*>(hint)->release(data);
+    }
+
+    size_t capacity_bytes() const { return buffer_size; }
+    uint64_t exhausted_count() const { return exhausted.load(std::memory_order_relaxed); }
+};
+
+// ZeroMQ PUB socket, subscribers connect over TCP. Updates are copied once into a pooled
+// buffer and handed to ZeroMQ with zmq_msg_init_data, so there is no allocation per send.
+// Queued updates leave as one multipart message: one send call, one wakeup of the I/O thread.
+// Subscriptions only see the first frame of a multipart message, so a batch never mixes topics.
+class ZmqTransport {
+private:
+    static const int MAX_BATCH = 64;
+
+    MessagePool pool; // declared first: must outlive the socket and the context
+    zmq::context_t context;
+    zmq::socket_t publisher;
+    char* pending[MAX_BATCH];
+    size_t pending_size[MAX_BATCH];
+    int pending_count = 0;
+
+    bool send_frame(char* buffer, size_t size, int flags) {
+        zmq::message_t message(buffer, size, &MessagePool::release_callback, &pool);
+        return publisher.send(message, flags);
+    }
+
+    bool send_copy(const void* data, size_t size, int flags) {
+        zmq::message_t message(size);
+        memcpy(message.data(), data, size);
+        return publisher.send(message, flags);
+    }
+
+public:
+    static constexpr const char* DEFAULT_ENDPOINT = "tcp://*:5556";
+    static const uint32_t POOL_BUFFERS = 8192;
+    static const size_t POOL_BUFFER_SIZE = 128;
+
+    explicit ZmqTransport(const std::string& endpoint = DEFAULT_ENDPOINT)
+        : pool(POOL_BUFFERS, POOL_BUFFER_SIZE), context(1), publisher(context, ZMQ_PUB) {
+        publisher.bind(endpoint);
+    }
+
+    bool send(const void* data, size_t size) {
+        flush();
+        char* buffer = size <= pool.capacity_bytes() ? pool.acquire() : nullptr;
+        if (buffer == nullptr)
+            return send_copy(data, size, 0); // oversized, or the pool is drained
+        memcpy(buffer, data, size);
+        return send_frame(buffer, size, 0);
+    }
+
+    bool queue(const void* data, size_t size) {
+        char* buffer = size <= pool.capacity_bytes() ? pool.acquire() : nullptr;
+        if (buffer == nullptr) {
+            flush();
+            return send_copy(data, size, 0);
+        }
+        if (pending_count > 0 && (size < wire::TOPIC_SIZE || pending_size[0] < wire::TOPIC_SIZE ||
+                                  !wire::same_topic(pending[0], data)))
+            flush();
+        memcpy(buffer, data, size);
+        pending[pending_count] = buffer;
+        pending_size[pending_count] = size;
+        if (++pending_count == MAX_BATCH)
+            flush();
+        return true;
+    }
+
+    void flush() {
+        for (int i = 0; i < pending_count; i++)
+            send_frame(pending[i], pending_size[i], i + 1 < pending_count ? ZMQ_SNDMORE : 0);
+        pending_count = 0;
+    }
+
+    uint64_t pool_exhausted() const { return pool.exhausted_count(); }
+};
+
+// Same-host subscribers map the ring and read in place: no syscalls, no kernel copies
+class ShmTransport {
+private:
+    shm::ShmPublisher ring;
+
+public:
+    static constexpr const char* DEFAULT_ENDPOINT = "/lob_hub";
+
+    explicit ShmTransport(const std::string& endpoint = DEFAULT_ENDPOINT) : ring(endpoint) {}
+
+    bool send(const void* data, size_t size) { return ring.send(data, size); }
+
+    // Every record is visible as soon as it is written, so a batch needs no extra work
+    bool queue(const void* data, size_t size) { return ring.send(data, size); }
+    void flush() {}
+
+    // Lets the caller serialize straight into the ring
+    char* claim(size_t size) { return ring.claim(size); }
+    void commit() { ring.commit(); }
+
+    uint64_t dropped_messages() const { return ring.dropped_messages(); }
+
+    // Per-consumer lag and losses, see shm::SlowConsumerPolicy
+    std::vector<shm::ConsumerStats> consumer_stats() const { return ring.consumer_stats(); }
+    uint64_t disconnected_consumers() const { return ring.disconnected_consumers(); }
+};
+
+} // namespace hub_transport
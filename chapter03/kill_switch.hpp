@@ -0,0 +1,248 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "order_state.hpp"
+#include "throttle.hpp"
+
+// Halting all trading at once. Any thread throws the switch; from then on no new order leaves,
+// and every order working at a venue gets a cancel. Working orders are kept per venue in dense
+// arrays, so the cancel-all is a walk over contiguous records instead of a search of the order
+// store. The cancels go through the venue rate limits like any other message: a cancel storm
+// that gets the session disconnected leaves the orders working.
+namespace kill
+{
+
+// Thrown by any thread, read on the order paths before an order is accepted
+class KillSwitch {
+private:
+    std::atomic<uint64_t> engaged_at{0}; // TSC when thrown, 0 while off
+
+public:
+    // Returns true for the call that threw it
+    bool engage(uint64_t now) {
+        uint64_t off = 0;
+        return engaged_at.compare_exchange_strong(off, now ? now : 1, std::memory_order_acq_rel);
+    }
+    // Trading may resume; what was cancelled stays cancelled
+    void reset() { engaged_at.store(0, std::memory_order_release); }
+    bool engaged() const { return engaged_at.load(std::memory_order_acquire) != 0; }
+    uint64_t engaged_time() const { return engaged_at.load(std::memory_order_acquire); }
+};
+
+// Orders sent and not yet terminal, for one thread. Records sit in one array per venue, a
+// removal moves the venue's last record into the hole; ids map to (venue, index) through an
+// open-addressing table (linear probing, backward-shift delete) sized at construction.
+class WorkingOrders {
+private:
+    static const uint32_t EMPTY = 0xffffffff;
+
+    struct Entry {
+        int64_t id;
+        uint32_t venue; // EMPTY: unused entry
+        uint32_t index;
+    };
+
+    std::vector<std::vector<order_state::OrderRecord>> venues;
+    size_t max_orders;
+    size_t count = 0;
+    size_t table_mask;
+    std::unique_ptr<Entry[]> table;
+
+    static uint64_t hash(int64_t id) {
+        uint64_t x = static_cast<uint64_t>(id);
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    size_t probe(int64_t id, bool& found) const {
+        for (size_t i = hash(id) & table_mask;; i = (i + 1) & table_mask) {
+            if (table[i].venue == EMPTY || table[i].id == id) {
+                found = table[i].venue != EMPTY;
+                return i;
+            }
+        }
+    }
+
+    void remove_entry(size_t hole) {
+        for (size_t i = (hole + 1) & table_mask; table[i].venue != EMPTY; i = (i + 1) & table_mask) {
+            size_t home = hash(table[i].id) & table_mask;
+            bool home_after_hole = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+            if (!home_after_hole) {
+                table[hole] = table[i];
+                hole = i;
+            }
+        }
+        table[hole].venue = EMPTY;
+    }
+
+    void erase(size_t entry) {
+        std::vector<order_state::OrderRecord>& orders = venues[table[entry].venue];
+        const uint32_t index = table[entry].index;
+        if (index + 1 != orders.size()) {
+            orders[index] = orders.back();
+            bool found;
+            table[probe(orders[index].id, found)].index = index;
+        }
+        orders.pop_back();
+        remove_entry(entry);
+        count--;
+    }
+
+public:
+    explicit WorkingOrders(size_t max_orders) : max_orders(max_orders) {
+        if (max_orders == 0 || max_orders >= EMPTY)
+            throw std::invalid_argument("working order capacity out of range");
+        size_t table_size = 1;
+        while (table_size < max_orders * 2)
+            table_size <<= 1;
+        table_mask = table_size - 1;
+        table.reset(new Entry[table_size]);
+        for (size_t i = 0; i < table_size; i++)
+            table[i] = Entry{0, EMPTY, 0};
+    }
+    WorkingOrders(const WorkingOrders&) = delete;
+    WorkingOrders& operator=(const WorkingOrders&) = delete;
+
+    // The venue arrays keep their capacity as orders leave: once the book has been as large,
+    // adding allocates nothing. False when the id is already working or the table is full.
+    bool add(int venue, const order_state::OrderRecord& order) {
+        bool found;
+        size_t entry = probe(order.id, found);
+        if (found || count == max_orders || venue < 0)
+            return false;
+        if (static_cast<size_t>(venue) >= venues.size())
+            venues.resize(venue + 1);
+        table[entry] = Entry{order.id, static_cast<uint32_t>(venue), static_cast<uint32_t>(venues[venue].size())};
+        venues[venue].push_back(order);
+        count++;
+        return true;
+    }
+
+    // Valid until the next add, apply or remove
+    order_state::OrderRecord* find(int64_t id) {
+        bool found;
+        size_t entry = probe(id, found);
+        return found ? &venues[table[entry].venue][table[entry].index] : nullptr;
+    }
+
+    // Applies an execution report for a working order; a terminal one stops working. False,
+    // leaving it unchanged, for an unknown order or a transition not allowed.
+    bool apply(const order_state::ExecutionUpdate& update) {
+        bool found;
+        size_t entry = probe(update.order_id, found);
+        if (!found)
+            return false;
+        order_state::OrderRecord& order = venues[table[entry].venue][table[entry].index];
+        if (!order_state::apply(order, update))
+            return false;
+        if (order_state::is_terminal(order.state))
+            erase(entry);
+        return true;
+    }
+
+    bool remove(int64_t id) {
+        bool found;
+        size_t entry = probe(id, found);
+        if (found)
+            erase(entry);
+        return found;
+    }
+
+    size_t size() const { return count; }
+    int venue_count() const { return static_cast<int>(venues.size()); }
+    size_t working(int venue) const { return venue < venue_count() ? venues[venue].size() : 0; }
+    order_state::OrderRecord& at(int venue, size_t index) { return venues[venue][index]; }
+    // fn(OrderRecord&) for the venue's working orders; it must not add or remove any
+    template <typename Fn>
+    void for_each(int venue, Fn&& fn) {
+        if (venue < venue_count())
+            for (order_state::OrderRecord& order : venues[venue])
+                fn(order);
+    }
+};
+
+// Submits a cancel, on throttle session venue, for every working order not already being
+// cancelled, and moves it to CANCEL_PENDING, a few at a time: resume() submits what the session
+// queues take and returns, so the caller keeps dispatching and applying execution reports
+// between two calls. The venues take turns, so the cancels of one venue do not wait for
+// another's rate limit. Each venue is walked from its last order down: removing an order moves
+// the venue's last one into its place, so orders still to visit stay below the cursor.
+class CancelSweep {
+private:
+    std::vector<size_t> cursors; // per venue: orders below this index have not been visited
+    std::vector<uint8_t> full;   // per venue: its session queue refused a cancel in this resume
+    size_t cancels = 0;
+
+public:
+    // Covers the orders working now; resets a previous sweep
+    void start(WorkingOrders& working) {
+        cursors.assign(working.venue_count(), 0);
+        full.assign(working.venue_count(), 0);
+        for (int venue = 0; venue < working.venue_count(); venue++)
+            cursors[venue] = working.working(venue);
+        cancels = 0;
+    }
+
+    // Drops what is left, e.g. when trading resumes: orders added since start are not this
+    // sweep's to cancel
+    void stop() { cursors.clear(); }
+
+    // Submits cancels until every order is covered or every venue with orders left has a full
+    // session queue; true once the sweep is done
+    bool resume(WorkingOrders& working, throttle::OrderThrottle& limiter) {
+        std::fill(full.begin(), full.end(), 0);
+        bool more = true;
+        while (more) {
+            more = false;
+            for (int venue = 0; venue < static_cast<int>(cursors.size()); venue++) {
+                size_t& next = cursors[venue];
+                next = std::min(next, working.working(venue)); // reports since the last call removed orders
+                if (next == 0 || full[venue])
+                    continue;
+                order_state::OrderRecord request = working.at(venue, next - 1);
+                const order_state::ExecutionUpdate cancel{request.id, 0.0, 0, order_state::OrderEvent::CANCEL_REQUEST};
+                if (order_state::apply(request, cancel)) {
+                    if (limiter.submit(venue, throttle::Priority::CANCEL, request) == throttle::SubmitResult::FULL) {
+                        full[venue] = 1;
+                        continue;
+                    }
+                    working.at(venue, next - 1) = request;
+                    cancels++;
+                } // else a cancel is already on its way
+                more |= --next != 0;
+            }
+        }
+        return done();
+    }
+
+    bool done() const {
+        for (size_t next : cursors)
+            if (next != 0)
+                return false;
+        return true;
+    }
+    // Cancels submitted since start
+    size_t submitted() const { return cancels; }
+};
+
+// The whole sweep at once, for a caller with nothing else to do meanwhile: a session queue full
+// of cancels is emptied by calling dispatch() until it takes the next one. Returns the cancels
+// submitted.
+template <typename Dispatch>
+size_t cancel_all(WorkingOrders& working, throttle::OrderThrottle& limiter, Dispatch&& dispatch) {
+    CancelSweep sweep;
+    sweep.start(working);
+    while (!sweep.resume(working, limiter))
+        dispatch();
+    return sweep.submitted();
+}
+
+} // namespace kill
@@ -0,0 +1,98 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+
+namespace latency
+{
+
+// Log-linear histogram in the style of HdrHistogram: every power-of-two range is split in
+// SUB_BUCKETS linear steps, so the relative error stays below 1/SUB_BUCKETS at any magnitude.
+// Fixed size and allocation free: record() is a couple of shifts and one increment.
+class Histogram {
+private:
+    static const int SUB_BITS = 8;
+    static const uint64_t SUB_BUCKETS = 1ULL << SUB_BITS;
+    static const uint64_t HALF = SUB_BUCKETS / 2;
+    static const int MAX_BITS = 40;                       // ~18 minutes when recording ns
+    static const int BUCKETS = MAX_BITS - SUB_BITS + 1;
+    static const size_t SIZE = (BUCKETS + 1) * HALF;
+
+    std::array<uint64_t, SIZE> counts{};
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t min_value = UINT64_MAX;
+    uint64_t max_value = 0;
+
+    static size_t index_of(uint64_t value) {
+        int bucket = (63 - __builtin_clzll(value | (SUB_BUCKETS - 1))) - (SUB_BITS - 1);
+        if (bucket >= BUCKETS)
+            return SIZE - 1;
+        return bucket * HALF + (value >> bucket);
+    }
+
+    static uint64_t highest_value_at(size_t index) {
+        int bucket = std::max<int>(0, static_cast<int>(index >> (SUB_BITS - 1)) - 1);
+        uint64_t sub = index - bucket * HALF;
+        return ((sub + 1) << bucket) - 1;
+    }
+
+public:
+    void record(uint64_t value) {
+        counts[index_of(value)]++;
+        total++;
+        sum += value;
+        min_value = std::min(min_value, value);
+        max_value = std::max(max_value, value);
+    }
+
+    void merge(const Histogram& other) {
+        for (size_t i = 0; i < SIZE; i++)
+            counts[i] += other.counts[i];
+        total += other.total;
+        sum += other.sum;
+        min_value = std::min(min_value, other.min_value);
+        max_value = std::max(max_value, other.max_value);
+    }
+
+    void reset() {
+        counts.fill(0);
+        total = sum = max_value = 0;
+        min_value = UINT64_MAX;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t min() const { return total ? min_value : 0; }
+    uint64_t max() const { return max_value; }
+    double mean() const { return total ? static_cast<double>(sum) / total : 0.0; }
+
+    // p in [0, 100]. Returns the highest value equivalent to the bucket holding the percentile.
+    uint64_t percentile(double p) const {
+        if (total == 0)
+            return 0;
+        uint64_t target = static_cast<uint64_t>(p / 100.0 * total + 0.5);
+        target = std::min(std::max<uint64_t>(target, 1), total);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < SIZE; i++) {
+            seen += counts[i];
+            if (seen >= target)
+                return std::min(highest_value_at(i), max_value);
+        }
+        return max_value;
+    }
+
+    void print(std::ostream& out, const char* name, const char* unit = "ns") const {
+        out << name << ": count=" << total
+            << " min=" << min() << unit
+            << " mean=" << static_cast<uint64_t>(mean()) << unit
+            << " p50=" << percentile(50) << unit
+            << " p90=" << percentile(90) << unit
+            << " p99=" << percentile(99) << unit
+            << " p99.9=" << percentile(99.9) << unit
+            << " p99.99=" << percentile(99.99) << unit
+            << " max=" << max() << unit << std::endl;
+    }
+};
+
+} // namespace latency
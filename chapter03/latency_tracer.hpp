@@ -0,0 +1,225 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "latency_histogram.hpp"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Compile with -DLATENCY_TRACE=1 to stamp the feed handler stages. When it is off the
+// TRACE_SCOPE macro expands to nothing and the hot path is untouched.
+#ifndef LATENCY_TRACE
+#define LATENCY_TRACE 0
+#endif
+
+namespace latency
+{
+
+inline uint64_t rdtsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+// Converts TSC cycles to nanoseconds. Calibrated once against steady_clock on first use;
+// call TscClock::instance() during startup so the calibration is not paid on the hot path.
+class TscClock {
+private:
+    double ns_per_cycle = 1.0;
+
+    TscClock() {
+        using clock = std::chrono::steady_clock;
+        clock::time_point t0 = clock::now();
+        uint64_t c0 = rdtsc();
+        clock::time_point t1;
+        do {
+            t1 = clock::now();
+        } while (t1 - t0 < std::chrono::milliseconds(20));
+        uint64_t c1 = rdtsc();
+        double ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+        if (c1 > c0)
+            ns_per_cycle = ns / static_cast<double>(c1 - c0);
+    }
+
+public:
+    static TscClock& instance() {
+        static TscClock clock;
+        return clock;
+    }
+    uint64_t to_ns(uint64_t cycles) const { return static_cast<uint64_t>(cycles * ns_per_cycle); }
+    double cycles_per_ns() const { return 1.0 / ns_per_cycle; }
+};
+
+enum class Stage : uint32_t {
+    FROM_APP,          // MyFIXApplication::fromApp, includes cracking
+    ON_MESSAGE,        // MarketDataIncrementalRefresh parsing and book updates
+    BOOK_ADD_ORDER,    // LimitOrderBook::add_order
+    STRATEGY_CALLBACK, // StrategyModule decision on a book update
+    STAGE_COUNT
+};
+
+inline const char* stage_name(Stage stage) {
+    switch (stage) {
+        case Stage::FROM_APP: return "fromApp";
+        case Stage::ON_MESSAGE: return "onMessage";
+        case Stage::BOOK_ADD_ORDER: return "LimitOrderBook::add_order";
+        case Stage::STRATEGY_CALLBACK: return "strategy callback";
+        default: return "unknown";
+    }
+}
+
+struct TraceEvent {
+    uint64_t start;
+    uint64_t end;
+    Stage stage;
+};
+
+// Preallocated single-producer/single-consumer ring owned by one traced thread.
+// The owner only writes events and its head; the aggregator only moves the tail.
+// When the aggregator falls behind, new events are dropped and counted.
+class TraceRing {
+private:
+    static const uint64_t CAPACITY = 1 << 14;
+    static const uint64_t MASK = CAPACITY - 1;
+
+    alignas(64) std::atomic<uint64_t> head{0};
+    alignas(64) std::atomic<uint64_t> tail{0};
+    alignas(64) uint64_t dropped = 0;
+    TraceEvent events[CAPACITY];
+
+public:
+    void push(Stage stage, uint64_t start, uint64_t end) {
+        uint64_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == CAPACITY) {
+            dropped++;
+            return;
+        }
+        events[h & MASK] = TraceEvent{start, end, stage};
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    template <typename Callback>
+    size_t drain(Callback&& on_event) {
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        uint64_t h = head.load(std::memory_order_acquire);
+        for (uint64_t i = t; i < h; i++)
+            on_event(events[i & MASK]);
+        tail.store(h, std::memory_order_release);
+        return h - t;
+    }
+
+    uint64_t dropped_events() const { return dropped; }
+};
+
+// Owns every thread's ring. Registration happens once per thread, under a mutex, on the
+// first traced event; after that recording is lock free.
+class TraceRegistry {
+private:
+    std::mutex mtx;
+    std::vector<std::unique_ptr<TraceRing>> rings;
+
+public:
+    static TraceRegistry& instance() {
+        static TraceRegistry registry;
+        return registry;
+    }
+
+    TraceRing* create_ring() {
+        std::lock_guard<std::mutex> lock(mtx);
+        rings.emplace_back(new TraceRing());
+        return rings.back().get();
+    }
+
+    template <typename Callback>
+    void for_each_ring(Callback&& callback) {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto& ring : rings)
+            callback(*ring);
+    }
+
+    static TraceRing& this_thread_ring() {
+        thread_local TraceRing* ring = instance().create_ring();
+        return *ring;
+    }
+};
+
+class ScopedTrace {
+private:
+    Stage stage;
+    uint64_t start;
+
+public:
+    explicit ScopedTrace(Stage stage) : stage(stage), start(rdtsc()) {}
+    ~ScopedTrace() { TraceRegistry::this_thread_ring().push(stage, start, rdtsc()); }
+};
+
+// Background thread that periodically drains all rings and folds the events into one
+// histogram per stage, in nanoseconds. Readers take a copy with snapshot().
+class TraceAggregator {
+private:
+    std::vector<Histogram> histograms;
+    std::mutex mtx;
+    std::atomic<bool> running{false};
+    std::thread worker;
+
+public:
+    TraceAggregator() : histograms(static_cast<size_t>(Stage::STAGE_COUNT)) {
+        TscClock::instance();
+    }
+    ~TraceAggregator() { stop(); }
+
+    void collect() {
+        const TscClock& tsc = TscClock::instance();
+        std::lock_guard<std::mutex> lock(mtx);
+        TraceRegistry::instance().for_each_ring([&](TraceRing& ring) {
+            ring.drain([&](const TraceEvent& e) {
+                histograms[static_cast<size_t>(e.stage)].record(tsc.to_ns(e.end - e.start));
+            });
+        });
+    }
+
+    void start(std::chrono::milliseconds interval) {
+        running = true;
+        worker = std::thread([this, interval]() {
+            while (running.load(std::memory_order_relaxed)) {
+                std::this_thread::sleep_for(interval);
+                collect();
+            }
+        });
+    }
+
+    void stop() {
+        running = false;
+        if (worker.joinable())
+            worker.join();
+        collect();
+    }
+
+    Histogram snapshot(Stage stage) {
+        std::lock_guard<std::mutex> lock(mtx);
+        return histograms[static_cast<size_t>(stage)];
+    }
+
+    void print(std::ostream& out) {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (size_t i = 0; i < histograms.size(); i++)
+            histograms[i].print(out, stage_name(static_cast<Stage>(i)));
+    }
+};
+
+} // namespace latency
+
+#if LATENCY_TRACE
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(stage) latency::ScopedTrace TRACE_CONCAT(_trace_scope_, __LINE__)(stage)
+#else
+#define TRACE_SCOPE(stage)
+#endif
@@ -15,15 +15,17 @@ namespace lockfree
             offers.resize(depth);
         }
 
-        void add_order(const Order& order, bool is_bid) override {
+        bool add_order(const Order& order, bool is_bid) override {
             if (is_bid) {
                 int index = price_to_index(order.price, true);
                 if (index > -1)
                     bids[index] = order;
+                return index > -1;
             } else {
                 int index = price_to_index(order.price, false);
                 if (index > -1)
                     offers[index] = order;
+                return index > -1;
             }
         }
 
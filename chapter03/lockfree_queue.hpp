@@ -0,0 +1,201 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace queues
+{
+
+const size_t CACHE_LINE = 64;
+
+// Bounded single-producer single-consumer ring. Head and tail sit on their own cache lines
+// and each side keeps a private copy of the other's index, so the shared lines are only
+// touched when the ring looks full (producer) or empty (consumer).
+template <typename T>
+class SpscQueue {
+private:
+    size_t mask;
+    std::unique_ptr<T[]> slots;
+    alignas(CACHE_LINE) std::atomic<size_t> head{0}; // next slot to read, written by the consumer
+    size_t cached_tail = 0;
+    alignas(CACHE_LINE) std::atomic<size_t> tail{0}; // next slot to write, written by the producer
+    size_t cached_head = 0;
+
+public:
+    explicit SpscQueue(size_t capacity) : mask(capacity - 1), slots(new T[capacity]) {
+        if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+            throw std::invalid_argument("queue capacity must be a power of two");
+    }
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer side. False when the queue is full.
+    bool try_push(const T& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cached_head > mask) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (t - cached_head > mask)
+                return false;
+        }
+        slots[t & mask] = value;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. False when the queue is empty.
+    bool try_pop(T& value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == cached_tail) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (h == cached_tail)
+                return false;
+        }
+        value = slots[h & mask];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: calls on_item(const T&) for up to max_items queued items and releases
+    // their slots with a single store. Returns the number of items.
+    template <typename Callback>
+    size_t drain(Callback&& on_item, size_t max_items = SIZE_MAX) {
+        size_t h = head.load(std::memory_order_relaxed);
+        cached_tail = tail.load(std::memory_order_acquire);
+        size_t n = cached_tail - h;
+        if (n > max_items)
+            n = max_items;
+        for (size_t i = 0; i < n; i++)
+            on_item(slots[(h + i) & mask]);
+        if (n)
+            head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    // Exact from the consumer thread, a hint from anywhere else
+    bool empty() const {
+        return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_acquire);
+    }
+    size_t size() const {
+        size_t h = head.load(std::memory_order_acquire);
+        return tail.load(std::memory_order_acquire) - h;
+    }
+    size_t capacity() const { return mask + 1; }
+};
+
+// Bounded queue for many producers, after Dmitry Vyukov's MPMC design: every slot carries a
+// sequence number telling whether it is free for the producer of lap n or holds data for the
+// consumer of lap n. Producers claim a position with one CAS on the enqueue counter and never
+// touch the consumers' counter; the two counters live on separate cache lines.
+// SingleConsumer drops the CAS on the dequeue side (MPSC).
+template <typename T, bool SingleConsumer>
+class SequencedQueue {
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(CACHE_LINE) std::atomic<size_t> enqueue_pos{0};
+    alignas(CACHE_LINE) std::atomic<size_t> dequeue_pos{0};
+
+    // Claims the next readable cell, or nullptr when the queue is empty
+    Cell* claim_read(size_t& pos) {
+        pos = dequeue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell* cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff < 0)
+                return nullptr;
+            if (SingleConsumer) {
+                dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+                return cell;
+            }
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    return cell;
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed); // another consumer moved on
+            }
+        }
+    }
+
+    void release(Cell* cell, size_t pos) {
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+    }
+
+public:
+    explicit SequencedQueue(size_t capacity) : mask(capacity - 1), cells(new Cell[capacity]) {
+        if (capacity < 2 || (capacity & (capacity - 1)) != 0)
+            throw std::invalid_argument("queue capacity must be a power of two");
+        for (size_t i = 0; i < capacity; i++)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    SequencedQueue(const SequencedQueue&) = delete;
+    SequencedQueue& operator=(const SequencedQueue&) = delete;
+
+    // Any thread. False when the queue is full.
+    bool try_push(const T& value) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell* cell = &cells[pos & mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell->value = value;
+                    cell->sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // False when the queue is empty
+    bool try_pop(T& value) {
+        size_t pos;
+        Cell* cell = claim_read(pos);
+        if (cell == nullptr)
+            return false;
+        value = std::move(cell->value);
+        release(cell, pos);
+        return true;
+    }
+
+    // Calls on_item(T&) for up to max_items queued items, in place. Returns the number of items.
+    template <typename Callback>
+    size_t drain(Callback&& on_item, size_t max_items = SIZE_MAX) {
+        size_t n = 0;
+        size_t pos;
+        Cell* cell;
+        while (n < max_items && (cell = claim_read(pos)) != nullptr) {
+            on_item(cell->value);
+            release(cell, pos);
+            n++;
+        }
+        return n;
+    }
+
+    // A hint: another thread may push or pop right after
+    bool empty() const {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        return cells[pos & mask].sequence.load(std::memory_order_acquire) != pos + 1;
+    }
+    size_t capacity() const { return mask + 1; }
+};
+
+template <typename T>
+using MpscQueue = SequencedQueue<T, true>;
+template <typename T>
+using MpmcQueue = SequencedQueue<T, false>;
+
+} // namespace queues
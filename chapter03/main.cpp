@@ -1,15 +1,72 @@
+// Either can also be set from the build, see the UnitTests target in CMakeLists.txt
+#ifndef RUN_BENCHMARK
 #define RUN_BENCHMARK 0
+#endif
+#ifndef RUN_UNIT_TEST
 #define RUN_UNIT_TEST 0
+#endif
 
 
 
 #if RUN_UNIT_TEST == 1
 #include <iostream>
 #include "tests/exploring_circular_array_test.hpp"
+#include "tests/conflation_buffer_test.hpp"
+#include "tests/feed_replay_test.hpp"
+#include "tests/udp_multicast_receiver_test.hpp"
+#include "tests/shm_ring_test.hpp"
+#include "tests/order_state_test.hpp"
+#include "tests/order_store_test.hpp"
+#include "tests/order_journal_test.hpp"
+#include "tests/order_snapshot_test.hpp"
+#include "tests/fix_encoder_test.hpp"
+#include "tests/venue_router_test.hpp"
+#include "tests/throttle_test.hpp"
+#include "tests/pretrade_risk_test.hpp"
+#include "tests/position_book_test.hpp"
+#include "tests/var_engine_test.hpp"
+#include "tests/risk_monitor_test.hpp"
+#include "tests/kill_switch_test.hpp"
+#include "tests/oms_ems_test.hpp"
+#include "tests/hub_messages_test.hpp"
+#include "tests/rms_test.hpp"
+#include "tests/lockfree_queue_test.hpp"
+#include "tests/disruptor_test.hpp"
+#include "tests/trading_pipeline_test.hpp"
+#include "tests/wait_strategy_test.hpp"
+#include "tests/hub_transport_test.hpp"
+#include "tests/notifying_book_test.hpp"
+#include "tests/latency_tracer_test.hpp"
 
 int main() {
 
     run_all_tests();
+    run_conflation_buffer_tests();
+    run_feed_replay_tests();
+    run_udp_multicast_receiver_tests();
+    run_shm_ring_tests();
+    run_order_state_tests();
+    run_order_store_tests();
+    run_order_journal_tests();
+    run_order_snapshot_tests();
+    run_fix_encoder_tests();
+    run_venue_router_tests();
+    run_throttle_tests();
+    run_pretrade_risk_tests();
+    run_position_book_tests();
+    run_var_engine_tests();
+    run_risk_monitor_tests();
+    run_kill_switch_tests();
+    run_oms_ems_tests();
+    run_hub_messages_tests();
+    run_rms_tests();
+    run_lockfree_queue_tests();
+    run_disruptor_tests();
+    run_trading_pipeline_tests();
+    run_wait_strategy_tests();
+    run_hub_transport_tests();
+    run_notifying_book_tests();
+    run_latency_tracer_tests();
 
     std::cout << "Done..." << std::endl;
     return 0;
@@ -75,6 +132,8 @@ int main(){
 #include <sched.h>
 #include <unistd.h>
 #include <thread>
+#include <atomic>
+#include <chrono>
 #include <iostream>
 #include <iomanip>
 #include <random>
@@ -87,6 +146,33 @@ int main(){
 #include "synchronized_limitorderbook.hpp"
 #include "smartblocking_limitorderbook.hpp"
 #include "lockfree_limitorderbook.hpp"
+#include "conflation_buffer.hpp"
+#include "latency_tracer.hpp"
+#include "wait_strategy.hpp"
+#include "shm_ring.hpp"
+#include "hub_messages.hpp"
+#include "hub_transport.hpp"
+#include "messaging_hub.hpp"
+#include "lockfree_queue.hpp"
+#include "trading_pipeline.hpp"
+#include "order_state.hpp"
+#include "order_store.hpp"
+#include "order_journal.hpp"
+#include "order_snapshot.hpp"
+#include "fix_encoder.hpp"
+#include "venue_router.hpp"
+#include "throttle.hpp"
+#include "pretrade_risk.hpp"
+#include "position_book.hpp"
+#include "var_engine.hpp"
+#include "risk_monitor.hpp"
+#include "kill_switch.hpp"
+#include <unordered_map>
+#include <mutex>
+#include <queue>
+#include <zmq.hpp>
+#include <time.h>
+#include <sstream>
 
 const int _LOB_DEPTH = 50;
 
@@ -783,6 +869,1138 @@ BENCHMARK(BM_LockFreeAddOrderAndGetBestBid)
     ->Args({1000, 20});  // 1000 orders, 20 reader threads
 
 
+//BENCHMARK CONFLATION: book writer cost while a slow consumer drains at its own pace
+static void BM_ConflationPublishWithSlowConsumer(benchmark::State& state) {
+    const int num_symbols = state.range(0);
+    conflation::ConflationBuffer buffer(num_symbols, 2);
+    int fast = buffer.register_consumer();
+    int slow = buffer.register_consumer();
+    std::atomic<bool> running{true};
+
+    std::thread slow_consumer([&]() {
+        while (running.load(std::memory_order_relaxed)) {
+            buffer.drain(slow, [](const conflation::MarketSnapshot& s) {
+                benchmark::DoNotOptimize(s.bids[0].price);
+            });
+            std::this_thread::sleep_for(std::chrono::milliseconds(1)); // risk thread doing other work
+        }
+    });
+
+    conflation::MarketSnapshot snapshot{};
+    snapshot.bid_levels = snapshot.offer_levels = 1;
+    uint32_t symbol = 0;
+    double price = 10.01;
+    for (auto _ : state) {
+        snapshot.symbol_id = symbol;
+        snapshot.bids[0] = {price, 100};
+        snapshot.offers[0] = {price + 0.01, 100};
+        buffer.publish(snapshot);
+        if (++symbol == static_cast<uint32_t>(num_symbols))
+            symbol = 0;
+        price += 0.01;
+        if ((symbol & 63) == 0)
+            buffer.drain(fast, [](const conflation::MarketSnapshot& s) {
+                benchmark::DoNotOptimize(s.bids[0].price);
+            });
+    }
+    running = false;
+    slow_consumer.join();
+
+    conflation::ConsumerMetrics metrics = buffer.metrics(slow);
+    state.counters["slow_delivered"] = metrics.delivered;
+    state.counters["slow_conflated"] = metrics.conflated;
+    state.counters["fast_conflated"] = buffer.metrics(fast).conflated;
+}
+BENCHMARK(BM_ConflationPublishWithSlowConsumer)
+    ->Arg(100)    // 100 symbols
+    ->Arg(5000);  // 5000 symbols
+
+//BENCHMARK TRACING: cost of stamping one stage into the per-thread ring
+static void BM_TraceScopeOverhead(benchmark::State& state) {
+    latency::TraceAggregator aggregator;
+    aggregator.start(std::chrono::milliseconds(1));
+    for (auto _ : state) {
+        latency::ScopedTrace trace(latency::Stage::BOOK_ADD_ORDER);
+        benchmark::ClobberMemory();
+    }
+    aggregator.stop();
+    latency::Histogram h = aggregator.snapshot(latency::Stage::BOOK_ADD_ORDER);
+    state.counters["p50_ns"] = h.percentile(50);
+    state.counters["p99_ns"] = h.percentile(99);
+}
+static void BM_AddOrderTraced(benchmark::State& state) {
+    latency::TraceAggregator aggregator;
+    aggregator.start(std::chrono::milliseconds(1));
+    circular_array::LimitOrderBook lob(2, _LOB_DEPTH);
+    int id = 1;
+    double price = 10.01;
+    for (auto _ : state) {
+        latency::ScopedTrace trace(latency::Stage::BOOK_ADD_ORDER);
+        lob.add_order(circular_array::Order(id++, price, 100), true);
+        price += 0.01;
+    }
+    aggregator.stop();
+    latency::Histogram h = aggregator.snapshot(latency::Stage::BOOK_ADD_ORDER);
+    state.counters["p50_ns"] = h.percentile(50);
+    state.counters["p99_ns"] = h.percentile(99);
+    state.counters["p99.9_ns"] = h.percentile(99.9);
+}
+BENCHMARK(BM_TraceScopeOverhead);
+BENCHMARK(BM_AddOrderTraced);
+
+//BENCHMARK WAIT STRATEGIES: producer notifies after an idle gap, consumer wakes up and stamps the delay
+static void BM_WakeupLatency(benchmark::State& state) {
+    wait::Mode mode = static_cast<wait::Mode>(state.range(0));
+    wait::WaitStrategy waiter(mode, 2000, 1000000);
+    wait::WakeSignal signal;
+    std::atomic<uint64_t> sent_tsc{0};
+    std::atomic<uint64_t> wakeups{0};
+    std::atomic<bool> running{true};
+    latency::Histogram histogram;
+    const latency::TscClock& tsc = latency::TscClock::instance();
+    double consumer_cpu_seconds = 0;
+
+    std::thread consumer([&]() {
+        timespec cpu0, cpu1;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu0);
+        uint32_t seen = signal.current();
+        while (true) {
+            seen = waiter.wait_for(signal, seen);
+            if (!running.load(std::memory_order_acquire))
+                break;
+            histogram.record(tsc.to_ns(latency::rdtsc() - sent_tsc.load(std::memory_order_acquire)));
+            wakeups.fetch_add(1, std::memory_order_release);
+        }
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu1);
+        consumer_cpu_seconds = (cpu1.tv_sec - cpu0.tv_sec) + (cpu1.tv_nsec - cpu0.tv_nsec) / 1e9;
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t expected = 0;
+    for (auto _ : state) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200)); // quiet period: let the consumer go idle
+        sent_tsc.store(latency::rdtsc(), std::memory_order_release);
+        signal.notify();
+        expected++;
+        while (wakeups.load(std::memory_order_acquire) < expected)
+            std::this_thread::yield();
+        // round trip as seen by the producer: wake-up plus the acknowledgement
+        state.SetIterationTime(tsc.to_ns(latency::rdtsc() - sent_tsc.load()) / 1e9);
+    }
+    double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    running = false;
+    signal.notify();
+    consumer.join();
+
+    state.SetLabel(wait::mode_name(mode));
+    state.counters["wake_p50_ns"] = histogram.percentile(50);
+    state.counters["wake_p99_ns"] = histogram.percentile(99);
+    state.counters["consumer_cpu_%"] = 100.0 * consumer_cpu_seconds / wall_seconds;
+}
+BENCHMARK(BM_WakeupLatency)
+    ->Arg(static_cast<int>(wait::Mode::BUSY_SPIN))
+    ->Arg(static_cast<int>(wait::Mode::PAUSE_SPIN))
+    ->Arg(static_cast<int>(wait::Mode::SPIN_YIELD))
+    ->Arg(static_cast<int>(wait::Mode::SPIN_PARK))
+    ->UseManualTime();
+
+//BENCHMARK HUB TRANSPORTS: publish-to-receive latency, one 64-byte update in flight at a time
+struct HubUpdate {
+    uint64_t sent_tsc;
+    char payload[56];
+};
+static void report_transport_latency(benchmark::State& state, const latency::Histogram& h) {
+    state.counters["p50_ns"] = h.percentile(50);
+    state.counters["p99_ns"] = h.percentile(99);
+    state.counters["p99.9_ns"] = h.percentile(99.9);
+}
+static void BM_HubTransport_SharedMemory(benchmark::State& state) {
+    const latency::TscClock& tsc = latency::TscClock::instance();
+    shm::ShmPublisher publisher("/lob_hub_bench", 1 << 20);
+    shm::ShmSubscriber subscriber("/lob_hub_bench");
+    latency::Histogram histogram;
+    std::atomic<uint64_t> received{0};
+    std::atomic<bool> running{true};
+
+    std::thread consumer([&]() {
+        while (running.load(std::memory_order_relaxed)) {
+            subscriber.poll([&](const char* data, uint32_t) {
+                const HubUpdate* update = reinterpret_cast<const HubUpdate*>(data); // read in place
+                histogram.record(tsc.to_ns(latency::rdtsc() - update->sent_tsc));
+                received.fetch_add(1, std::memory_order_release);
+            });
+        }
+    });
+
+    HubUpdate update{};
+    uint64_t sent = 0;
+    for (auto _ : state) {
+        update.sent_tsc = latency::rdtsc();
+        publisher.send(&update, sizeof(update));
+        sent++;
+        while (received.load(std::memory_order_acquire) < sent)
+            std::this_thread::yield();
+    }
+    running = false;
+    consumer.join();
+    report_transport_latency(state, histogram);
+}
+static void BM_HubTransport_ZmqTcp(benchmark::State& state) {
+    const latency::TscClock& tsc = latency::TscClock::instance();
+    zmq::context_t context(1);
+    zmq::socket_t publisher(context, ZMQ_PUB);
+    publisher.bind("tcp://127.0.0.1:5557");
+    zmq::socket_t subscriber(context, ZMQ_SUB);
+    subscriber.connect("tcp://127.0.0.1:5557");
+    subscriber.setsockopt(ZMQ_SUBSCRIBE, "", 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200)); // let the subscription propagate
+    latency::Histogram histogram;
+    std::atomic<uint64_t> received{0};
+    std::atomic<bool> running{true};
+
+    std::thread consumer([&]() {
+        while (running.load(std::memory_order_relaxed)) {
+            zmq::message_t message;
+            if (!subscriber.recv(&message, ZMQ_DONTWAIT))
+                continue;
+            std::string update_str(static_cast<char*>(message.data()), message.size());
+            const HubUpdate* update = reinterpret_cast<const HubUpdate*>(update_str.data());
+            histogram.record(tsc.to_ns(latency::rdtsc() - update->sent_tsc));
+            received.fetch_add(1, std::memory_order_release);
+        }
+    });
+
+    HubUpdate update{};
+    uint64_t sent = 0;
+    for (auto _ : state) {
+        update.sent_tsc = latency::rdtsc();
+        zmq::message_t message(sizeof(update));
+        memcpy(message.data(), &update, sizeof(update));
+        publisher.send(message);
+        sent++;
+        while (received.load(std::memory_order_acquire) < sent)
+            std::this_thread::yield();
+    }
+    running = false;
+    consumer.join();
+    report_transport_latency(state, histogram);
+}
+BENCHMARK(BM_HubTransport_SharedMemory);
+BENCHMARK(BM_HubTransport_ZmqTcp);
+
+//BENCHMARK HUB WIRE FORMAT: encode on the hub + decode on the subscriber, text vs fixed-layout binary
+static void BM_HubUpdate_TextString(benchmark::State& state) {
+    double bid = 10.01, offer = 10.02;
+    char buffer[128];
+    for (auto _ : state) {
+        // hub: update = lob.get_update()
+        std::ostringstream out;
+        out << 7 << "|" << bid << "|" << 100 << "|" << offer << "|" << 200;
+        std::string update = out.str();
+        memcpy(buffer, update.data(), update.size());
+        // subscriber: std::string update_str(data, size), then parse
+        std::string update_str(buffer, update.size());
+        std::istringstream in(update_str);
+        std::string field;
+        double parsed[5];
+        for (int i = 0; i < 5 && std::getline(in, field, '|'); ++i)
+            parsed[i] = std::stod(field);
+        benchmark::DoNotOptimize(parsed);
+        bid += 0.01;
+    }
+}
+static void BM_HubUpdate_BinaryInPlace(benchmark::State& state) {
+    double bid = 10.01, offer = 10.02;
+    alignas(8) char buffer[128];
+    uint64_t sequence = 0;
+    for (auto _ : state) {
+        wire::BboUpdate update;
+        wire::init_header(update, 7, ++sequence, 0);
+        update.bid_price = wire::to_wire_price(bid);
+        update.bid_quantity = 100;
+        update.offer_price = wire::to_wire_price(offer);
+        update.offer_quantity = 200;
+        memcpy(buffer, &update, sizeof(update));
+        benchmark::ClobberMemory();
+        wire::BboUpdate copy;
+        const wire::BboUpdate* received = wire::message_cast<wire::BboUpdate>(buffer, sizeof(update), copy);
+        benchmark::DoNotOptimize(received->bid_price + received->offer_price);
+        bid += 0.01;
+    }
+}
+BENCHMARK(BM_HubUpdate_TextString);
+BENCHMARK(BM_HubUpdate_BinaryInPlace);
+
+//BENCHMARK HUB PUBLISH PATH: per-message allocation vs pooled zero-copy buffers vs multipart batches.
+//A subscriber drains in the background; cpu_ns_per_msg is process CPU time (both threads + zmq I/O).
+static double process_cpu_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+// What the hub did before: a fresh zmq::message_t (malloc + free) for every update
+struct CopyingPublisher {
+    zmq::context_t context;
+    zmq::socket_t socket;
+    explicit CopyingPublisher(const std::string& endpoint) : context(1), socket(context, ZMQ_PUB) {
+        socket.bind(endpoint);
+    }
+    bool send(const void* data, size_t size) {
+        zmq::message_t message(size);
+        memcpy(message.data(), data, size);
+        return socket.send(message);
+    }
+    void flush() {}
+};
+template <typename Publisher, typename Publish>
+static void run_hub_publish(benchmark::State& state, const char* endpoint, Publish&& publish) {
+    Publisher publisher(endpoint);
+    zmq::context_t context(1);
+    zmq::socket_t subscriber(context, ZMQ_SUB);
+    subscriber.connect(endpoint);
+    subscriber.setsockopt(ZMQ_SUBSCRIBE, "", 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200)); // let the subscription propagate
+    std::atomic<bool> running{true};
+    std::thread consumer([&]() {
+        zmq::message_t message;
+        while (running.load(std::memory_order_relaxed))
+            subscriber.recv(&message, ZMQ_DONTWAIT);
+    });
+
+    wire::BboUpdate update{};
+    wire::init_header(update, 7, 0, 0);
+    double cpu_start = process_cpu_ns();
+    for (auto _ : state) {
+        update.header.sequence++;
+        publish(publisher, update);
+    }
+    publisher.flush();
+    double cpu_ns = process_cpu_ns() - cpu_start;
+    running = false;
+    consumer.join();
+    state.SetItemsProcessed(state.iterations());
+    state.counters["cpu_ns_per_msg"] = cpu_ns / state.iterations();
+}
+static void BM_HubPublish_CopyPerMessage(benchmark::State& state) {
+    run_hub_publish<CopyingPublisher>(state, "tcp://127.0.0.1:5558",
+                                      [](CopyingPublisher& publisher, const wire::BboUpdate& update) {
+                                          publisher.send(&update, sizeof(update));
+                                      });
+}
+static void BM_HubPublish_PooledZeroCopy(benchmark::State& state) {
+    run_hub_publish<hub_transport::ZmqTransport>(state, "tcp://127.0.0.1:5559",
+                                                 [](hub_transport::ZmqTransport& publisher, const wire::BboUpdate& update) {
+                                                     publisher.send(&update, sizeof(update));
+                                                 });
+}
+static void BM_HubPublish_PooledBatched(benchmark::State& state) {
+    run_hub_publish<hub_transport::ZmqTransport>(state, "tcp://127.0.0.1:5560",
+                                                 [](hub_transport::ZmqTransport& publisher, const wire::BboUpdate& update) {
+                                                     publisher.queue(&update, sizeof(update));
+                                                 });
+}
+BENCHMARK(BM_HubPublish_CopyPerMessage);
+BENCHMARK(BM_HubPublish_PooledZeroCopy);
+BENCHMARK(BM_HubPublish_PooledBatched);
+
+//BENCHMARK HUB TOPIC FILTERING: subscriber CPU for a desk that needs 10 of 5,000 symbols, either
+//subscribed to everything and discarding in process (arg 0) or subscribed by topic prefix (arg 1)
+static double thread_cpu_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+static void BM_HubSubscriberCpu(benchmark::State& state) {
+    const uint32_t NUM_SYMBOLS = 5000;
+    const uint32_t DESK_SYMBOLS = 10; // symbols 0..9, symbol 0 also carries the stop message
+    const bool filtered = state.range(0) != 0;
+    zmq::context_t context(1);
+    zmq::socket_t publisher(context, ZMQ_PUB);
+    publisher.setsockopt(ZMQ_SNDHWM, 0); // no drops: every message must reach the subscriber
+    publisher.bind("tcp://127.0.0.1:5561");
+    zmq::socket_t subscriber(context, ZMQ_SUB);
+    subscriber.setsockopt(ZMQ_RCVHWM, 0);
+    subscriber.connect("tcp://127.0.0.1:5561");
+    if (filtered) {
+        for (uint32_t symbol_id = 0; symbol_id < DESK_SYMBOLS; symbol_id++) {
+            wire::Topic topic = wire::make_topic(symbol_id);
+            subscriber.setsockopt(ZMQ_SUBSCRIBE, topic.bytes, topic.size);
+        }
+    } else {
+        subscriber.setsockopt(ZMQ_SUBSCRIBE, "", 0);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200)); // let the subscriptions propagate
+
+    std::atomic<double> subscriber_cpu_ns{0};
+    std::atomic<uint64_t> processed{0};
+    std::thread consumer([&]() {
+        double cpu_start = thread_cpu_ns();
+        uint64_t count = 0;
+        while (true) {
+            zmq::message_t message;
+            subscriber.recv(&message);
+            wire::BboUpdate copy;
+            const wire::BboUpdate* update = wire::message_cast<wire::BboUpdate>(message.data(), message.size(), copy);
+            if (update == nullptr)
+                continue;
+            if (update->header.sequence == UINT64_MAX)
+                break;
+            if (update->header.symbol_id >= DESK_SYMBOLS)
+                continue; // not ours
+            benchmark::DoNotOptimize(update->bid_price);
+            count++;
+        }
+        processed = count;
+        subscriber_cpu_ns = thread_cpu_ns() - cpu_start;
+    });
+
+    wire::BboUpdate update{};
+    uint64_t sequence = 0;
+    for (auto _ : state) {
+        wire::init_header(update, static_cast<uint32_t>(sequence % NUM_SYMBOLS), sequence, 0);
+        sequence++;
+        zmq::message_t message(sizeof(update));
+        memcpy(message.data(), &update, sizeof(update));
+        publisher.send(message);
+    }
+    wire::init_header(update, 0, UINT64_MAX, 0);
+    zmq::message_t stop(sizeof(update));
+    memcpy(stop.data(), &update, sizeof(update));
+    publisher.send(stop);
+    consumer.join();
+    state.SetItemsProcessed(state.iterations());
+    state.counters["sub_cpu_ns_per_published"] = subscriber_cpu_ns / state.iterations();
+    state.counters["desk_updates"] = processed.load();
+}
+BENCHMARK(BM_HubSubscriberCpu)->Arg(0)->Arg(1)->Iterations(500000);
+
+//BENCHMARK HUB LOOP: book change to subscriber latency and hub CPU per update, polling the top of
+//book (arg 0) vs draining the notifying book's change queue, busy spinning (arg 1) or parking (arg 2).
+//The writer leaves a 20us quiet gap between updates, which is where a polling hub burns its core.
+static void BM_HubLoop(benchmark::State& state) {
+    const int mode = static_cast<int>(state.range(0));
+    cpu_set_t writer_cpu;
+    CPU_ZERO(&writer_cpu);
+    CPU_SET(1, &writer_cpu); // the hub pins itself to CPU 0
+    sched_setaffinity(0, sizeof(writer_cpu), &writer_cpu);
+
+    const latency::TscClock& tsc = latency::TscClock::instance();
+    circular_array::LimitOrderBook plain_book(2, _LOB_DEPTH);
+    notifying::NotifyingLimitOrderBook notifying_book(2, _LOB_DEPTH);
+    circular_array::LimitOrderBook& book = mode == 0 ? plain_book : notifying_book;
+    typedef messaging_hub<hub_transport::ShmTransport> ShmHub;
+    std::unique_ptr<ShmHub> hub(mode == 0 ? new ShmHub(plain_book, nullptr, 7, "/lob_hub_loop_bench")
+                                          : new ShmHub(notifying_book, nullptr, 7, "/lob_hub_loop_bench"));
+    hub->set_wait_strategy(wait::WaitStrategy(mode == 2 ? wait::Mode::SPIN_PARK : wait::Mode::BUSY_SPIN, 1000));
+    shm::ShmSubscriber subscriber("/lob_hub_loop_bench");
+    book.add_order(circular_array::Order(1, 10.01, 100), true);
+    book.add_order(circular_array::Order(2, 10.02, 100), false);
+
+    double hub_cpu_ns = 0;
+    std::thread hub_thread([&]() {
+        double cpu_start = thread_cpu_ns();
+        hub->run();
+        hub_cpu_ns = thread_cpu_ns() - cpu_start;
+    });
+
+    latency::Histogram histogram;
+    int id = 3;
+    for (auto _ : state) {
+        uint64_t start = latency::rdtsc();
+        int quantity = id; // a new best bid quantity every time, so the update is unambiguous
+        book.add_order(circular_array::Order(id++, 10.01, quantity), true);
+        bool seen = false;
+        while (!seen) {
+            subscriber.poll([&](const char* data, uint32_t length) {
+                wire::BboUpdate copy;
+                const wire::BboUpdate* bbo = wire::message_cast<wire::BboUpdate>(data, length, copy);
+                if (bbo && bbo->bid_quantity == quantity)
+                    seen = true;
+            });
+        }
+        histogram.record(tsc.to_ns(latency::rdtsc() - start));
+        state.PauseTiming();
+        uint64_t quiet_until = latency::rdtsc() + static_cast<uint64_t>(20000 * tsc.cycles_per_ns());
+        while (latency::rdtsc() < quiet_until)
+            wait::cpu_relax();
+        state.ResumeTiming();
+    }
+    hub->stop();
+    hub_thread.join();
+    state.SetItemsProcessed(state.iterations());
+    report_transport_latency(state, histogram);
+    state.counters["hub_cpu_ns_per_update"] = hub_cpu_ns / state.iterations();
+}
+BENCHMARK(BM_HubLoop)->Arg(0)->Arg(1)->Arg(2)->Iterations(20000);
+
+//BENCHMARK ORDER QUEUES: N producers push 64-byte orders while one consumer drains; the old
+//mutex-wrapped std::queue against the lock-free MPSC and MPMC queues
+struct QueuedOrder {
+    int64_t id;
+    char payload[56];
+};
+struct MutexQueue {
+    std::queue<QueuedOrder> q;
+    std::mutex mtx;
+    explicit MutexQueue(size_t) {}
+    bool try_push(const QueuedOrder& order) {
+        std::lock_guard<std::mutex> lock(mtx);
+        q.push(order);
+        return true;
+    }
+    bool try_pop(QueuedOrder& order) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (q.empty())
+            return false;
+        order = q.front();
+        q.pop();
+        return true;
+    }
+};
+template <typename Queue>
+static void BM_OrderQueueContention(benchmark::State& state) {
+    const int producers = static_cast<int>(state.range(0));
+    const int64_t ORDERS_PER_PRODUCER = 100000;
+    for (auto _ : state) {
+        Queue queue(1 << 14);
+        std::atomic<bool> go{false};
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; p++) {
+            threads.emplace_back([&]() {
+                while (!go.load(std::memory_order_acquire))
+                    wait::cpu_relax();
+                QueuedOrder order{};
+                for (int64_t i = 0; i < ORDERS_PER_PRODUCER; i++) {
+                    order.id = i;
+                    while (!queue.try_push(order))
+                        wait::cpu_relax();
+                }
+            });
+        }
+        go.store(true, std::memory_order_release);
+        QueuedOrder order;
+        int64_t received = 0;
+        while (received < producers * ORDERS_PER_PRODUCER) {
+            if (queue.try_pop(order)) {
+                benchmark::DoNotOptimize(order.id);
+                received++;
+            }
+        }
+        for (std::thread& t : threads)
+            t.join();
+    }
+    state.SetItemsProcessed(state.iterations() * producers * ORDERS_PER_PRODUCER);
+}
+BENCHMARK_TEMPLATE(BM_OrderQueueContention, MutexQueue)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_OrderQueueContention, queues::MpscQueue<QueuedOrder>)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_OrderQueueContention, queues::MpmcQueue<QueuedOrder>)->RangeMultiplier(2)->Range(1, 16)->UseRealTime();
+
+//BENCHMARK DISRUPTOR PIPELINE: feed -> book -> strategy -> risk -> EMS over one ring, one event in
+//flight at a time; per-stage and end-to-end latency, busy spinning (arg 0) or spin-yield (arg 2)
+static void BM_TradingPipeline(benchmark::State& state) {
+    circular_array::LimitOrderBook book(2, _LOB_DEPTH);
+    uint64_t executed = 0;
+    auto strategy = [](const pipeline::MarketEvent& event, circular_array::Order& child, bool& child_is_bid) {
+        if (event.update.quantity % 4 != 0)
+            return false;
+        child = event.best_offer;
+        child.quantity = 100;
+        child_is_bid = true;
+        return true;
+    };
+    auto risk = [](const circular_array::Order& child, bool) { return child.quantity <= 1000; };
+    auto execution = [&executed](const circular_array::Order&, bool) { executed++; };
+    std::unique_ptr<pipeline::TradingPipeline<decltype(strategy), decltype(risk), decltype(execution)>> trading(
+        new pipeline::TradingPipeline<decltype(strategy), decltype(risk), decltype(execution)>(
+            book, strategy, risk, execution, wait::WaitStrategy(static_cast<wait::Mode>(state.range(0)))));
+    trading->publish(circular_array::Order(1, 10.02, 100), false, wire::DepthAction::NEW);
+    trading->start();
+
+    int id = 2;
+    for (auto _ : state) {
+        int64_t sequence = trading->publish(circular_array::Order(id, 10.01, id), true, wire::DepthAction::NEW);
+        id++;
+        while (trading->completed() < sequence)
+            wait::cpu_relax();
+    }
+    trading->stop();
+    state.SetItemsProcessed(state.iterations());
+    for (int stage = 1; stage < pipeline::STAGE_COUNT; stage++) {
+        const latency::Histogram& h = trading->stage_latency(static_cast<pipeline::StageId>(stage));
+        std::string name = pipeline::stage_name(static_cast<pipeline::StageId>(stage));
+        state.counters[name + "_p50_ns"] = h.percentile(50);
+        state.counters[name + "_p99_ns"] = h.percentile(99);
+    }
+    report_transport_latency(state, trading->end_to_end_latency());
+    state.counters["orders_sent"] = executed;
+}
+BENCHMARK(BM_TradingPipeline)
+    ->Arg(static_cast<int>(wait::Mode::BUSY_SPIN))
+    ->Arg(static_cast<int>(wait::Mode::SPIN_YIELD));
+
+//BENCHMARK ORDER UPDATES: ack, partial fill, fill for 10,000 live orders; the former string
+//statuses (copy the order, assign the status, compare strings) vs the typed state machine
+struct StringStatusOrder {
+    int id;
+    std::string status;
+};
+static void BM_OrderUpdates_StringStatus(benchmark::State& state) {
+    const int ORDERS = 10000;
+    const char* statuses[] = {"ack", "partial", "filled"};
+    std::unordered_map<int, StringStatusOrder> active, filled;
+    for (auto _ : state) {
+        for (int id = 0; id < ORDERS; id++)
+            active[id] = StringStatusOrder{id, "new"};
+        for (const char* status : statuses) {
+            for (int id = 0; id < ORDERS; id++) {
+                StringStatusOrder update{id, ""};
+                update.status = status; // ExecutionReport(order, status)
+                auto it = active.find(update.id);
+                if (it != active.end()) {
+                    it->second.status = update.status;
+                    if (update.status == "filled") {
+                        filled[it->first] = it->second;
+                        active.erase(it);
+                    } else if (update.status == "cancelled") {
+                        active.erase(it);
+                    }
+                }
+            }
+        }
+        filled.clear();
+    }
+    state.SetItemsProcessed(state.iterations() * ORDERS * 3);
+}
+static void BM_OrderUpdates_StateMachine(benchmark::State& state) {
+    using namespace order_state;
+    const int ORDERS = 10000;
+    const ExecutionUpdate updates[] = {{0, 10.01, 0, OrderEvent::ACK},
+                                       {0, 10.01, 40, OrderEvent::FILL},
+                                       {0, 10.01, 60, OrderEvent::FILL}};
+    std::unordered_map<int64_t, OrderRecord> active, filled;
+    for (auto _ : state) {
+        for (int id = 0; id < ORDERS; id++)
+            active[id] = make_order(id, 10.01, 100, true);
+        for (ExecutionUpdate update : updates) {
+            for (int id = 0; id < ORDERS; id++) {
+                update.order_id = id;
+                auto it = active.find(update.order_id);
+                if (it != active.end() && apply(it->second, update)) {
+                    if (it->second.state == OrderState::FILLED) {
+                        filled[it->first] = it->second;
+                        active.erase(it);
+                    } else if (is_terminal(it->second.state)) {
+                        active.erase(it);
+                    }
+                }
+            }
+        }
+        filled.clear();
+    }
+    state.SetItemsProcessed(state.iterations() * ORDERS * 3);
+}
+BENCHMARK(BM_OrderUpdates_StringStatus);
+BENCHMARK(BM_OrderUpdates_StateMachine);
+
+
+//BENCHMARK ORDER STORE: per-operation latency with N live orders (1M, 10M). Every iteration sends a
+//new order, looks up a random live one and fills the oldest, so the live set stays at N.
+struct UnorderedMapStore {
+    std::unordered_map<int64_t, order_state::OrderRecord> active, filled;
+    explicit UnorderedMapStore(size_t) {}
+    bool insert(const order_state::OrderRecord& order) { return active.emplace(order.id, order).second; }
+    order_state::OrderRecord* find(int64_t id) {
+        auto it = active.find(id);
+        return it == active.end() ? nullptr : &it->second;
+    }
+    bool archive(int64_t id) {
+        auto it = active.find(id);
+        if (it == active.end())
+            return false;
+        filled[id] = it->second;
+        active.erase(it);
+        return true;
+    }
+};
+struct FlatOrderStore : order_store::OrderStore {
+    explicit FlatOrderStore(size_t live) : order_store::OrderStore(live) {}
+    bool insert(const order_state::OrderRecord& order) { return order_store::OrderStore::insert(order) != nullptr; }
+};
+template <typename Store>
+static void BM_OrderStoreChurn(benchmark::State& state) {
+    const int64_t LIVE = state.range(0);
+    const latency::TscClock& tsc = latency::TscClock::instance();
+    std::unique_ptr<Store> store(new Store(static_cast<size_t>(LIVE) + 1));
+    for (int64_t id = 0; id < LIVE; id++)
+        store->insert(order_state::make_order(id, 10.01, 100, true));
+    latency::Histogram histogram;
+    int64_t oldest = 0, next_id = LIVE;
+    uint64_t seed = 7;
+    for (auto _ : state) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        int64_t lookup = oldest + static_cast<int64_t>((seed >> 33) % static_cast<uint64_t>(LIVE));
+        uint64_t start = latency::rdtsc();
+        store->insert(order_state::make_order(next_id++, 10.01, 100, true));
+        order_state::OrderRecord* order = store->find(lookup);
+        benchmark::DoNotOptimize(order);
+        store->archive(oldest++);
+        histogram.record(tsc.to_ns(latency::rdtsc() - start));
+    }
+    state.SetItemsProcessed(state.iterations() * 3);
+    report_transport_latency(state, histogram);
+}
+BENCHMARK_TEMPLATE(BM_OrderStoreChurn, UnorderedMapStore)->Arg(1000000)->Arg(10000000)->Iterations(2000000);
+BENCHMARK_TEMPLATE(BM_OrderStoreChurn, FlatOrderStore)->Arg(1000000)->Arg(10000000)->Iterations(2000000);
+
+
+//BENCHMARK ORDER JOURNAL: events/sec the OMS thread can journal. Mapped segments synced in the
+//background vs one write(2) per event (which still leaves fsync to someone).
+static void BM_JournalAppend(benchmark::State& state) {
+    const char* directory = "/tmp/lob_journal_bench";
+    journal::remove_journal(directory);
+    std::unique_ptr<journal::OrderJournal> log(new journal::OrderJournal(directory));
+    order_state::ExecutionUpdate update{0, 10.01, 1, order_state::OrderEvent::FILL};
+    for (auto _ : state) {
+        update.order_id++;
+        benchmark::DoNotOptimize(log->append_update(update));
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["stalled_rotations"] = log->stalled_rotations();
+    log.reset();
+    journal::remove_journal(directory);
+}
+static void BM_JournalWriteSyscall(benchmark::State& state) {
+    const char* path = "/tmp/lob_journal_bench_write.log";
+    int fd = open(path, O_CREAT | O_WRONLY | O_TRUNC | O_APPEND, 0644);
+    journal::JournalRecord record{};
+    record.type = journal::RecordType::EXECUTION_UPDATE;
+    record.update = order_state::ExecutionUpdate{0, 10.01, 1, order_state::OrderEvent::FILL};
+    for (auto _ : state) {
+        record.update.order_id++;
+        record.sequence++;
+        record.checksum = journal::checksum(record);
+        benchmark::DoNotOptimize(write(fd, &record, sizeof(record)));
+    }
+    state.SetItemsProcessed(state.iterations());
+    close(fd);
+    unlink(path);
+}
+BENCHMARK(BM_JournalAppend);
+BENCHMARK(BM_JournalWriteSyscall);
+
+
+//BENCHMARK OMS COLD START: 5M open orders plus 100k execution reports since, restored into an
+//OMS-sized store by replaying the whole journal (arg 0) or mapping a snapshot and replaying the
+//tail (arg 1). The files are in the page cache, so this is the restart cost, not disk reads.
+static void BM_OmsColdStart(benchmark::State& state) {
+    const bool use_snapshot = state.range(0) == 1;
+    const char* directory = "/tmp/lob_snapshot_bench";
+    const int64_t OPEN_ORDERS = 5000000, TAIL = 100000;
+    journal::remove_journal(directory);
+    unlink(snapshot::snapshot_path(directory).c_str());
+    {
+        uint64_t next_sequence = 1;
+        if (use_snapshot) {
+            mkdir(directory, 0755);
+            order_store::OrderStore live(OPEN_ORDERS);
+            for (int64_t id = 0; id < OPEN_ORDERS; id++)
+                live.insert(order_state::make_order(id, 10.01, 100, true));
+            snapshot::write_snapshot(directory, live, OPEN_ORDERS);
+            next_sequence = OPEN_ORDERS + 1;
+        }
+        journal::OrderJournal log(directory, next_sequence);
+        if (!use_snapshot)
+            for (int64_t id = 0; id < OPEN_ORDERS; id++)
+                log.append_order(order_state::make_order(id, 10.01, 100, true));
+        for (int64_t i = 0; i < TAIL; i++)
+            log.append_update(order_state::ExecutionUpdate{i * 37 % OPEN_ORDERS, 10.01, 0, order_state::OrderEvent::ACK});
+    }
+    size_t restored = 0;
+    for (auto _ : state) {
+        order_store::OrderStore store(10000000); // OMS_MAX_LIVE_ORDERS
+        snapshot::RestartResult result = snapshot::restart(directory, store);
+        restored = store.size();
+        benchmark::DoNotOptimize(result);
+    }
+    state.counters["orders"] = restored;
+    journal::remove_journal(directory);
+    unlink(snapshot::snapshot_path(directory).c_str());
+}
+BENCHMARK(BM_OmsColdStart)->Arg(0)->Arg(1)->Iterations(3)->Unit(benchmark::kMillisecond);
+
+
+//BENCHMARK FIX ENCODER: ns per NewOrderSingle, patching the session template in place vs
+//formatting the whole message with snprintf and summing every byte for the CheckSum
+static void BM_FixEncode_Template(benchmark::State& state) {
+    fix::NewOrderSingleEncoder encoder("OMS", "VENUE", "LOB");
+    order_state::OrderRecord order = order_state::make_order(1, 10.01, 100, true);
+    uint64_t now = fix::wall_clock_ns(), seq = 1;
+    for (auto _ : state) {
+        order.id++;
+        order.price += 0.0001;
+        now += 1000;
+        benchmark::DoNotOptimize(encoder.encode(order, seq++, now));
+        benchmark::DoNotOptimize(encoder.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+static void BM_FixEncode_Snprintf(benchmark::State& state) {
+    char body[256], message[256];
+    order_state::OrderRecord order = order_state::make_order(1, 10.01, 100, true);
+    uint64_t now = fix::wall_clock_ns(), seq = 1;
+    for (auto _ : state) {
+        order.id++;
+        order.price += 0.0001;
+        now += 1000;
+        time_t seconds = static_cast<time_t>(now / 1000000000);
+        tm utc;
+        gmtime_r(&seconds, &utc);
+        char timestamp[32];
+        size_t stamp = strftime(timestamp, sizeof(timestamp), "%Y%m%d-%H:%M:%S", &utc);
+        snprintf(timestamp + stamp, sizeof(timestamp) - stamp, ".%03u", static_cast<unsigned>(now / 1000000 % 1000));
+        int body_length = snprintf(body, sizeof(body),
+                                   "35=D\00134=%llu\00149=OMS\00152=%s\00156=VENUE\00111=%lld\00155=LOB\00154=%c\001"
+                                   "60=%s\00138=%d\00140=2\00144=%.4f\00159=0\001",
+                                   static_cast<unsigned long long>(seq++), timestamp, static_cast<long long>(order.id),
+                                   order.is_bid ? '1' : '2', timestamp, order.quantity, order.price);
+        int length = snprintf(message, sizeof(message), "8=FIX.4.4\0019=%d\001%s", body_length, body);
+        unsigned sum = 0;
+        for (int i = 0; i < length; i++)
+            sum += static_cast<unsigned char>(message[i]);
+        length += snprintf(message + length, sizeof(message) - length, "10=%03u\001", sum % 256);
+        benchmark::DoNotOptimize(length);
+        benchmark::DoNotOptimize(message);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FixEncode_Template);
+BENCHMARK(BM_FixEncode_Snprintf);
+
+
+//BENCHMARK VENUE ROUTER: ns to split one parent order across 10-50 venues, one venue requoting
+//between routes. Flat venue table vs collecting candidates in a vector and std::sort.
+struct RoutedVenue {
+    std::string name;
+    double ask, ask_size, fee, fill_rate;
+};
+static void BM_VenueRoute_FlatTable(benchmark::State& state) {
+    const int venues = static_cast<int>(state.range(0));
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<> ask(10.00, 10.05), size(0, 500), fee(-0.002, 0.003), fill(0.3, 1.0);
+    routing::VenueRouter router;
+    for (int v = 0; v < venues; v++) {
+        router.add_venue(fee(gen), fill(gen));
+        router.update_quote(v, 9.99, 100, ask(gen), size(gen));
+    }
+    routing::ChildOrder children[routing::MAX_VENUES];
+    order_state::OrderRecord parent = order_state::make_order(1, 10.03, 2000, true);
+    int requote = 0;
+    for (auto _ : state) {
+        router.update_quote(requote, 9.99, 100, ask(gen), size(gen));
+        requote = (requote + 1) % venues;
+        benchmark::DoNotOptimize(router.route(parent, children));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+static void BM_VenueRoute_SortedVector(benchmark::State& state) {
+    const int venues = static_cast<int>(state.range(0));
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<> ask(10.00, 10.05), size(0, 500), fee(-0.002, 0.003), fill(0.3, 1.0);
+    std::vector<RoutedVenue> table;
+    for (int v = 0; v < venues; v++)
+        table.push_back(RoutedVenue{"VENUE" + std::to_string(v), ask(gen), size(gen), fee(gen), fill(gen)});
+    const double limit = 10.03, quantity = 2000;
+    int requote = 0;
+    for (auto _ : state) {
+        table[requote].ask = ask(gen);
+        table[requote].ask_size = size(gen);
+        requote = (requote + 1) % venues;
+        std::vector<RoutedVenue> candidates;
+        for (const RoutedVenue& venue : table)
+            if (venue.ask_size > 0 && venue.ask <= limit)
+                candidates.push_back(venue);
+        std::sort(candidates.begin(), candidates.end(), [](const RoutedVenue& a, const RoutedVenue& b) {
+            return a.ask + a.fee < b.ask + b.fee;
+        });
+        std::vector<std::pair<std::string, double>> children;
+        double remaining = quantity;
+        for (const RoutedVenue& venue : candidates) {
+            if (remaining <= 0)
+                break;
+            double take = std::min(remaining, std::floor(venue.ask_size * venue.fill_rate));
+            children.emplace_back(venue.name, take);
+            remaining -= take;
+        }
+        benchmark::DoNotOptimize(children.data());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_VenueRoute_FlatTable)->Arg(10)->Arg(20)->Arg(50);
+BENCHMARK(BM_VenueRoute_SortedVector)->Arg(10)->Arg(20)->Arg(50);
+
+
+//BENCHMARK THROTTLE: ns per outbound message decision, submit + dispatch on one of 8 sessions
+//of 4 venues. Arg 0: tokens always available. Arg 1: limits far below the flow, so dispatches
+//find no token and submits find the session queues full of cancels and new orders.
+static void BM_ThrottleDecision(benchmark::State& state) {
+    const bool saturated = state.range(0) == 1;
+    throttle::OrderThrottle limiter(64);
+    uint64_t now = latency::rdtsc();
+    for (int v = 0; v < 4; v++) {
+        int venue = limiter.add_venue(saturated ? 1000 : 0, 50, now);
+        limiter.add_session(venue, saturated ? 500 : 0, 20, now);
+        limiter.add_session(venue, saturated ? 500 : 0, 20, now);
+    }
+    order_state::OrderRecord order = order_state::make_order(1, 10.01, 100, true);
+    size_t sent = 0, refused = 0;
+    auto send = [&](int, throttle::Priority, const order_state::OrderRecord&) { sent++; };
+    int session = 0;
+    for (auto _ : state) {
+        order.id++;
+        throttle::Priority priority = (order.id & 7) == 0 ? throttle::Priority::CANCEL : throttle::Priority::NEW;
+        refused += limiter.submit(session, priority, order) == throttle::SubmitResult::FULL;
+        session = (session + 1) & 7;
+        benchmark::DoNotOptimize(limiter.dispatch(latency::rdtsc(), send));
+    }
+    state.counters["sent"] = static_cast<double>(sent);
+    state.counters["refused"] = static_cast<double>(refused);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ThrottleDecision)->Arg(0)->Arg(1);
+
+
+//BENCHMARK PRE-TRADE CHECKS: ns per order for all six checks, orders spread over 1 account
+//(hot in L1) or 100k accounts (the account lines mostly miss cache). Accepted orders are
+//cancelled right away so the exposure stays inside the limits.
+static void BM_PreTradeCheck(benchmark::State& state) {
+    const uint32_t accounts = static_cast<uint32_t>(state.range(0));
+    pretrade::PreTradeChecker checker(accounts, 1, accounts);
+    pretrade::Limits limits;
+    limits.max_order_quantity = 1000;
+    limits.max_open_orders = 100;
+    limits.max_notional = 1e6;
+    limits.collar = 0.5;
+    limits.max_position = 100000;
+    for (uint32_t a = 0; a < accounts; a++)
+        checker.set_limits(a, limits);
+    checker.update_reference(0, wire::to_wire_price(10.00), wire::to_wire_price(10.01));
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<uint32_t> account(0, accounts - 1);
+    std::uniform_int_distribution<int> ticks(900, 1100), quantity(1, 1100);
+    const size_t ORDERS = 1 << 16;
+    std::vector<std::pair<uint32_t, order_state::OrderRecord>> orders;
+    for (size_t i = 0; i < ORDERS; i++)
+        orders.emplace_back(account(gen), order_state::make_order(i, ticks(gen) / 100.0, quantity(gen), gen() & 1));
+    const order_state::ExecutionUpdate cancelled{0, 0.0, 0, order_state::OrderEvent::CANCEL_ACK};
+    size_t i = 0, accepted = 0;
+    for (auto _ : state) {
+        const std::pair<uint32_t, order_state::OrderRecord>& next = orders[i++ & (ORDERS - 1)];
+        uint32_t failed = checker.check(next.first, next.second, latency::rdtsc());
+        benchmark::DoNotOptimize(failed);
+        if (failed == 0) {
+            checker.on_execution(next.first, next.second, cancelled);
+            accepted++;
+        }
+    }
+    state.counters["accepted"] = static_cast<double>(accepted) / state.iterations();
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PreTradeCheck)->Arg(1)->Arg(100000);
+
+
+//BENCHMARK POSITION REMARK: us to mark 10k positions to new prices and total the PnL and
+//exposures. Per-symbol columns vs a hash map of position structs.
+struct MappedPosition {
+    double quantity, average_cost, mark, unrealized;
+};
+static std::vector<std::vector<double>> remark_prices(size_t symbols) {
+    std::mt19937 gen(17);
+    std::uniform_real_distribution<> price(5.0, 500.0);
+    std::vector<std::vector<double>> marks(2, std::vector<double>(symbols));
+    for (std::vector<double>& set : marks)
+        for (double& mark : set)
+            mark = price(gen);
+    return marks;
+}
+static void BM_PositionRemark_Columns(benchmark::State& state) {
+    const size_t symbols = state.range(0);
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<int> quantity(-5000, 5000);
+    positions::PositionBook book(symbols);
+    for (uint32_t s = 0; s < symbols; s++)
+        book.load(s, quantity(gen), 100.0);
+    std::vector<std::vector<double>> marks = remark_prices(symbols);
+    size_t round = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(book.remark(marks[round++ & 1].data()).unrealized_pnl);
+    }
+    state.SetItemsProcessed(state.iterations() * symbols);
+}
+static void BM_PositionRemark_MapOfStructs(benchmark::State& state) {
+    const size_t symbols = state.range(0);
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<int> quantity(-5000, 5000);
+    std::unordered_map<uint32_t, MappedPosition> book;
+    for (uint32_t s = 0; s < symbols; s++)
+        book[s] = MappedPosition{static_cast<double>(quantity(gen)), 100.0, 0.0, 0.0};
+    std::vector<std::vector<double>> marks = remark_prices(symbols);
+    size_t round = 0;
+    for (auto _ : state) {
+        const std::vector<double>& prices = marks[round++ & 1];
+        double unrealized = 0.0, net = 0.0, gross = 0.0;
+        for (auto& entry : book) {
+            MappedPosition& position = entry.second;
+            position.mark = prices[entry.first];
+            position.unrealized = position.quantity * (position.mark - position.average_cost);
+            unrealized += position.unrealized;
+            net += position.quantity * position.mark;
+            gross += std::fabs(position.quantity) * position.mark;
+        }
+        benchmark::DoNotOptimize(unrealized + net + gross);
+    }
+    state.SetItemsProcessed(state.iterations() * symbols);
+}
+BENCHMARK(BM_PositionRemark_Columns)->Arg(10000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_PositionRemark_MapOfStructs)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+
+//BENCHMARK VAR: full Monte Carlo revaluation of 1000 positions over 10k scenarios (ms, on all
+//cores through TBB) vs the what-if VaR of one more order from the cached scenario PnL (us)
+struct VarFixture {
+    static const size_t SYMBOLS = 1000, SCENARIOS = 10000;
+    std::vector<double> quantities, marks;
+    std::unique_ptr<var::MonteCarloScenarios> model;
+    VarFixture() : quantities(SYMBOLS), marks(SYMBOLS) {
+        std::mt19937 gen(23);
+        std::uniform_real_distribution<> beta(0.5, 1.5), volatility(0.01, 0.04), price(5.0, 500.0);
+        std::uniform_int_distribution<int> quantity(-1000, 1000);
+        std::vector<double> betas(SYMBOLS), volatilities(SYMBOLS);
+        for (size_t s = 0; s < SYMBOLS; s++) {
+            betas[s] = beta(gen) * 0.01;
+            volatilities[s] = volatility(gen);
+            quantities[s] = quantity(gen);
+            marks[s] = price(gen);
+        }
+        model.reset(new var::MonteCarloScenarios(betas, volatilities, SCENARIOS, 7));
+    }
+};
+static void BM_VarRevalue_MonteCarlo(benchmark::State& state) {
+    VarFixture fixture;
+    var::VarEngine engine(*fixture.model);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(engine.revalue(fixture.quantities.data(), fixture.marks.data()).value_at_risk);
+    state.SetItemsProcessed(state.iterations() * VarFixture::SYMBOLS * VarFixture::SCENARIOS);
+}
+static void BM_VarWhatIf_MonteCarlo(benchmark::State& state) {
+    VarFixture fixture;
+    var::VarEngine engine(*fixture.model);
+    engine.revalue(fixture.quantities.data(), fixture.marks.data());
+    uint32_t symbol = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(engine.what_if(symbol, 100, fixture.marks[symbol]).value_at_risk);
+        symbol = (symbol + 1) % VarFixture::SYMBOLS;
+    }
+}
+BENCHMARK(BM_VarRevalue_MonteCarlo)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_VarWhatIf_MonteCarlo)->Unit(benchmark::kMicrosecond);
+
+
+//BENCHMARK RISK MONITOR: ns per price tick on a 10k position portfolio, the quote applied and
+//every limit checked. Incremental (the symbol, the running totals, a max tree for the largest
+//position) vs rescanning all positions for the exposures on every tick.
+static void risk_monitor_portfolio(positions::PositionBook& book) {
+    std::mt19937 gen(29);
+    std::uniform_int_distribution<int> quantity(-1000, 1000);
+    for (uint32_t s = 0; s < book.symbols(); s++) {
+        book.load(s, quantity(gen), 100.0);
+        book.on_quote(s, 99.5, 100.5);
+    }
+}
+static void BM_RiskMonitorTick_Incremental(benchmark::State& state) {
+    positions::PositionBook book(state.range(0));
+    risk_monitor_portfolio(book);
+    monitor::Limits limits;
+    limits.max_symbol_exposure = 1e6;
+    limits.max_gross_exposure = 1e12;
+    limits.max_drawdown = 1e9;
+    limits.max_concentration = 0.5;
+    monitor::RiskMonitor risk(book.symbols(), limits);
+    uint32_t symbol = 0;
+    double move = 0.0;
+    for (auto _ : state) {
+        book.on_quote(symbol, 99.5 + move, 100.5 + move);
+        benchmark::DoNotOptimize(risk.evaluate(symbol, book, 0));
+        symbol = (symbol + 7919) % book.symbols();
+        move = move > 1.0 ? -1.0 : move + 0.01;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+static void BM_RiskMonitorTick_Rescan(benchmark::State& state) {
+    positions::PositionBook book(state.range(0));
+    risk_monitor_portfolio(book);
+    uint32_t symbol = 0;
+    double move = 0.0;
+    for (auto _ : state) {
+        book.on_quote(symbol, 99.5 + move, 100.5 + move);
+        double gross = 0.0, largest = 0.0, unrealized = 0.0;
+        for (uint32_t s = 0; s < book.symbols(); s++) {
+            double exposure = std::fabs(book.quantities()[s]) * book.marks()[s];
+            gross += exposure;
+            largest = std::max(largest, exposure);
+            unrealized += book.position(s).unrealized_pnl;
+        }
+        benchmark::DoNotOptimize(largest / gross + unrealized);
+        symbol = (symbol + 7919) % book.symbols();
+        move = move > 1.0 ? -1.0 : move + 0.01;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RiskMonitorTick_Incremental)->Arg(10000);
+BENCHMARK(BM_RiskMonitorTick_Rescan)->Arg(10000);
+
+
+//BENCHMARK KILL SWITCH: time from the switch to the last cancel sent, for orders working on 4
+//venues. Every cancel is FIX-encoded; the session queues hold 4096, far fewer than the orders.
+//Arg 1 is each venue's limit in messages per second, 0 for none: what is left of the time then
+//is the walk of the working orders, the throttle and the encoding.
+static void BM_KillSwitchCancelAll(benchmark::State& state) {
+    const int64_t orders = state.range(0);
+    const double rate = static_cast<double>(state.range(1));
+    const int VENUES = 4;
+    std::vector<std::unique_ptr<fix::OrderCancelRequestEncoder>> sessions;
+    for (int v = 0; v < VENUES; v++)
+        sessions.emplace_back(new fix::OrderCancelRequestEncoder("OMS", "VENUE" + std::to_string(v), "LOB"));
+    uint64_t seq = 1, bytes = 0;
+    auto send = [&](int venue, throttle::Priority, const order_state::OrderRecord& order) {
+        bytes += sessions[venue]->encode(order, seq, seq, 1700000000000000000ULL);
+        seq++;
+    };
+    for (auto _ : state) {
+        state.PauseTiming();
+        kill::WorkingOrders working(orders);
+        throttle::OrderThrottle limiter(4096);
+        uint64_t now = latency::rdtsc();
+        for (int v = 0; v < VENUES; v++)
+            limiter.add_session(limiter.add_venue(rate, 100, now), 0, 1, now);
+        for (int64_t id = 0; id < orders; id++)
+            working.add(static_cast<int>(id % VENUES),
+                        order_state::make_order(routing::child_order_id(id, id % VENUES), 100.0, 100, id & 1));
+        kill::KillSwitch killSwitch;
+        state.ResumeTiming();
+
+        killSwitch.engage(latency::rdtsc());
+        limiter.discard(throttle::Priority::NEW);
+        kill::cancel_all(working, limiter, [&] { limiter.dispatch(latency::rdtsc(), send); });
+        while (!limiter.idle())
+            limiter.dispatch(latency::rdtsc(), send);
+    }
+    state.counters["bytes"] = static_cast<double>(bytes);
+    state.SetItemsProcessed(state.iterations() * orders);
+}
+BENCHMARK(BM_KillSwitchCancelAll)->Args({100000, 0})->Args({100000, 1000000})->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
 
 BENCHMARK_MAIN();
 #endif
\ No newline at end of file
@@ -10,6 +10,8 @@
 
 #include "exploring_circular_array.hpp"
 #include "lockfree_limitorderbook.hpp"
+#include "latency_tracer.hpp"
+#include "wait_strategy.hpp"
 
 using namespace circular_array;
 using namespace lockfree;
@@ -17,7 +19,8 @@ using namespace lockfree;
 class MyFIXApplication : public FIX::Application, public FIX::MessageCracker
 {
 public:
-    MyFIXApplication(circular_array::LimitOrderBook& lob) : orderBook(lob) {}
+    MyFIXApplication(circular_array::LimitOrderBook& lob, wait::WakeSignal* bookUpdates = nullptr)
+        : orderBook(lob), bookUpdates(bookUpdates) {}
 
     void onCreate(const FIX::SessionID&) override {}
     void onLogon(const FIX::SessionID& sessionID) override {}
@@ -28,10 +31,12 @@ public:
     void fromAdmin(const FIX::Message&, const FIX::SessionID&) override {}
     void fromApp(const FIX::Message& message, const FIX::SessionID& session) override
     {
+        TRACE_SCOPE(latency::Stage::FROM_APP);
         crack(message, session);
     }
 
     void onMessage(const FIX44::MarketDataIncrementalRefresh& message, const FIX::SessionID&) override {
+        TRACE_SCOPE(latency::Stage::ON_MESSAGE);
         // Loop over all the groups (i.e., all the updates in this message)
         int numUpdates = message.groupCount(FIX::FIELD::NoMDEntries);
         for (int i = 1; i <= numUpdates; ++i) {
@@ -81,7 +86,11 @@ public:
                     break;
             }
         }
+        // Wake up consumers (strategy, hub) waiting for a book change
+        if (bookUpdates)
+            bookUpdates->notify();
     }
 private:
     circular_array::LimitOrderBook& orderBook;
+    wait::WakeSignal* bookUpdates;
 };
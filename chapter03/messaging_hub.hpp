@@ -1,24 +1,152 @@
-#include <zmq.hpp>
 #include <string>
+#include <cstring>
+#include <chrono>
 #include <iostream>
-#include "limit_order_book.hpp"
+#include <atomic>
+#include "exploring_circular_array.hpp"
+#include "notifying_limitorderbook.hpp"
+#include "conflation_buffer.hpp"
+#include "wait_strategy.hpp"
+#include "hub_transport.hpp"
+#include "hub_messages.hpp"
 
 // Include the necessary headers for CPU pinning
 #ifdef __linux__
 #include <sched.h>
 #endif
 
-using namespace std;
-
+// Transport is hub_transport::ZmqTransport (TCP) or hub_transport::ShmTransport (same host).
+// Built on a NotifyingLimitOrderBook the hub sleeps until the writer reports changes and
+// publishes from the book's seqlocked snapshot, never reading the book the writer is
+// changing. On a plain LimitOrderBook it falls back to polling the top of book, which reads
+// the book itself: the book must then be written on the hub thread, or not while it runs.
+template <typename Transport = hub_transport::ZmqTransport>
 class messaging_hub {
 private:
-    zmq::context_t context;
-    zmq::socket_t publisher;
-    LimitOrderBook& lob;
+    static const size_t MAX_CHANGES_PER_CYCLE = 1024;
+
+    Transport publisher;
+    circular_array::LimitOrderBook& lob;
+    notifying::NotifyingLimitOrderBook* notifier = nullptr;
+    queues::SpscQueue<notifying::BookChange>* changes = nullptr;
+    // Optional in-process stage: subscribers that only need the latest state drain from here
+    conflation::ConflationBuffer* conflated;
+    uint32_t symbol_id;
+    wait::WakeSignal* bookUpdates = nullptr;
+    wait::WaitStrategy waiter;
+    uint64_t sequence = 0;
+    wire::BboUpdate last_bbo{};
+    std::atomic<bool> running{true};
+
+    static uint64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // Polling only. An empty side is published as price and quantity 0: no quote
+    void read_bbo(wire::BboUpdate& update) {
+        circular_array::Order best_bid{}, best_offer{};
+        lob.get_depth(true, &best_bid, 1); // leaves it zeroed when the side is empty
+        lob.get_depth(false, &best_offer, 1);
+        update.bid_price = wire::to_wire_price(best_bid.price);
+        update.bid_quantity = best_bid.quantity;
+        update.offer_price = wire::to_wire_price(best_offer.price);
+        update.offer_quantity = best_offer.quantity;
+    }
+
+    // From the notifying book's snapshot, where an empty side is a zeroed level already
+    static void snapshot_bbo(const conflation::MarketSnapshot& snapshot, wire::BboUpdate& update) {
+        update.bid_price = wire::to_wire_price(snapshot.best_bid().price);
+        update.bid_quantity = snapshot.best_bid().quantity;
+        update.offer_price = wire::to_wire_price(snapshot.best_offer().price);
+        update.offer_quantity = snapshot.best_offer().quantity;
+    }
+
+    static bool same_top(const wire::BboUpdate& a, const wire::BboUpdate& b) {
+        return a.bid_price == b.bid_price && a.bid_quantity == b.bid_quantity &&
+               a.offer_price == b.offer_price && a.offer_quantity == b.offer_quantity;
+    }
+
+    void queue_delta(const notifying::BookChange& change, uint64_t now) {
+        wire::DepthDelta delta{};
+        wire::init_header(delta, symbol_id, ++sequence, now);
+        delta.price = wire::to_wire_price(change.price);
+        delta.quantity = change.quantity;
+        delta.side = change.is_bid ? wire::Side::BID : wire::Side::OFFER;
+        delta.action = change.action;
+        publisher.queue(&delta, sizeof(delta));
+    }
+
+    // Polling only
+    void publish_snapshot() {
+        circular_array::Order levels[conflation::DEPTH_LEVELS];
+        conflation::MarketSnapshot snapshot{};
+        snapshot.symbol_id = symbol_id;
+        snapshot.bid_levels = lob.get_depth(true, levels, conflation::DEPTH_LEVELS);
+        for (int i = 0; i < snapshot.bid_levels; i++)
+            snapshot.bids[i] = {levels[i].price, levels[i].quantity};
+        snapshot.offer_levels = lob.get_depth(false, levels, conflation::DEPTH_LEVELS);
+        for (int i = 0; i < snapshot.offer_levels; i++)
+            snapshot.offers[i] = {levels[i].price, levels[i].quantity};
+        conflated->publish(snapshot);
+    }
 
 public:
-    MessagingHub(LimitOrderBook& lob) : context(1), publisher(context, ZMQ_PUB), lob(lob) {
-        publisher.bind("tcp://*:5556");
+    messaging_hub(circular_array::LimitOrderBook& lob, conflation::ConflationBuffer* conflated = nullptr, uint32_t symbol_id = 0,
+                  const std::string& endpoint = Transport::DEFAULT_ENDPOINT)
+        : publisher(endpoint), lob(lob), conflated(conflated), symbol_id(symbol_id) {}
+
+    messaging_hub(notifying::NotifyingLimitOrderBook& book, conflation::ConflationBuffer* conflated = nullptr,
+                  uint32_t symbol_id = 0, const std::string& endpoint = Transport::DEFAULT_ENDPOINT)
+        : publisher(endpoint), lob(book), notifier(&book), changes(&book.change_queue()), conflated(conflated),
+          symbol_id(symbol_id), bookUpdates(&book.change_signal()) {}
+
+    // How run() idles between book changes; signal is the feed handler's book update signal
+    // (a notifying book already brings its own)
+    void set_wait_strategy(wait::WaitStrategy strategy, wait::WakeSignal* signal = nullptr) {
+        waiter = strategy;
+        if (signal)
+            bookUpdates = signal;
+    }
+
+    // Metrics hook, e.g. shared-memory consumer lag via transport().consumer_stats()
+    const Transport& transport() const { return publisher; }
+
+    // One publish cycle covering every change since the previous one: a depth delta per book
+    // change, then a single top of book, sent as one batch. Returns the number of changes
+    // covered, 0 when there was nothing to publish.
+    size_t publish_cycle() {
+        uint64_t now = now_ns();
+        size_t covered = 0;
+        wire::BboUpdate update;
+        conflation::MarketSnapshot snapshot;
+        if (notifier) {
+            covered = changes->drain([&](const notifying::BookChange& change) { queue_delta(change, now); },
+                                     MAX_CHANGES_PER_CYCLE);
+            if (covered == 0)
+                return 0;
+            // Taken after the drain: at least as recent as every delta in the batch
+            notifier->read_snapshot(snapshot);
+            snapshot.symbol_id = symbol_id;
+            snapshot_bbo(snapshot, update);
+        } else {
+            read_bbo(update);
+            if (same_top(update, last_bbo))
+                return 0;
+            covered = 1;
+        }
+        wire::init_header(update, symbol_id, ++sequence, now);
+        publisher.queue(&update, sizeof(update));
+        publisher.flush();
+        last_bbo = update;
+        // Overwrite the latest state; never waits on slow consumers
+        if (conflated) {
+            if (notifier)
+                conflated->publish(snapshot);
+            else
+                publish_snapshot();
+        }
+        return covered;
     }
 
     void run() {
@@ -28,13 +156,24 @@ public:
         CPU_SET(0, &cpuset);  // CPU 0
         sched_setaffinity(0, sizeof(cpu_set_t), &cpuset);
 
-        while (true) {
-            if (lob.has_changed()) {
-                string update = lob.get_update();
-                zmq::message_t message(update.size());
-                memcpy(message.data(), update.data(), update.size());
-                publisher.send(message);
+        uint32_t idle = 0;
+        while (running.load(std::memory_order_relaxed)) {
+            if (changes) {
+                waiter.wait_until([&]() { return !changes->empty() || !running.load(std::memory_order_relaxed); },
+                                  bookUpdates);
+                publish_cycle();
+            } else if (publish_cycle()) {
+                idle = 0;
+            } else {
+                waiter.idle(idle++);
             }
         }
     }
+
+    // Makes run() return after its current cycle
+    void stop() {
+        running.store(false, std::memory_order_relaxed);
+        if (bookUpdates)
+            bookUpdates->notify();
+    }
 };
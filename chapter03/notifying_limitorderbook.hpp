@@ -0,0 +1,102 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include "exploring_circular_array.hpp"
+#include "conflation_buffer.hpp"
+#include "lockfree_queue.hpp"
+#include "wait_strategy.hpp"
+#include "hub_messages.hpp"
+
+namespace notifying
+{
+    // One book mutation as seen by the hub
+    struct BookChange {
+        double price;
+        int quantity;
+        bool is_bid;
+        wire::DepthAction action;
+    };
+
+    // Book that tells its readers what changed instead of making them poll. The writer thread
+    // pushes every change into an SPSC queue and bumps a WakeSignal; the hub drains the queue.
+    // After each change the writer also copies the top DEPTH_LEVELS of each side into a
+    // seqlocked snapshot, so readers never touch the book itself. A full queue never blocks
+    // the writer: the change is counted as overflow and the snapshot still shows its result.
+    class NotifyingLimitOrderBook : public circular_array::LimitOrderBook {
+    private:
+        queues::SpscQueue<BookChange> changes;
+        wait::WakeSignal updates;
+        std::atomic<uint64_t> overflow{0};
+        alignas(64) std::atomic<uint64_t> snapshot_seq{0}; // seqlock: odd while the writer copies
+        conflation::MarketSnapshot latest{};
+
+        void capture() {
+            circular_array::Order levels[conflation::DEPTH_LEVELS];
+            conflation::MarketSnapshot snapshot{};
+            snapshot.bid_levels = get_depth(true, levels, conflation::DEPTH_LEVELS);
+            for (int i = 0; i < snapshot.bid_levels; i++)
+                snapshot.bids[i] = {levels[i].price, levels[i].quantity};
+            snapshot.offer_levels = get_depth(false, levels, conflation::DEPTH_LEVELS);
+            for (int i = 0; i < snapshot.offer_levels; i++)
+                snapshot.offers[i] = {levels[i].price, levels[i].quantity};
+            uint64_t seq = snapshot_seq.load(std::memory_order_relaxed);
+            snapshot_seq.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(&latest, &snapshot, sizeof(snapshot));
+            snapshot_seq.store(seq + 2, std::memory_order_release);
+        }
+
+        // Only a change the book applied is reported: a discarded price changed nothing
+        bool notify(bool applied, const circular_array::Order& order, bool is_bid, wire::DepthAction action) {
+            if (!applied)
+                return false;
+            capture();
+            if (!changes.try_push(BookChange{order.price, order.quantity, is_bid, action}))
+                overflow.fetch_add(1, std::memory_order_relaxed);
+            updates.notify();
+            return true;
+        }
+
+    public:
+        static const size_t DEFAULT_QUEUE_CAPACITY = 1 << 16;
+
+        NotifyingLimitOrderBook(int precision, int depth, size_t queue_capacity = DEFAULT_QUEUE_CAPACITY)
+            : circular_array::LimitOrderBook(precision, depth), changes(queue_capacity) {}
+
+        bool add_order(const circular_array::Order& order, bool is_bid) override {
+            return notify(circular_array::LimitOrderBook::add_order(order, is_bid), order, is_bid,
+                          wire::DepthAction::NEW);
+        }
+
+        bool update_order(const circular_array::Order& order, bool is_bid) override {
+            return notify(circular_array::LimitOrderBook::update_order(order, is_bid), order, is_bid,
+                          wire::DepthAction::CHANGE);
+        }
+
+        bool delete_order(const circular_array::Order& order, bool is_bid) override {
+            return notify(circular_array::LimitOrderBook::delete_order(order, is_bid), order, is_bid,
+                          wire::DepthAction::DELETE);
+        }
+
+        // Any thread: the book as of the writer's last applied change (symbol_id left 0).
+        // Returns its version, 0 before the first change.
+        uint64_t read_snapshot(conflation::MarketSnapshot& out) const {
+            while (true) {
+                uint64_t before = snapshot_seq.load(std::memory_order_acquire);
+                if (before & 1)
+                    continue; // writer in progress
+                std::memcpy(&out, &latest, sizeof(out));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (snapshot_seq.load(std::memory_order_relaxed) == before)
+                    return before / 2;
+            }
+        }
+
+        // Consumer side, one reader thread only
+        queues::SpscQueue<BookChange>& change_queue() { return changes; }
+        wait::WakeSignal& change_signal() { return updates; }
+        uint64_t overflowed_changes() const { return overflow.load(std::memory_order_relaxed); }
+    };
+
+} // namespace notifying
@@ -4,175 +4,637 @@
 #include <queue>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <zmq.hpp>
+#include "conflation_buffer.hpp"
+#include "wait_strategy.hpp"
+#include "shm_ring.hpp"
+#include "hub_messages.hpp"
+#include "lockfree_queue.hpp"
+#include "order_state.hpp"
+#include "order_store.hpp"
+#include "order_journal.hpp"
+#include "order_snapshot.hpp"
+#include "fix_encoder.hpp"
+#include "venue_router.hpp"
+#include "throttle.hpp"
+#include "pretrade_risk.hpp"
+#include "kill_switch.hpp"
+#include <sys/socket.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
 
 using namespace std;
+
+// Order record: typed state plus fill/leaves quantities, see order_state.hpp
+typedef order_state::OrderRecord Order;
+
+// One outbound FIX session: NewOrderSingles and OrderCancelRequests are patched into the
+// session's templates (see fix_encoder.hpp) and written to the session socket once connected.
+// Several EMS threads may send to the same venue; the session lock keeps MsgSeqNum in send order.
 class FIXEngine
 {
+    // Class scope: other headers bring a circular_array::Order into the global namespace
+    typedef order_state::OrderRecord Order;
+
+    fix::NewOrderSingleEncoder newOrder;
+    fix::OrderCancelRequestEncoder cancelRequest;
+    uint64_t nextSeqNum = 1;
+    // Cancel requests need a ClOrdID of their own, above any order id the OMS hands out
+    uint64_t nextCancelId = 1000000000000000000ULL;
+    int sessionSocket = -1;
+    std::atomic_flag sending = ATOMIC_FLAG_INIT;
+
+    template <typename Encode>
+    bool Send(Encode&& encode){
+        while (sending.test_and_set(std::memory_order_acquire))
+            wait::cpu_relax();
+        const char* data = nullptr;
+        size_t length = encode(data);
+        bool sent = length != 0; // 0: a value does not fit its FIX field
+        if (sent) {
+            nextSeqNum++;
+            if (sessionSocket >= 0)
+                sent = ::send(sessionSocket, data, length, MSG_NOSIGNAL) == static_cast<ssize_t>(length);
+        }
+        sending.clear(std::memory_order_release);
+        return sent;
+    }
+
     public:
-    void SendOrder (const Order& order){}
+    FIXEngine(const std::string& senderCompId = "OMS", const std::string& targetCompId = "VENUE",
+              const std::string& symbol = "LOB")
+        : newOrder(senderCompId, targetCompId, symbol), cancelRequest(senderCompId, targetCompId, symbol) {}
+
+    void Connect(int socket) { sessionSocket = socket; }
+
+    bool SendOrder (const Order& order){
+        return Send([&](const char*& data) {
+            data = newOrder.data();
+            return newOrder.encode(order, nextSeqNum, fix::wall_clock_ns());
+        });
+    }
+
+    bool CancelOrder(const Order& order){
+        return Send([&](const char*& data) {
+            data = cancelRequest.data();
+            size_t length = cancelRequest.encode(order, nextCancelId, nextSeqNum, fix::wall_clock_ns());
+            nextCancelId += length != 0;
+            return length;
+        });
+    }
 };
 
-// Order class
-struct Order {
-    int id;
-    string status;
-    // Add other order details
+// Bounded lock-free queues, see lockfree_queue.hpp
+const size_t ORDER_QUEUE_CAPACITY = 1 << 16;
+
+// Queues are sized for bursts: a full one means the consumer is stuck, so spin rather than drop
+template <typename Queue, typename T>
+void push_blocking(Queue& queue, const T& value) {
+    while (!queue.try_push(value))
+        wait::cpu_relax();
+}
+
+// Pending messages per venue session waiting for a rate token, see throttle.hpp
+const size_t EMS_THROTTLE_QUEUE_CAPACITY = 4096;
+// Child orders working at the venues that a kill can cancel, see kill_switch.hpp
+const size_t EMS_MAX_WORKING_ORDERS = 1 << 20;
+
+class OMS;
+
+// A quote of one venue for the router, see EMS::UpdateQuote
+struct VenueQuote {
+    int32_t venue;
+    double bid;
+    double bid_quantity;
+    double ask;
+    double ask_quantity;
 };
 
-// High performance queue
-template <typename T>
-class UpdatesQueue {
+// EMS class
+class EMS {
+public:
+    typedef order_state::OrderRecord Order;
+
 private:
-    queue<T> q;
-    mutex mtx;
+    // A child order to cancel at the venue it was sent to
+    struct VenueCancel {
+        int32_t venue;
+        Order order;
+    };
+
+    // Any strategy or OMS thread may send or cancel, one EMS thread routes and paces
+    queues::MpmcQueue<Order> orderQueue{ORDER_QUEUE_CAPACITY};
+    queues::MpmcQueue<VenueCancel> cancelQueue{ORDER_QUEUE_CAPACITY};
+    // Venue i of the router is sessions[i] and throttle session i; all set up before orders flow
+    routing::VenueRouter router;
+    std::vector<std::unique_ptr<FIXEngine>> sessions;
+    throttle::OrderThrottle rateLimits{EMS_THROTTLE_QUEUE_CAPACITY};
+    // Execution reports for child orders, from the sessions; the EMS thread keeps workingOrders
+    queues::MpmcQueue<order_state::ExecutionUpdate> executionQueue{ORDER_QUEUE_CAPACITY};
+    // Venue quotes from the market data threads, applied to the router on the EMS thread
+    queues::MpmcQueue<VenueQuote> quoteQueue{ORDER_QUEUE_CAPACITY};
+    // Told about parent orders that never reach a venue, see AttachOms
+    OMS* oms = nullptr;
+    kill::WorkingOrders workingOrders{EMS_MAX_WORKING_ORDERS};
+    kill::KillSwitch killSwitch;
+    kill::CancelSweep killCancels;  // resumed by every ProcessOrderQueue while halted
+    bool halted = false;            // the EMS thread has acted on the switch
+    uint64_t refusedOrders = 0;     // dropped because trading was halted
+    uint64_t untrackedOrders = 0;   // sent with the working order table full: a kill misses them
+    uint64_t unroutedOrders = 0;    // no venue had liquidity for them
+
+    void Transmit(int venue, throttle::Priority priority, const Order& order) {
+        if (priority == throttle::Priority::CANCEL)
+            sessions[venue]->CancelOrder(order);
+        else if (sessions[venue]->SendOrder(order) && !workingOrders.add(venue, order))
+            untrackedOrders++;
+    }
+
+    void Dispatch() {
+        rateLimits.dispatch(latency::rdtsc(), [&](int venue, throttle::Priority priority, const Order& child) {
+            Transmit(venue, priority, child);
+        });
+    }
+
+    // A full session queue means the venue limit is far below the order flow: wait for tokens
+    // rather than drop the message
+    void Submit(int venue, throttle::Priority priority, const Order& order) {
+        while (rateLimits.submit(venue, priority, order) == throttle::SubmitResult::FULL) {
+            Dispatch();
+            wait::cpu_relax();
+        }
+    }
+
+    // The parent order goes nowhere: its sender gets a reject, defined after OMS
+    void RejectParent(const Order& parent);
+
+    // New orders still waiting for a token never leave; every working order gets a cancel,
+    // ahead of anything else the sessions send from now on. The cancels are submitted as the
+    // session queues take them, over as many ProcessOrderQueue passes as it takes, so the
+    // reports that arrive meanwhile are still applied.
+    void Halt() {
+        halted = true;
+        refusedOrders += rateLimits.discard(throttle::Priority::NEW);
+        killCancels.start(workingOrders);
+    }
+
 public:
-    void push(T order) {
-        lock_guard<mutex> lock(mtx);
-        q.push(order);
+    // False once trading is halted
+    bool SendOrder(const Order& order) {
+        if (killSwitch.engaged())
+            return false;
+        // Keep it on queue
+        push_blocking(orderQueue, order);
+        return true;
+    }
+    // order is the child order as sent to venue, see routing::child_order_id
+    void CancelOrder(int venue, const Order& order) {
+        push_blocking(cancelQueue, VenueCancel{venue, order});
+    }
+    // For child orders, from any session thread
+    void ExecutionReport(const order_state::ExecutionUpdate& update) {
+        push_blocking(executionQueue, update);
     }
-    T pop() {
-        lock_guard<mutex> lock(mtx);
-        T val = q.front();
-        q.pop();
-        return val;
+    // Any thread, e.g. a market data thread: the router sees it from the next ProcessOrderQueue
+    void UpdateQuote(int venue, double bid, double bidQuantity, double ask, double askQuantity) {
+        push_blocking(quoteQueue, VenueQuote{venue, bid, bidQuantity, ask, askQuantity});
     }
-    bool empty() {
-        lock_guard<mutex> lock(mtx);
-        return q.empty();
+    // Any thread: halts trading and cancels every working order from the next ProcessOrderQueue.
+    // Returns false if it was already thrown.
+    bool Kill() { return killSwitch.engage(latency::rdtsc()); }
+    // Trading resumes; orders refused meanwhile are not sent, and working orders the kill has
+    // not reached yet stay working
+    void Resume() { killSwitch.reset(); }
+    // For OMS::AttachKillSwitch, and for risk checks that throw it directly
+    kill::KillSwitch& Switch() { return killSwitch; }
+    // Returns the venue index for quote and statistics updates through Router(). Message rates
+    // are the venue's limits for the firm and for this session, with bursts of up to burst
+    // messages; 0 leaves that limit off.
+    int AddVenue(const std::string& targetCompId, const std::string& symbol, double feePerUnit,
+                 double fillRate = 1.0, double slippageRate = 0.0, double rejectionRate = 0.0,
+                 double venueMessagesPerSecond = 0.0, double sessionMessagesPerSecond = 0.0, uint32_t burst = 1) {
+        int venue = router.add_venue(feePerUnit, fillRate, slippageRate, rejectionRate);
+        sessions.emplace_back(new FIXEngine("OMS", targetCompId, symbol));
+        uint64_t now = latency::rdtsc();
+        rateLimits.add_session(rateLimits.add_venue(venueMessagesPerSecond, burst, now), sessionMessagesPerSecond,
+                               burst, now);
+        return venue;
     }
+    // EMS thread only, or before it starts: the router is not synchronized. Quotes from other
+    // threads go through UpdateQuote.
+    routing::VenueRouter& Router() { return router; }
+    // Before orders flow: the OMS gets a reject for every parent order that is not routed
+    void AttachOms(OMS& oms) { this->oms = &oms; }
+    FIXEngine& Session(int venue) { return *sessions[venue]; }
+
+    // Call in a loop from the EMS thread: queued messages go out as their venue's tokens refill
+    void ProcessOrderQueue() {
+        // Reports first: an order filled or cancelled meanwhile is not cancelled again
+        order_state::ExecutionUpdate update;
+        while (executionQueue.try_pop(update))
+            workingOrders.apply(update);
+        VenueQuote quote;
+        while (quoteQueue.try_pop(quote))
+            router.update_quote(quote.venue, quote.bid, quote.bid_quantity, quote.ask, quote.ask_quantity);
+        if (killSwitch.engaged() != halted) {
+            if (halted) {
+                halted = false;
+                killCancels.stop(); // orders sent from now on are not the kill's to cancel
+            } else {
+                Halt();
+            }
+        }
+        if (halted)
+            killCancels.resume(workingOrders, rateLimits);
+        // Cancels first, so one waiting behind its own new order withdraws it instead
+        VenueCancel cancel;
+        while (cancelQueue.try_pop(cancel)) {
+            Order* working = workingOrders.find(cancel.order.id);
+            if (working && !order_state::apply(*working, order_state::ExecutionUpdate{
+                               working->id, 0.0, 0, order_state::OrderEvent::CANCEL_REQUEST}))
+                continue; // already being cancelled, by a kill or an earlier request
+            Submit(cancel.venue, throttle::Priority::CANCEL, cancel.order);
+        }
+        Order order;
+        routing::ChildOrder children[routing::MAX_VENUES];
+        while (orderQueue.try_pop(order)) {
+            if (halted) {
+                refusedOrders++; // queued before the switch was thrown
+                RejectParent(order);
+                continue;
+            }
+            // Split across venues, one child order per venue
+            size_t count = router.route(order, children);
+            if (count == 0) {
+                unroutedOrders++;
+                RejectParent(order);
+                continue;
+            }
+            for (size_t i = 0; i < count; i++) {
+                Order child = order;
+                child.id = routing::child_order_id(order.id, children[i].venue);
+                child.quantity = child.leaves_quantity = children[i].quantity;
+                child.price = children[i].price;
+                Submit(children[i].venue, throttle::Priority::NEW, child);
+            }
+        }
+        Dispatch();
+    }
+
+    uint64_t RefusedOrders() const { return refusedOrders; }
+    uint64_t UntrackedOrders() const { return untrackedOrders; }
+    uint64_t UnroutedOrders() const { return unroutedOrders; }
+    size_t WorkingOrderCount() const { return workingOrders.size(); }
 };
 
+// Live orders the OMS can hold; the store is allocated up front, see order_store.hpp
+const size_t OMS_MAX_LIVE_ORDERS = 10000000;
+// Journal events between two snapshots of the live orders, see order_snapshot.hpp
+const uint64_t OMS_SNAPSHOT_EVERY_EVENTS = 1 << 22;
+// The OMS trades one account; the pre-trade table is per account, see pretrade_risk.hpp
+const uint32_t OMS_ACCOUNT = 0;
+// Symbol ids with a price collar reference and a position, the hub's dense ids
+const size_t OMS_MAX_SYMBOLS = 16384;
+// How often a blocked hub receive wakes up to check for Stop()
+const int OMS_RECEIVE_TIMEOUT_MS = 100;
+
 // OMS class
 class OMS {
+public:
+    typedef order_state::OrderRecord Order;
+
 private:
-    unordered_map<int, Order> activeOrders;
-    unordered_map<int, Order> filledOrders;
-    UpdatesQueue<Order> orderUpdates;
+    // A new order or an execution report: the OMS thread journals and applies them in the order
+    // they were queued, so the journal has a single writer
+    struct Event {
+        journal::RecordType type;
+        union {
+            Order order;
+            order_state::ExecutionUpdate update;
+        };
+    };
+
+    // Active orders by client order id; filled orders go to the store's archive
+    order_store::OrderStore orders{OMS_MAX_LIVE_ORDERS};
+    // Every accepted order and execution report, written before it is applied
+    std::unique_ptr<journal::OrderJournal> journal;
+    // Snapshots are copied on the OMS thread and written and synced on their own thread
+    std::unique_ptr<snapshot::BackgroundCheckpoint> checkpoints;
+    uint64_t snapshotSequence = 0;
+    // Orders and execution reports can arrive from several threads, the OMS thread applies them
+    queues::MpscQueue<Event> orderEvents{ORDER_QUEUE_CAPACITY};
+    uint64_t invalidTransitions = 0;
     zmq::context_t context;
     zmq::socket_t subscriber;
     std::thread marketDataThread;
-    
+    conflation::ConflationBuffer* conflated = nullptr;
+    int consumerId = -1;
+    wait::WaitStrategy waiter;
+    std::unique_ptr<shm::ShmSubscriber> shmSubscriber;
+    wait::WakeSignal updatesSignal;
+    // Limits and exposure the orders are checked against before they leave, OMS thread only;
+    // one position per symbol
+    pretrade::PreTradeChecker preTrade{OMS_ACCOUNT + 1, OMS_MAX_SYMBOLS, OMS_MAX_SYMBOLS};
+    std::atomic<uint32_t> lastRejection{0};
+    std::atomic<uint64_t> rejectedOrders{0};
+    // Usually the EMS's, see AttachKillSwitch
+    const kill::KillSwitch* killSwitch = nullptr;
+    // Where accepted orders go, see AttachEms
+    EMS* ems = nullptr;
+    // Hub BBOs of quoteSymbol are the router's quotes for venue quoteVenue, see FeedVenueQuotes
+    std::atomic<int> quoteVenue{-1};
+    uint32_t quoteSymbol = 0;
+    // The market data loop of the transport this OMS was built for, run by Start()
+    void (OMS::*receive)() = &OMS::ReceiveMarketData;
+    bool started = false;
+    std::atomic<bool> running{true};
+
+    // Setup calls share state with the market data thread and have no synchronization
+    void RequireNotStarted(const char* what) const {
+        if (started)
+            throw std::logic_error(std::string(what) + " after the OMS market data thread started");
+    }
+
     bool order_validation_ok(const Order&o){
-        //do validations
-        
-        return true;
+        uint32_t failed = preTrade.check(OMS_ACCOUNT, o, latency::rdtsc());
+        if (failed != 0) {
+            lastRejection.store(failed, std::memory_order_relaxed);
+            rejectedOrders.fetch_add(1, std::memory_order_relaxed);
+        }
+        return failed == 0;
+    }
+
+    void Enqueue(const Event& event) {
+        push_blocking(orderEvents, event);
+        updatesSignal.notify();
+    }
+
+    // OMS thread
+    void AcceptOrder(const Order& order) {
+        // Thrown since the order was queued: nothing booked, nothing sent
+        if (killSwitch && killSwitch->engaged())
+            return;
+        // Validate order
+        if (!order_validation_ok(order))
+            return;
+
+        // If valid, add to active orders and send to EMS
+        if (!orders.insert(order)) {
+            // duplicate id or store full: the check booked it as open, release it
+            preTrade.on_execution(OMS_ACCOUNT, order, order_state::ExecutionUpdate{order.id, 0.0, 0,
+                                                                                   order_state::OrderEvent::REJECT});
+            rejectedOrders.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (journal)
+            journal->append_order(order);
+        ems->SendOrder(order);
+    }
+
+    // OMS thread: apply the transition and the fill quantities. Filled orders move to the
+    // archive; cancelled, rejected or replaced ones leave the active orders.
+    void ApplyUpdate(const order_state::ExecutionUpdate& update) {
+        if (journal)
+            journal->append_update(update); // replay reproduces invalid reports as well
+        const Order* live = orders.find(update.order_id);
+        Order before = live ? *live : Order();
+        order_store::UpdateResult result = order_store::apply_update(orders, update);
+        if (result == order_store::UpdateResult::INVALID_TRANSITION)
+            invalidTransitions++; // out of order or duplicate report, the order is unchanged
+        else if (result == order_store::UpdateResult::APPLIED)
+            preTrade.on_execution(OMS_ACCOUNT, before, update);
     }
 public:
     OMS() : context(1), subscriber(context, ZMQ_SUB) {
         subscriber.connect("tcp://localhost:5556");
         subscriber.setsockopt(ZMQ_SUBSCRIBE, "", 0);
-        
+        subscriber.setsockopt(ZMQ_RCVTIMEO, OMS_RECEIVE_TIMEOUT_MS); // to notice Stop()
     }
-    OMS() : context(1), subscriber(context, ZMQ_SUB) {
+    // Only the listed symbols: the hub filters on the topic prefix, so updates for other
+    // symbols never reach this process
+    OMS(const std::vector<uint32_t>& symbols) : context(1), subscriber(context, ZMQ_SUB) {
         subscriber.connect("tcp://localhost:5556");
-        subscriber.setsockopt(ZMQ_SUBSCRIBE, "", 0);
-        
-        //launch new thread to read incoming market data messages from the Messaging Hub
-        marketDataThread = std::thread(&OMS::ReceiveMarketData, this);
+        for (uint32_t symbol_id : symbols)
+            Subscribe(wire::make_topic(symbol_id));
+        subscriber.setsockopt(ZMQ_RCVTIMEO, OMS_RECEIVE_TIMEOUT_MS);
+    }
+    // Reads market data from the hub's shared-memory ring instead of TCP
+    OMS(const std::string& shmName, shm::SlowConsumerPolicy policy = shm::SlowConsumerPolicy::DROP_NEWEST)
+        : context(1), subscriber(context, ZMQ_SUB), shmSubscriber(new shm::ShmSubscriber(shmName, policy)),
+          receive(&OMS::ReceiveShmMarketData) {}
+    // maxLiveOrders sizes the order store, allocated here
+    OMS(conflation::ConflationBuffer& buffer, size_t maxLiveOrders = OMS_MAX_LIVE_ORDERS)
+        : orders(maxLiveOrders), context(1), subscriber(context, ZMQ_SUB), conflated(&buffer),
+          receive(&OMS::ReceiveConflatedMarketData) {
+        //drain only the latest state per symbol, at the OMS own pace
+        consumerId = buffer.register_consumer();
     }
 
     ~OMS() {
+        Stop();
         if (marketDataThread.joinable()) {
             marketDataThread.join();
         }
-    }    
+    }
+
+    // After setup (subscriptions, wait strategy): starts the market data thread. Setup calls
+    // made later throw.
+    void Start() {
+        RequireNotStarted("Start");
+        started = true;
+        marketDataThread = std::thread(receive, this);
+    }
+
+    // Any thread: the market data thread and run() return within a receive timeout or a park
+    void Stop() {
+        running.store(false, std::memory_order_relaxed);
+        updatesSignal.notify();
+    }
+
     void ReceiveMarketData() {
-        while (true) {
+        while (running.load(std::memory_order_relaxed)) {
             zmq::message_t update;
-            subscriber.recv(&update);
-            std::string update_str(static_cast<char*>(update.data()), update.size());
-            // Process the update
-            // ...
+            if (subscriber.recv(&update))
+                OnHubMessage(update.data(), update.size());
+        }
+    }
+
+    // Before Start: the market data thread then owns the socket, and a zmq socket must stay on
+    // one thread
+    void Subscribe(const wire::Topic& topic) {
+        RequireNotStarted("Subscribe");
+        subscriber.setsockopt(ZMQ_SUBSCRIBE, topic.bytes, topic.size);
+    }
+
+    // Market data thread, from a hub BBO or a conflated snapshot (prices in wire units): the
+    // price collar follows the top of book, and so do the router's quotes for the fed venue
+    void OnTopOfBook(uint32_t symbolId, int64_t bidPrice, double bidQuantity, int64_t offerPrice, double offerQuantity) {
+        preTrade.update_reference(symbolId, bidPrice, offerPrice);
+        int venue = quoteVenue.load(std::memory_order_acquire);
+        if (venue >= 0 && symbolId == quoteSymbol)
+            ems->UpdateQuote(venue, wire::from_wire_price(bidPrice), bidQuantity, wire::from_wire_price(offerPrice),
+                             offerQuantity);
+    }
+
+    // Hub messages are read in place, see hub_messages.hpp
+    void OnHubMessage(const void* data, size_t size) {
+        wire::MessageHeader headerCopy;
+        const wire::MessageHeader* header = wire::peek_header(data, size, headerCopy);
+        if (header == nullptr)
+            return; // unknown version or truncated
+        switch (header->type) {
+            case wire::MessageType::BBO:
+                wire::BboUpdate bboCopy;
+                if (const wire::BboUpdate* bbo = wire::message_cast<wire::BboUpdate>(data, size, bboCopy))
+                    OnTopOfBook(header->symbol_id, bbo->bid_price, bbo->bid_quantity, bbo->offer_price,
+                                bbo->offer_quantity);
+                break;
+            case wire::MessageType::DEPTH_DELTA:
+            case wire::MessageType::TRADE:
+            case wire::MessageType::ORDER_STATE:
+                // ...
+                break;
         }
     }
 
+    void ReceiveShmMarketData() {
+        uint32_t idle = 0;
+        while (running.load(std::memory_order_relaxed)) {
+            size_t received = shmSubscriber->poll([&](const char* data, uint32_t length) {
+                OnHubMessage(data, length); // in place, no copy out of the ring
+            });
+            if (received)
+                idle = 0;
+            else if (shmSubscriber->disconnected())
+                shmSubscriber->rejoin(); // fell a full ring behind under the DISCONNECT policy
+            else
+                waiter.idle(idle++);
+        }
+    }
+
+    void ReceiveConflatedMarketData() {
+        wait::WakeSignal& updates = conflated->wake_signal();
+        uint32_t idle = 0;
+        while (running.load(std::memory_order_relaxed)) {
+            uint32_t seen = updates.current();
+            size_t delivered = conflated->drain(consumerId, [&](const conflation::MarketSnapshot& snapshot) {
+                // An empty side is a zero level, which the collar refuses to trade against
+                const conflation::PriceLevel bid = snapshot.best_bid();
+                const conflation::PriceLevel offer = snapshot.best_offer();
+                OnTopOfBook(snapshot.symbol_id, wire::to_wire_price(bid.price), bid.quantity,
+                            wire::to_wire_price(offer.price), offer.quantity);
+            });
+            if (delivered)
+                idle = 0;
+            else
+                waiter.idle(idle++, &updates, seen);
+        }
+    }
+
+    // Shared by the market data thread and run(); before Start
+    void SetWaitStrategy(const wait::WaitStrategy& strategy) {
+        RequireNotStarted("SetWaitStrategy");
+        waiter = strategy;
+    }
+
+    conflation::ConsumerMetrics ConflationMetrics() const {
+        return conflated->metrics(consumerId);
+    }
+
     void run(){
         // Pin this thread to the first CPU core
         cpu_set_t cpuset;
         CPU_ZERO(&cpuset);
         CPU_SET(0, &cpuset);
         pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
-        while (true){
-            ProcessOrderUpdates()
+        while (running.load(std::memory_order_relaxed)){
+            waiter.wait_until([&]() { return !orderEvents.empty() || !running.load(std::memory_order_relaxed); },
+                              &updatesSignal);
+            ProcessOrderUpdates();
+            if (journal && journal->last_sequence() - snapshotSequence >= OMS_SNAPSHOT_EVERY_EVENTS)
+                TakeSnapshot();
         }
     }
 
-    bool SendOrder(Order order) {
-        // Validate order
-        if (!order_validation(order))
+    // Any thread. The OMS thread checks, stores, journals and sends the order; false only when
+    // trading is halted or no EMS is attached. Orders the checks refuse are counted, see
+    // RejectedOrders and LastRejection.
+    bool SendOrder(const Order& order) {
+        // Trading halted: refused before the checks book any exposure for it
+        if (ems == nullptr || (killSwitch && killSwitch->engaged()))
             return false;
-        
-        // If valid, add to active orders and send to EMS
-        activeOrders.push_back(order);
-        EMS::SendOrder(order);
-
+        Event event;
+        event.type = journal::RecordType::NEW_ORDER;
+        event.order = order;
+        Enqueue(event);
         return true;
     }
-    void ExecutionReport(const Order& order, const string& status) {
-        // Add order update to queue
-        Order updated_order = order;
-        updated_order.status = status;
-        order_updates.push(updated_order);
+    // Any thread
+    void ExecutionReport(const order_state::ExecutionUpdate& update) {
+        Event event;
+        event.type = journal::RecordType::EXECUTION_UPDATE;
+        event.update = update;
+        Enqueue(event);
     }
+    // OMS thread, see run(): the only caller of the journal and of the pre-trade checks
     void ProcessOrderUpdates() {
-        // Update order status
-        // If filled, move to filled orders
-        // If cancelled, remove from active orders
-        // Otherwise, leave in active orders
-        while (!order_updates.empty()) {
-            Order order = order_updates.front();
-            order_updates.pop();
-            // Update order status
-            auto it = active_orders.find(order.id);
-            if (it != active_orders.end()) {
-                it->second.status = order.status;
-                if (order.status == "filled") {
-                    // Move to filled orders
-                    filled_orders[it->first] = it->second;
-                    active_orders.erase(it);
-                } else if (order.status == "cancelled") {
-                    // Remove from active orders
-                    active_orders.erase(it);
-                }
-            }
-        }
+        orderEvents.drain([&](const Event& event) {
+            if (event.type == journal::RecordType::NEW_ORDER)
+                AcceptOrder(event.order);
+            else
+                ApplyUpdate(event.update);
+        });
     }
 
-    void PersistToDB() {
-        // Persist filled orders to DB
+    uint64_t InvalidTransitions() const { return invalidTransitions; }
+    // OMS thread
+    size_t LiveOrderCount() const { return orders.size(); }
 
-
-        //this function should be called by another thread, 
-        // at defined intervals, to unload filled arrays, 
-        // and have them persist in DB
+    // Before orders flow: the checks reject everything until limits are set
+    void SetRiskLimits(const pretrade::Limits& limits) { preTrade.set_limits(OMS_ACCOUNT, limits); }
+    // pretrade::Failure bits of the last order the checks refused
+    uint32_t LastRejection() const { return lastRejection.load(std::memory_order_relaxed); }
+    // Refused by the checks or by the order store
+    uint64_t RejectedOrders() const { return rejectedOrders.load(std::memory_order_relaxed); }
+    // Before orders flow: once the switch is thrown SendOrder refuses every order
+    void AttachKillSwitch(const kill::KillSwitch& killSwitch) { this->killSwitch = &killSwitch; }
+    // Before orders flow: accepted orders are routed and sent by ems, which reports the ones it
+    // cannot route back here
+    void AttachEms(EMS& ems) {
+        this->ems = &ems;
+        ems.AttachOms(*this);
     }
-
-};
-
-// EMS class
-class EMS {
-private:
-    UpdatesQueue<Order> orderQueue;
-    FIXEngine smart_desicion(const Order& order)
-    {
-        //based on the order and any other logic, 
-        //decide where to send the order.
-        return FIXEngine();
+    // After AttachEms: hub BBOs of symbolId become the router's quotes for venue, the venue whose
+    // book the hub publishes
+    void FeedVenueQuotes(int venue, uint32_t symbolId) {
+        quoteSymbol = symbolId;
+        quoteVenue.store(venue, std::memory_order_release);
     }
 
-public:
-    void SendOrder(const Order& order) {
-        // Keep it on queue
-        orderQueue.push(order);
+    // Restores the active orders from the snapshot and journal in directory, then journals every
+    // new order and execution report there. Call before any order is sent.
+    snapshot::RestartResult OpenJournal(const std::string& directory) {
+        snapshot::RestartResult restarted = snapshot::restart(directory, orders);
+        journal.reset(new journal::OrderJournal(directory, restarted.journal.last_sequence + 1));
+        checkpoints.reset(new snapshot::BackgroundCheckpoint(directory));
+        snapshotSequence = restarted.snapshot.journal_sequence;
+        return restarted;
     }
-    void ProcessOrderQueue() {
-        while (!orderQueue.empty()) {
-            Order order = orderQueue.pop();
-            
-            // Send order to venue
-            FIXEngine venue = smart_decision(order);
-            venue.sendOrder(order);
-        }
+
+    // OMS thread, between two events: a restart then replays only what follows. Only the copy
+    // of the live orders is done here; false while the previous snapshot is still being written.
+    bool TakeSnapshot() {
+        if (!journal || !checkpoints->capture(orders, journal->last_sequence()))
+            return false;
+        snapshotSequence = journal->last_sequence();
+        return true;
     }
-};
\ No newline at end of file
+
+};
+
+inline void EMS::RejectParent(const Order& parent) {
+    if (oms)
+        oms->ExecutionReport(order_state::ExecutionUpdate{parent.id, 0.0, 0, order_state::OrderEvent::REJECT});
+}
@@ -0,0 +1,380 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "lockfree_queue.hpp"
+#include "order_state.hpp"
+#include "order_store.hpp"
+#include "wait_strategy.hpp"
+
+// Append-only write-ahead journal of order events. The OMS thread copies each fixed-size
+// record straight into a memory-mapped, preallocated segment and publishes the record count;
+// a background thread msyncs what was published, retires full segments and prepares the next
+// one, so the order path never makes a syscall. Records carry a sequence and a checksum:
+// recovery replays every intact record and stops at the first torn one.
+namespace journal
+{
+
+const uint64_t JOURNAL_MAGIC = 0x4c4f424a524e4cULL; // "LOBJRNL"
+const uint32_t JOURNAL_VERSION = 2; // 2: orders carry their symbol
+const size_t SEGMENT_DATA_OFFSET = 64;
+
+enum class RecordType : uint8_t { NEW_ORDER = 1, EXECUTION_UPDATE = 2 };
+
+struct SegmentHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t capacity;       // records
+    uint64_t first_sequence; // also in the file name, so segments sort by name
+};
+static_assert(sizeof(SegmentHeader) <= SEGMENT_DATA_OFFSET, "segment header overlaps the records");
+
+struct JournalRecord {
+    uint64_t sequence; // 1-based; 0 is a slot that was never written
+    uint32_t checksum;
+    RecordType type;
+    uint8_t reserved[3];
+    union {
+        order_state::OrderRecord order;
+        order_state::ExecutionUpdate update;
+    };
+};
+static_assert(sizeof(JournalRecord) == 56, "journal records are 56 bytes on disk");
+
+// Over the whole record with the checksum field zeroed (bytes 8-11, low half of word 1)
+inline uint32_t checksum(const JournalRecord& record) {
+    uint64_t words[sizeof(JournalRecord) / 8];
+    std::memcpy(words, &record, sizeof(words));
+    words[1] &= ~uint64_t(0xffffffff);
+    uint64_t h = 0x9e3779b97f4a7c15ULL;
+    for (uint64_t word : words) {
+        h = (h ^ word) * 0xff51afd7ed558ccdULL;
+        h ^= h >> 32;
+    }
+    return static_cast<uint32_t>(h);
+}
+
+inline std::string segment_path(const std::string& directory, uint64_t first_sequence) {
+    char name[48];
+    std::snprintf(name, sizeof(name), "/journal-%020llu.log", static_cast<unsigned long long>(first_sequence));
+    return directory + name;
+}
+
+// Journal segment files in the directory, oldest first
+inline std::vector<std::string> list_segments(const std::string& directory) {
+    std::vector<std::string> paths;
+    DIR* dir = opendir(directory.c_str());
+    if (!dir)
+        return paths;
+    while (dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() > 12 && name.compare(0, 8, "journal-") == 0 && name.compare(name.size() - 4, 4, ".log") == 0)
+            paths.push_back(directory + "/" + name);
+    }
+    closedir(dir);
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+inline uint64_t segment_first_sequence(const std::string& path) {
+    return std::strtoull(path.c_str() + path.rfind("journal-") + 8, nullptr, 10);
+}
+
+// Removes the segments holding nothing after `sequence` (covered by a snapshot). The newest
+// segment always stays, the journal may be writing to it.
+inline void remove_segments_before(const std::string& directory, uint64_t sequence) {
+    std::vector<std::string> paths = list_segments(directory);
+    for (size_t i = 0; i + 1 < paths.size() && segment_first_sequence(paths[i + 1]) <= sequence + 1; i++)
+        unlink(paths[i].c_str());
+}
+
+inline void remove_journal(const std::string& directory) {
+    for (const std::string& path : list_segments(directory))
+        unlink(path.c_str());
+}
+
+// One preallocated, mapped segment file. Written by the OMS thread, synced and destroyed by
+// the journal's background thread.
+class Segment {
+private:
+    char* base = nullptr;
+    size_t bytes;
+    size_t synced_bytes = SEGMENT_DATA_OFFSET; // background thread only
+
+public:
+    const uint64_t first_sequence;
+    const uint64_t capacity;
+    std::atomic<uint64_t> committed{0}; // records the writer has finished
+
+    Segment(const std::string& directory, uint64_t first_sequence, uint64_t capacity)
+        : bytes(SEGMENT_DATA_OFFSET + capacity * sizeof(JournalRecord)), first_sequence(first_sequence),
+          capacity(capacity) {
+        std::string path = segment_path(directory, first_sequence);
+        int fd = open(path.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        // Reserve the blocks now so writes through the mapping never extend the file
+        int err = posix_fallocate(fd, 0, bytes);
+        if (err != 0) {
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), "fallocate " + path);
+        }
+        void* mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+        err = errno;
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+            throw std::system_error(err, std::generic_category(), "mmap " + path);
+        base = static_cast<char*>(mapped);
+        SegmentHeader header{JOURNAL_MAGIC, JOURNAL_VERSION, sizeof(JournalRecord), capacity, first_sequence};
+        std::memcpy(base, &header, sizeof(header));
+        msync(base, SEGMENT_DATA_OFFSET, MS_SYNC);
+        int dir_fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+        if (dir_fd >= 0) { // make the new file name itself durable
+            fsync(dir_fd);
+            ::close(dir_fd);
+        }
+    }
+    ~Segment() { munmap(base, bytes); }
+    Segment(const Segment&) = delete;
+    Segment& operator=(const Segment&) = delete;
+
+    JournalRecord* record(uint64_t index) {
+        return reinterpret_cast<JournalRecord*>(base + SEGMENT_DATA_OFFSET) + index;
+    }
+
+    // msync the pages holding the first `records` records that were not synced yet
+    bool sync(uint64_t records) {
+        size_t end = SEGMENT_DATA_OFFSET + records * sizeof(JournalRecord);
+        if (end <= synced_bytes)
+            return true;
+        size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t start = synced_bytes & ~(page - 1);
+        if (msync(base + start, end - start, MS_SYNC) != 0)
+            return false;
+        synced_bytes = end;
+        return true;
+    }
+};
+
+// Single writer: append_* must always be called from the same thread (the OMS thread).
+class OrderJournal {
+private:
+    std::string directory;
+    uint64_t segment_records;
+    std::chrono::microseconds sync_interval;
+
+    // writer side
+    Segment* active;
+    uint64_t next_sequence;
+    uint64_t rotation_stalls = 0;
+
+    std::atomic<Segment*> current;       // active segment as seen by the background thread
+    std::atomic<Segment*> spare{nullptr}; // next segment, created ahead by the background thread
+    queues::SpscQueue<Segment*> retired{64};
+    uint64_t last_prepared;               // background thread only
+    std::atomic<uint64_t> durable;
+    std::atomic<uint64_t> sync_errors{0};
+    std::atomic<bool> running{true};
+    std::thread syncer;
+
+    void prepare_spare() {
+        Segment* segment = current.load(std::memory_order_acquire);
+        uint64_t first = segment->first_sequence + segment->capacity;
+        if (spare.load(std::memory_order_acquire) || first <= last_prepared)
+            return;
+        try {
+            spare.store(new Segment(directory, first, segment_records), std::memory_order_release);
+            last_prepared = first;
+        } catch (const std::system_error&) {
+            sync_errors.fetch_add(1, std::memory_order_relaxed); // retried next pass
+        }
+    }
+
+    void sync_pass() {
+        Segment* segment;
+        while (retired.try_pop(segment)) {
+            if (!segment->sync(segment->capacity))
+                sync_errors.fetch_add(1, std::memory_order_relaxed);
+            durable.store(segment->first_sequence + segment->capacity - 1, std::memory_order_release);
+            delete segment;
+        }
+        // Retired segments are pushed before current moves on, and only this thread deletes them
+        segment = current.load(std::memory_order_acquire);
+        uint64_t records = segment->committed.load(std::memory_order_acquire);
+        if (!segment->sync(records))
+            sync_errors.fetch_add(1, std::memory_order_relaxed);
+        else if (records > 0 && retired.empty()) // otherwise an older segment is still unsynced
+            durable.store(segment->first_sequence + records - 1, std::memory_order_release);
+    }
+
+    void rotate() {
+        Segment* next;
+        while (!(next = spare.exchange(nullptr, std::memory_order_acq_rel))) {
+            rotation_stalls++; // the writer outran preallocation by a whole segment
+            std::this_thread::yield();
+        }
+        while (!retired.try_push(active))
+            wait::cpu_relax();
+        active = next;
+        current.store(next, std::memory_order_release);
+    }
+
+    uint64_t append(JournalRecord& record) {
+        if (active->committed.load(std::memory_order_relaxed) == active->capacity)
+            rotate();
+        uint64_t index = active->committed.load(std::memory_order_relaxed);
+        record.sequence = next_sequence;
+        record.checksum = checksum(record);
+        std::memcpy(active->record(index), &record, sizeof(record));
+        active->committed.store(index + 1, std::memory_order_release);
+        return next_sequence++;
+    }
+
+public:
+    static const uint64_t DEFAULT_SEGMENT_RECORDS = 1 << 20; // 48MB
+    static const uint32_t DEFAULT_SYNC_INTERVAL_US = 1000;
+
+    // next_sequence continues a recovered journal: RecoveryResult::last_sequence + 1. Segments
+    // starting at or after it hold nothing recovery kept (unused spares, torn tails) and are removed.
+    explicit OrderJournal(const std::string& directory, uint64_t next_sequence = 1,
+                          uint64_t segment_records = DEFAULT_SEGMENT_RECORDS,
+                          uint32_t sync_interval_us = DEFAULT_SYNC_INTERVAL_US)
+        : directory(directory), segment_records(segment_records), sync_interval(sync_interval_us),
+          next_sequence(next_sequence), durable(next_sequence - 1) {
+        if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST)
+            throw std::system_error(errno, std::generic_category(), "mkdir " + directory);
+        for (const std::string& path : list_segments(directory))
+            if (segment_first_sequence(path) >= next_sequence)
+                unlink(path.c_str());
+        active = new Segment(directory, next_sequence, segment_records);
+        current.store(active, std::memory_order_release);
+        last_prepared = next_sequence;
+        prepare_spare();
+        syncer = std::thread([this]() {
+            while (running.load(std::memory_order_relaxed)) {
+                std::this_thread::sleep_for(sync_interval);
+                sync_pass();
+                prepare_spare();
+            }
+        });
+    }
+    // Syncs everything appended so far; the unused spare segment is removed
+    ~OrderJournal() {
+        running.store(false, std::memory_order_relaxed);
+        syncer.join();
+        sync_pass();
+        delete active;
+        if (Segment* unused = spare.load(std::memory_order_acquire)) {
+            std::string path = segment_path(directory, unused->first_sequence);
+            delete unused;
+            unlink(path.c_str());
+        }
+    }
+    OrderJournal(const OrderJournal&) = delete;
+    OrderJournal& operator=(const OrderJournal&) = delete;
+
+    // Both return the record's sequence. The record is durable once durable_sequence() reaches it.
+    uint64_t append_order(const order_state::OrderRecord& order) {
+        JournalRecord record{};
+        record.type = RecordType::NEW_ORDER;
+        record.order = order;
+        return append(record);
+    }
+    uint64_t append_update(const order_state::ExecutionUpdate& update) {
+        JournalRecord record{};
+        record.type = RecordType::EXECUTION_UPDATE;
+        record.update = update;
+        return append(record);
+    }
+
+    uint64_t durable_sequence() const { return durable.load(std::memory_order_acquire); }
+    uint64_t last_sequence() const { return next_sequence - 1; }
+    uint64_t stalled_rotations() const { return rotation_stalls; }
+    uint64_t failed_syncs() const { return sync_errors.load(std::memory_order_relaxed); }
+};
+
+struct RecoveryResult {
+    uint64_t last_sequence = 0; // last intact record, the new journal continues after it
+    uint64_t records = 0;
+    uint64_t segments = 0;
+    uint64_t rejected = 0;      // records the store refused, as it did when they were written
+    bool torn = false;          // a record failed its checksum or broke the sequence
+};
+
+// Rebuilds the order store by replaying every intact record in the directory, in order.
+// after_sequence skips what a snapshot already holds, whole segments without opening them.
+inline RecoveryResult recover(const std::string& directory, order_store::OrderStore& store,
+                              uint64_t after_sequence = 0) {
+    RecoveryResult result;
+    result.last_sequence = after_sequence;
+    std::vector<std::string> paths = list_segments(directory);
+    for (size_t segment = 0; segment < paths.size(); segment++) {
+        const std::string& path = paths[segment];
+        if (segment + 1 < paths.size() && segment_first_sequence(paths[segment + 1]) <= after_sequence + 1)
+            continue;
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        struct stat st;
+        fstat(fd, &st);
+        size_t bytes = static_cast<size_t>(st.st_size);
+        if (bytes < SEGMENT_DATA_OFFSET) {
+            ::close(fd);
+            continue;
+        }
+        void* mapped = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        int err = errno;
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+            throw std::system_error(err, std::generic_category(), "mmap " + path);
+        madvise(mapped, bytes, MADV_SEQUENTIAL);
+
+        const char* base = static_cast<const char*>(mapped);
+        SegmentHeader header;
+        std::memcpy(&header, base, sizeof(header));
+        if (header.magic == JOURNAL_MAGIC && header.version == JOURNAL_VERSION &&
+            header.record_size == sizeof(JournalRecord)) {
+            result.segments++;
+            uint64_t capacity = std::min<uint64_t>(header.capacity, (bytes - SEGMENT_DATA_OFFSET) / sizeof(JournalRecord));
+            const JournalRecord* records = reinterpret_cast<const JournalRecord*>(base + SEGMENT_DATA_OFFSET);
+            for (uint64_t i = 0; i < capacity; i++) {
+                const JournalRecord& record = records[i];
+                if (record.sequence == 0)
+                    break; // end of what was written to this segment
+                if (record.sequence <= after_sequence)
+                    continue;
+                if (record.checksum != checksum(record) ||
+                    (result.last_sequence != 0 && record.sequence != result.last_sequence + 1)) {
+                    result.torn = true;
+                    break;
+                }
+                bool applied = record.type == RecordType::NEW_ORDER
+                                   ? store.insert(record.order) != nullptr
+                                   : order_store::apply_update(store, record.update) == order_store::UpdateResult::APPLIED;
+                if (!applied)
+                    result.rejected++;
+                result.last_sequence = record.sequence;
+                result.records++;
+            }
+        }
+        munmap(mapped, bytes);
+    }
+    return result;
+}
+
+} // namespace journal
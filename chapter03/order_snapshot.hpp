@@ -0,0 +1,257 @@
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "order_journal.hpp"
+#include "order_store.hpp"
+#include "wait_strategy.hpp"
+
+// Point-in-time image of the live orders, tagged with the last journal sequence it contains.
+// A restart maps the snapshot, bulk loads it into the order store and replays only the journal
+// records after that sequence; journal segments fully covered by the snapshot are removed.
+namespace snapshot
+{
+
+const uint64_t SNAPSHOT_MAGIC = 0x4c4f42534e4150ULL; // "LOBSNAP"
+const uint32_t SNAPSHOT_VERSION = 2; // 2: orders carry their symbol
+const size_t SNAPSHOT_DATA_OFFSET = 64;
+const size_t LOAD_PREFETCH_DISTANCE = 16;
+
+struct SnapshotHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t count;
+    uint64_t journal_sequence; // every journal record up to this one is in the snapshot
+    uint64_t checksum;         // over the records
+};
+static_assert(sizeof(SnapshotHeader) <= SNAPSHOT_DATA_OFFSET, "snapshot header overlaps the records");
+
+inline std::string snapshot_path(const std::string& directory) { return directory + "/snapshot.dat"; }
+
+inline uint64_t mix(uint64_t h, const order_state::OrderRecord& order) {
+    uint64_t words[sizeof(order_state::OrderRecord) / 8];
+    std::memcpy(words, &order, sizeof(words));
+    for (uint64_t word : words)
+        h = (h ^ word) * 0x100000001b3ULL;
+    return h;
+}
+
+// Writes a snapshot next to the journal: a temporary file is filled through a mapping by
+// fill(records), which returns how many of at most max_count it wrote, synced, then renamed
+// over the previous snapshot, so a crash leaves either one intact.
+template <typename Fill>
+inline void write_snapshot_with(const std::string& directory, size_t max_count, uint64_t journal_sequence,
+                                Fill&& fill) {
+    std::string path = snapshot_path(directory);
+    std::string temporary = path + ".tmp";
+    size_t bytes = SNAPSHOT_DATA_OFFSET + max_count * sizeof(order_state::OrderRecord);
+    int fd = open(temporary.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0)
+        throw std::system_error(errno, std::generic_category(), "open " + temporary);
+    int err = posix_fallocate(fd, 0, bytes);
+    if (err != 0) {
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), "fallocate " + temporary);
+    }
+    void* mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    err = errno;
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+        throw std::system_error(err, std::generic_category(), "mmap " + temporary);
+
+    char* base = static_cast<char*>(mapped);
+    order_state::OrderRecord* records = reinterpret_cast<order_state::OrderRecord*>(base + SNAPSHOT_DATA_OFFSET);
+    uint64_t count = fill(records), h = 0xcbf29ce484222325ULL;
+    for (uint64_t i = 0; i < count; i++)
+        h = mix(h, records[i]);
+    SnapshotHeader header{SNAPSHOT_MAGIC, SNAPSHOT_VERSION, sizeof(order_state::OrderRecord), count, journal_sequence, h};
+    std::memcpy(base, &header, sizeof(header));
+    bool synced = msync(base, bytes, MS_SYNC) == 0;
+    err = errno;
+    munmap(base, bytes);
+    if (!synced)
+        throw std::system_error(err, std::generic_category(), "msync " + temporary);
+    if (rename(temporary.c_str(), path.c_str()) != 0)
+        throw std::system_error(errno, std::generic_category(), "rename " + temporary);
+    int dir_fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir_fd >= 0) {
+        fsync(dir_fd);
+        ::close(dir_fd);
+    }
+}
+
+// The live orders of store, on the thread that owns it, between two journaled events
+inline void write_snapshot(const std::string& directory, const order_store::OrderStore& store,
+                           uint64_t journal_sequence) {
+    write_snapshot_with(directory, store.size(), journal_sequence, [&](order_state::OrderRecord* records) {
+        size_t count = 0;
+        store.for_each_live([&](const order_state::OrderRecord& order) { records[count++] = order; });
+        return count;
+    });
+}
+
+// count orders copied out of the store earlier, on any thread
+inline void write_snapshot(const std::string& directory, const order_state::OrderRecord* orders, size_t count,
+                           uint64_t journal_sequence) {
+    write_snapshot_with(directory, count, journal_sequence, [&](order_state::OrderRecord* records) {
+        if (count)
+            std::memcpy(records, orders, count * sizeof(order_state::OrderRecord));
+        return count;
+    });
+}
+
+struct SnapshotInfo {
+    uint64_t orders = 0;
+    uint64_t journal_sequence = 0; // 0 when there is no snapshot
+};
+
+// Bulk loads the snapshot into an empty store. A snapshot that fails its checksum throws before
+// anything is inserted: the journal before it may already be gone, so there is nothing to fall
+// back to.
+inline SnapshotInfo load_snapshot(const std::string& directory, order_store::OrderStore& store) {
+    SnapshotInfo info;
+    std::string path = snapshot_path(directory);
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (errno == ENOENT)
+            return info;
+        throw std::system_error(errno, std::generic_category(), "open " + path);
+    }
+    struct stat st;
+    fstat(fd, &st);
+    size_t bytes = static_cast<size_t>(st.st_size);
+    void* mapped = bytes >= SNAPSHOT_DATA_OFFSET ? mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0)
+                                                 : MAP_FAILED;
+    int err = errno;
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+        throw std::system_error(err, std::generic_category(), "mmap " + path);
+
+    const char* base = static_cast<const char*>(mapped);
+    SnapshotHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    if (header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION ||
+        header.record_size != sizeof(order_state::OrderRecord) ||
+        header.count > (bytes - SNAPSHOT_DATA_OFFSET) / sizeof(order_state::OrderRecord) ||
+        header.count > store.capacity() - store.size()) {
+        munmap(mapped, bytes);
+        throw std::runtime_error("unusable snapshot " + path);
+    }
+    const order_state::OrderRecord* records = reinterpret_cast<const order_state::OrderRecord*>(base + SNAPSHOT_DATA_OFFSET);
+    // A sequential pass over the mapping: the records are verified before the store sees any
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (uint64_t i = 0; i < header.count; i++)
+        h = mix(h, records[i]);
+    if (h != header.checksum) {
+        munmap(mapped, bytes);
+        throw std::runtime_error("snapshot checksum mismatch " + path);
+    }
+    for (uint64_t i = 0; i < header.count; i++) {
+        // Table entries are random accesses: ask for them a few records ahead
+        if (i + LOAD_PREFETCH_DISTANCE < header.count)
+            store.prefetch(records[i + LOAD_PREFETCH_DISTANCE].id);
+        store.insert(records[i]);
+    }
+    munmap(mapped, bytes);
+    info.orders = header.count;
+    info.journal_sequence = header.journal_sequence;
+    return info;
+}
+
+struct RestartResult {
+    SnapshotInfo snapshot;
+    journal::RecoveryResult journal;
+};
+
+// Cold start: snapshot, then the journal tail after it
+inline RestartResult restart(const std::string& directory, order_store::OrderStore& store) {
+    RestartResult result;
+    result.snapshot = load_snapshot(directory, store);
+    result.journal = journal::recover(directory, store, result.snapshot.journal_sequence);
+    return result;
+}
+
+// Snapshot of the store as of journal_sequence, then drop the journal segments it covers
+inline void checkpoint(const std::string& directory, const order_store::OrderStore& store, uint64_t journal_sequence) {
+    write_snapshot(directory, store, journal_sequence);
+    journal::remove_segments_before(directory, journal_sequence);
+}
+
+// Checkpoints off the thread that owns the store. capture() copies the live orders into a
+// buffer kept from one checkpoint to the next; the writer thread then writes, syncs and renames
+// the snapshot and drops the journal segments it covers. One checkpoint at a time: while the
+// previous one is still being written capture() copies nothing and returns false.
+class BackgroundCheckpoint {
+private:
+    std::string directory;
+    std::vector<order_state::OrderRecord> image; // owned by the writer thread while pending
+    uint64_t image_sequence = 0;
+    std::atomic<bool> pending{false};
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> failures{0};
+    std::atomic<bool> running{true};
+    wait::WakeSignal signal;
+    wait::WaitStrategy waiter{wait::Mode::SPIN_PARK, 100, 10000000};
+    std::thread writer;
+
+    void write_pending() {
+        while (true) {
+            waiter.wait_until([&]() { return pending.load(std::memory_order_acquire) ||
+                                             !running.load(std::memory_order_relaxed); }, &signal);
+            if (!pending.load(std::memory_order_acquire))
+                return; // stopped with nothing left to write
+            try {
+                write_snapshot(directory, image.data(), image.size(), image_sequence);
+                journal::remove_segments_before(directory, image_sequence);
+                written.store(image_sequence, std::memory_order_release);
+            } catch (const std::system_error&) {
+                failures.fetch_add(1, std::memory_order_relaxed); // the journal still has it all
+            }
+            pending.store(false, std::memory_order_release);
+        }
+    }
+
+public:
+    explicit BackgroundCheckpoint(const std::string& directory) : directory(directory) {
+        writer = std::thread(&BackgroundCheckpoint::write_pending, this);
+    }
+    // Finishes the checkpoint in flight
+    ~BackgroundCheckpoint() {
+        running.store(false, std::memory_order_relaxed);
+        signal.notify();
+        writer.join();
+    }
+    BackgroundCheckpoint(const BackgroundCheckpoint&) = delete;
+    BackgroundCheckpoint& operator=(const BackgroundCheckpoint&) = delete;
+
+    // Thread that owns the store, between two journaled events
+    bool capture(const order_store::OrderStore& store, uint64_t journal_sequence) {
+        if (pending.load(std::memory_order_acquire))
+            return false;
+        image.clear();
+        store.for_each_live([&](const order_state::OrderRecord& order) { image.push_back(order); });
+        image_sequence = journal_sequence;
+        pending.store(true, std::memory_order_release);
+        signal.notify();
+        return true;
+    }
+
+    bool busy() const { return pending.load(std::memory_order_acquire); }
+    // Journal sequence of the last snapshot on disk, 0 before the first
+    uint64_t written_sequence() const { return written.load(std::memory_order_acquire); }
+    uint64_t failed_checkpoints() const { return failures.load(std::memory_order_relaxed); }
+};
+
+} // namespace snapshot
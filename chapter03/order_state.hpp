@@ -0,0 +1,143 @@
+#pragma once
+#include <cstdint>
+#include <type_traits>
+
+// Order lifecycle as a table-driven state machine. Order records and execution updates are
+// trivially copyable PODs, so they travel through the lock-free queues and the journal as is.
+namespace order_state
+{
+
+enum class OrderState : uint8_t {
+    NEW,              // sent, not acknowledged by the venue yet
+    ACKNOWLEDGED,
+    PARTIALLY_FILLED,
+    FILLED,
+    CANCEL_PENDING,
+    CANCELLED,
+    REJECTED,
+    REPLACED,         // terminal for this id: the replacement lives under a new id
+    STATE_COUNT
+};
+
+enum class OrderEvent : uint8_t {
+    ACK,
+    FILL,           // partial or full, decided by the leaves quantity
+    CANCEL_REQUEST,
+    CANCEL_ACK,
+    CANCEL_REJECT,  // back to where the order was before the request
+    REJECT,
+    REPLACE_ACK,
+    EVENT_COUNT
+};
+
+const int STATE_COUNT = static_cast<int>(OrderState::STATE_COUNT);
+const int EVENT_COUNT = static_cast<int>(OrderEvent::EVENT_COUNT);
+
+inline const char* state_name(OrderState state) {
+    switch (state) {
+        case OrderState::NEW: return "new";
+        case OrderState::ACKNOWLEDGED: return "ack";
+        case OrderState::PARTIALLY_FILLED: return "partial";
+        case OrderState::FILLED: return "filled";
+        case OrderState::CANCEL_PENDING: return "cancel_pending";
+        case OrderState::CANCELLED: return "cancelled";
+        case OrderState::REJECTED: return "rejected";
+        case OrderState::REPLACED: return "replaced";
+        default: return "unknown";
+    }
+}
+
+inline bool is_terminal(OrderState state) {
+    return state == OrderState::FILLED || state == OrderState::CANCELLED ||
+           state == OrderState::REJECTED || state == OrderState::REPLACED;
+}
+
+struct OrderRecord {
+    int64_t id;
+    double price;
+    int32_t quantity;
+    int32_t cum_quantity;
+    int32_t leaves_quantity;
+    bool is_bid;
+    OrderState state;
+    OrderState state_before_cancel; // where CANCEL_REJECT returns to, unless filled meanwhile
+    uint32_t symbol_id;             // the hub's dense symbol id
+};
+static_assert(std::is_trivially_copyable<OrderRecord>::value, "order records are copied as raw bytes");
+
+struct ExecutionUpdate {
+    int64_t order_id;
+    double last_price;
+    int32_t last_quantity;
+    OrderEvent event;
+};
+static_assert(std::is_trivially_copyable<ExecutionUpdate>::value, "execution updates are copied as raw bytes");
+
+inline OrderRecord make_order(int64_t id, double price, int32_t quantity, bool is_bid, uint32_t symbol_id = 0) {
+    return OrderRecord{id, price, quantity, 0, quantity, is_bid, OrderState::NEW, OrderState::NEW, symbol_id};
+}
+
+// TRANSITIONS[state][event]: the next state, or STATE_COUNT when the event is not allowed.
+// A FILL that leaves nothing open becomes FILLED in apply().
+namespace detail
+{
+    const OrderState X = OrderState::STATE_COUNT;
+    const OrderState N = OrderState::NEW;
+    const OrderState A = OrderState::ACKNOWLEDGED;
+    const OrderState P = OrderState::PARTIALLY_FILLED;
+    const OrderState CP = OrderState::CANCEL_PENDING;
+    const OrderState C = OrderState::CANCELLED;
+    const OrderState R = OrderState::REJECTED;
+    const OrderState RP = OrderState::REPLACED;
+
+    const OrderState TRANSITIONS[STATE_COUNT][EVENT_COUNT] = {
+        //            ACK  FILL CXL_REQ CXL_ACK CXL_REJ REJECT REPLACE
+        /* NEW     */ {A,   P,   CP,     X,      X,      R,     X},
+        /* ACK     */ {X,   P,   CP,     X,      X,      R,     RP},
+        /* PARTIAL */ {X,   P,   CP,     X,      X,      X,     RP},
+        /* FILLED  */ {X,   X,   X,      X,      X,      X,     X},
+        /* CXL_PND */ {X,   CP,  X,      C,      N,      X,     X},  // CXL_REJ: see apply()
+        /* CXL     */ {X,   X,   X,      X,      X,      X,     X},
+        /* REJECT  */ {X,   X,   X,      X,      X,      X,     X},
+        /* REPLACE */ {X,   X,   X,      X,      X,      X,     X},
+    };
+}
+
+inline OrderState next_state(OrderState state, OrderEvent event) {
+    return detail::TRANSITIONS[static_cast<int>(state)][static_cast<int>(event)];
+}
+
+// Applies an execution update. Returns false, leaving the order untouched, when the
+// transition is not allowed or a fill exceeds the leaves quantity.
+inline bool apply(OrderRecord& order, const ExecutionUpdate& update) {
+    OrderState next = next_state(order.state, update.event);
+    if (next == OrderState::STATE_COUNT)
+        return false;
+    switch (update.event) {
+        case OrderEvent::FILL:
+            if (update.last_quantity <= 0 || update.last_quantity > order.leaves_quantity)
+                return false;
+            order.cum_quantity += update.last_quantity;
+            order.leaves_quantity -= update.last_quantity;
+            if (order.leaves_quantity == 0)
+                next = OrderState::FILLED;
+            break;
+        case OrderEvent::CANCEL_REQUEST:
+            order.state_before_cancel = order.state;
+            break;
+        case OrderEvent::CANCEL_REJECT:
+            next = order.cum_quantity > 0 ? OrderState::PARTIALLY_FILLED : order.state_before_cancel;
+            break;
+        case OrderEvent::CANCEL_ACK:
+        case OrderEvent::REJECT:
+        case OrderEvent::REPLACE_ACK:
+            order.leaves_quantity = 0;
+            break;
+        default:
+            break;
+    }
+    order.state = next;
+    return true;
+}
+
+} // namespace order_state
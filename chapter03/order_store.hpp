@@ -0,0 +1,184 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "order_state.hpp"
+
+// Live orders in one preallocated slab, addressed by a dense internal slot id. Client order
+// ids map to slots through an open-addressing table (linear probing, backward-shift delete,
+// no tombstones), so inserts never rehash and lookups touch one or two cache lines.
+// Filled orders are appended to an archive of fixed-size segments instead of another map.
+namespace order_store
+{
+    using order_state::OrderRecord;
+
+    class OrderStore {
+    private:
+        static const uint32_t EMPTY = 0xffffffff;
+
+        // 8 bytes: probing compares the hash tag and only reads the slab on a tag match
+        struct Entry {
+            uint32_t slot;
+            uint32_t tag;
+        };
+
+        size_t max_orders;
+        std::unique_ptr<OrderRecord[]> slab;
+        std::unique_ptr<uint32_t[]> free_slots; // stack of unused slots
+        size_t free_count;
+        size_t table_mask;
+        std::unique_ptr<Entry[]> table;
+
+        size_t segment_size;
+        std::vector<std::unique_ptr<OrderRecord[]>> segments;
+        size_t archived = 0;
+
+        static uint64_t hash(int64_t id) {
+            uint64_t x = static_cast<uint64_t>(id);
+            x ^= x >> 33;
+            x *= 0xff51afd7ed558ccdULL;
+            x ^= x >> 33;
+            x *= 0xc4ceb9fe1a85ec53ULL;
+            x ^= x >> 33;
+            return x;
+        }
+
+        // Index of the table entry holding id, or of the empty entry where it would go
+        size_t probe(int64_t id, bool& found) const {
+            uint64_t h = hash(id);
+            uint32_t tag = static_cast<uint32_t>(h >> 32);
+            for (size_t i = h & table_mask;; i = (i + 1) & table_mask) {
+                const Entry& entry = table[i];
+                if (entry.slot == EMPTY) {
+                    found = false;
+                    return i;
+                }
+                if (entry.tag == tag && slab[entry.slot].id == id) {
+                    found = true;
+                    return i;
+                }
+            }
+        }
+
+        // Backward-shift delete: pull later entries of the same cluster into the hole so
+        // lookups never have to skip tombstones
+        void remove_entry(size_t hole) {
+            for (size_t i = (hole + 1) & table_mask; table[i].slot != EMPTY; i = (i + 1) & table_mask) {
+                size_t home = hash(slab[table[i].slot].id) & table_mask;
+                // Move i into the hole unless its home lies cyclically in (hole, i]
+                bool home_after_hole = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+                if (!home_after_hole) {
+                    table[hole] = table[i];
+                    hole = i;
+                }
+            }
+            table[hole].slot = EMPTY;
+        }
+
+        void release(size_t index) {
+            uint32_t slot = table[index].slot;
+            remove_entry(index);
+            free_slots[free_count++] = slot;
+        }
+
+    public:
+        static const size_t DEFAULT_SEGMENT_SIZE = 1 << 16;
+
+        // Everything is allocated and touched here: nothing on the order path allocates,
+        // except one new archive segment every segment_size fills
+        explicit OrderStore(size_t max_orders, size_t segment_size = DEFAULT_SEGMENT_SIZE)
+            : max_orders(max_orders), slab(new OrderRecord[max_orders]()), free_slots(new uint32_t[max_orders]),
+              free_count(max_orders), segment_size(segment_size) {
+            if (max_orders == 0 || max_orders >= EMPTY)
+                throw std::invalid_argument("order store capacity out of range");
+            size_t table_size = 1;
+            while (table_size < max_orders * 2) // load factor <= 0.5 keeps probe sequences short
+                table_size <<= 1;
+            table_mask = table_size - 1;
+            table.reset(new Entry[table_size]);
+            for (size_t i = 0; i < table_size; i++)
+                table[i] = Entry{EMPTY, 0};
+            for (size_t i = 0; i < max_orders; i++)
+                free_slots[i] = static_cast<uint32_t>(max_orders - 1 - i); // low slots first
+        }
+        OrderStore(const OrderStore&) = delete;
+        OrderStore& operator=(const OrderStore&) = delete;
+
+        // Returns the stored record, or nullptr when the id is already live or the store is full
+        OrderRecord* insert(const OrderRecord& order) {
+            bool found;
+            size_t index = probe(order.id, found);
+            if (found || free_count == 0)
+                return nullptr;
+            uint32_t slot = free_slots[--free_count];
+            slab[slot] = order;
+            table[index] = Entry{slot, static_cast<uint32_t>(hash(order.id) >> 32)};
+            return &slab[slot];
+        }
+
+        // Pulls the table entry for id into cache a few orders before it is inserted, for bulk loads
+        void prefetch(int64_t id) const { __builtin_prefetch(&table[hash(id) & table_mask], 1); }
+
+        // Stays valid until the order is erased or archived
+        OrderRecord* find(int64_t id) {
+            bool found;
+            size_t index = probe(id, found);
+            return found ? &slab[table[index].slot] : nullptr;
+        }
+
+        bool erase(int64_t id) {
+            bool found;
+            size_t index = probe(id, found);
+            if (!found)
+                return false;
+            release(index);
+            return true;
+        }
+
+        // Appends the order to the archive and frees its live slot
+        bool archive(int64_t id) {
+            bool found;
+            size_t index = probe(id, found);
+            if (!found)
+                return false;
+            if (archived == segments.size() * segment_size)
+                segments.emplace_back(new OrderRecord[segment_size]);
+            segments[archived / segment_size][archived % segment_size] = slab[table[index].slot];
+            archived++;
+            release(index);
+            return true;
+        }
+
+        // Calls on_order(const OrderRecord&) for every live order, in no particular order
+        template <typename Callback>
+        void for_each_live(Callback&& on_order) const {
+            for (size_t i = 0; i <= table_mask; i++)
+                if (table[i].slot != EMPTY)
+                    on_order(slab[table[i].slot]);
+        }
+
+        size_t size() const { return max_orders - free_count; }
+        size_t capacity() const { return max_orders; }
+        size_t archived_count() const { return archived; }
+        const OrderRecord& archived_at(size_t i) const { return segments[i / segment_size][i % segment_size]; }
+    };
+
+    enum class UpdateResult { APPLIED, UNKNOWN_ORDER, INVALID_TRANSITION };
+
+    // Applies an execution report to a live order: filled orders move to the archive,
+    // cancelled, rejected and replaced ones are dropped
+    inline UpdateResult apply_update(OrderStore& store, const order_state::ExecutionUpdate& update) {
+        OrderRecord* order = store.find(update.order_id);
+        if (!order)
+            return UpdateResult::UNKNOWN_ORDER;
+        if (!order_state::apply(*order, update))
+            return UpdateResult::INVALID_TRANSITION;
+        if (order->state == order_state::OrderState::FILLED)
+            store.archive(update.order_id);
+        else if (order_state::is_terminal(order->state))
+            store.erase(update.order_id);
+        return UpdateResult::APPLIED;
+    }
+
+} // namespace order_store
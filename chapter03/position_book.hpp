@@ -0,0 +1,185 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+// Positions and PnL per symbol, kept incrementally: a fill or a new BBO touches its own symbol
+// and adjusts the portfolio totals by the difference it made. Symbols are the hub's dense ids
+// (see conflation_buffer.hpp) and index a structure of arrays directly, so marking the whole
+// portfolio to market is one pass over contiguous quantity, cost and mark columns.
+namespace positions
+{
+
+// One symbol, copied out of the table
+struct Position {
+    uint32_t symbol;
+    double quantity;       // net, long positive
+    double average_cost;   // of the open quantity, 0 when flat
+    double mark;           // BBO mid, 0 until the first quote
+    double realized_pnl;
+    double unrealized_pnl;
+};
+
+struct Totals {
+    double realized_pnl = 0.0;
+    double unrealized_pnl = 0.0;
+    double net_exposure = 0.0;   // sum of quantity x mark
+    double gross_exposure = 0.0; // sum of |quantity| x mark
+};
+
+// One thread updates; the totals drift by rounding as updates pile up, remark() recomputes them
+class PositionBook {
+private:
+    std::vector<double> quantity;
+    std::vector<double> average_cost;
+    std::vector<double> mark;
+    std::vector<double> realized;
+    std::vector<double> unrealized;
+    Totals total;
+
+    typedef double double2 __attribute__((vector_size(16)));
+    static double2 load(const double* p) {
+        double2 v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    static double horizontal_sum(double2 a, double2 b) { return (a[0] + b[0]) + (a[1] + b[1]); }
+
+    // Unrealized PnL of two symbols; adds their net and gross exposure to net and gross
+    static double2 mark_to_market(const double* q, const double* m, const double* cost, double2& net,
+                                  double2& gross) {
+        const double2 zero = {};
+        double2 held = load(q), price = load(m);
+        net += held * price;
+        gross += (held < zero ? -held : held) * price;
+        return price > zero ? held * (price - load(cost)) : zero;
+    }
+
+    // Takes the symbol's contribution out of the totals, or puts it back with sign = 1
+    void contribute(uint32_t symbol, double sign) {
+        total.unrealized_pnl += sign * unrealized[symbol];
+        total.net_exposure += sign * quantity[symbol] * mark[symbol];
+        total.gross_exposure += sign * std::fabs(quantity[symbol]) * mark[symbol];
+    }
+
+    void revalue(uint32_t symbol) {
+        unrealized[symbol] = mark[symbol] > 0.0 ? quantity[symbol] * (mark[symbol] - average_cost[symbol]) : 0.0;
+    }
+
+    void check(uint32_t symbol) const {
+        if (symbol >= quantity.size())
+            throw std::out_of_range("symbol outside the position table");
+    }
+
+public:
+    explicit PositionBook(size_t symbols)
+        : quantity(symbols, 0.0), average_cost(symbols, 0.0), mark(symbols, 0.0), realized(symbols, 0.0),
+          unrealized(symbols, 0.0) {}
+
+    // Replaces the symbol's position, e.g. the start of day position from the OMS
+    void load(uint32_t symbol, double net_quantity, double cost) {
+        check(symbol);
+        contribute(symbol, -1.0);
+        quantity[symbol] = net_quantity;
+        average_cost[symbol] = net_quantity != 0.0 ? cost : 0.0;
+        revalue(symbol);
+        contribute(symbol, 1.0);
+    }
+
+    // Average cost accounting: adding to a position moves the average cost, reducing it
+    // realizes the difference to the average cost, and a fill through flat opens the rest at price
+    void on_fill(uint32_t symbol, bool is_buy, double fill_quantity, double price) {
+        check(symbol);
+        contribute(symbol, -1.0);
+        const double held = quantity[symbol];
+        const double fill = is_buy ? fill_quantity : -fill_quantity;
+        const double after = held + fill;
+        if (held == 0.0 || (held > 0.0) == (fill > 0.0)) {
+            average_cost[symbol] = (held * average_cost[symbol] + fill * price) / after;
+        } else {
+            double closed = std::fmin(std::fabs(fill), std::fabs(held));
+            double pnl = closed * (price - average_cost[symbol]) * (held > 0.0 ? 1.0 : -1.0);
+            realized[symbol] += pnl;
+            total.realized_pnl += pnl;
+            if (after == 0.0)
+                average_cost[symbol] = 0.0;
+            else if ((after > 0.0) != (held > 0.0))
+                average_cost[symbol] = price;
+        }
+        quantity[symbol] = after;
+        revalue(symbol);
+        contribute(symbol, 1.0);
+    }
+
+    // Marks the symbol to the mid; a one-sided or empty book keeps the last mark
+    void on_quote(uint32_t symbol, double bid, double ask) {
+        if (symbol >= quantity.size() || bid <= 0.0 || ask <= 0.0)
+            return;
+        contribute(symbol, -1.0);
+        mark[symbol] = 0.5 * (bid + ask);
+        revalue(symbol);
+        contribute(symbol, 1.0);
+    }
+
+    // Recomputes every unrealized PnL and the totals from the current marks, or from marks
+    // (one per symbol) when given. Two symbols per GCC vector (SSE2 is the x86-64 baseline), two
+    // vectors per step: SIMD at -O2 as well, with four independent chains per sum that are
+    // added in a fixed order, so the result does not depend on -ffast-math.
+    const Totals& remark(const double* marks = nullptr) {
+        const size_t n = quantity.size();
+        if (marks)
+            std::copy(marks, marks + n, mark.begin());
+        const double* q = quantity.data();
+        const double* cost = average_cost.data();
+        const double* m = mark.data();
+        double* u = unrealized.data();
+        double2 unrealized0 = {}, unrealized1 = {}, net0 = {}, net1 = {}, gross0 = {}, gross1 = {};
+        size_t i = 0;
+        for (; i + 4 <= n; i += 4) {
+            double2 pnl0 = mark_to_market(q + i, m + i, cost + i, net0, gross0);
+            double2 pnl1 = mark_to_market(q + i + 2, m + i + 2, cost + i + 2, net1, gross1);
+            std::memcpy(u + i, &pnl0, sizeof(pnl0));
+            std::memcpy(u + i + 2, &pnl1, sizeof(pnl1));
+            unrealized0 += pnl0;
+            unrealized1 += pnl1;
+        }
+        double tail_unrealized = 0.0, tail_net = 0.0, tail_gross = 0.0;
+        for (; i < n; i++) {
+            u[i] = m[i] > 0.0 ? q[i] * (m[i] - cost[i]) : 0.0;
+            tail_unrealized += u[i];
+            tail_net += q[i] * m[i];
+            tail_gross += std::fabs(q[i]) * m[i];
+        }
+        total.unrealized_pnl = horizontal_sum(unrealized0, unrealized1) + tail_unrealized;
+        total.net_exposure = horizontal_sum(net0, net1) + tail_net;
+        total.gross_exposure = horizontal_sum(gross0, gross1) + tail_gross;
+        double2 realized0 = {}, realized1 = {};
+        for (i = 0; i + 4 <= n; i += 4) {
+            realized0 += load(realized.data() + i);
+            realized1 += load(realized.data() + i + 2);
+        }
+        double tail_realized = 0.0;
+        for (; i < n; i++)
+            tail_realized += realized[i];
+        total.realized_pnl = horizontal_sum(realized0, realized1) + tail_realized;
+        return total;
+    }
+
+    const Totals& totals() const { return total; }
+
+    Position position(uint32_t symbol) const {
+        check(symbol);
+        return Position{symbol, quantity[symbol], average_cost[symbol], mark[symbol], realized[symbol],
+                        unrealized[symbol]};
+    }
+
+    size_t symbols() const { return quantity.size(); }
+    // Columns, one entry per symbol
+    const double* quantities() const { return quantity.data(); }
+    const double* marks() const { return mark.data(); }
+};
+
+} // namespace positions
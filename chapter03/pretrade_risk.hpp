@@ -0,0 +1,252 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "hub_messages.hpp"
+#include "latency_tracer.hpp"
+#include "order_state.hpp"
+
+// Pre-trade checks on the order path: order size, notional, a price collar around the current
+// BBO of the order's symbol, position limit per symbol, open-order count and duplicate
+// detection. Each account's limits and open-order count share one cache line, so a check is
+// one line for the account, one for its recent orders, one for the symbol's reference prices
+// and usually one for the account's position in the symbol. Prices are integers in hub units
+// (see hub_messages.hpp) and every check is evaluated, failing or not, into a mask of the
+// failed checks; no branch depends on the order.
+namespace pretrade
+{
+
+// Bits of a check result, 0 when the order may go out
+enum Failure : uint32_t {
+    ORDER_SIZE = 1 << 0,    // quantity not positive or above the account's maximum
+    NOTIONAL = 1 << 1,
+    PRICE_COLLAR = 1 << 2,  // outside [bid - collar, ask + collar], or no BBO yet
+    POSITION = 1 << 3,      // position plus open orders on that side would exceed the limit
+    OPEN_ORDERS = 1 << 4,
+    DUPLICATE = 1 << 5,     // same symbol, side, price and quantity as a recent order
+    UNKNOWN_ACCOUNT = 1 << 6,
+    UNKNOWN_SYMBOL = 1 << 7, // beyond the symbol count, or no room left to keep its position
+};
+
+struct Limits {
+    int32_t max_order_quantity = 0;
+    int32_t max_open_orders = 0;
+    double max_notional = 0.0;  // price x quantity
+    double collar = 0.0;        // in price units, around the BBO
+    int64_t max_position = 0;   // absolute, long or short, in each symbol
+};
+
+// Limits and open orders of one account; all-zero limits reject everything
+struct alignas(64) AccountState {
+    int64_t max_notional;       // hub price units x quantity
+    int64_t collar;             // hub price units
+    int64_t max_position;
+    int32_t max_order_quantity;
+    int32_t max_open_orders;
+    int32_t open_orders;
+    uint32_t recent_cursor;
+};
+static_assert(sizeof(AccountState) == 64, "one cache line per account");
+
+// What one account holds and has open in one symbol
+struct Exposure {
+    int64_t position;           // filled, long positive
+    int64_t open_buy_quantity;
+    int64_t open_sell_quantity;
+};
+
+// Latest BBO of a symbol, hub prices; 0 until the first one
+struct Reference {
+    std::atomic<int64_t> bid{0};
+    std::atomic<int64_t> ask{0};
+};
+
+// The last RECENT_ORDERS accepted orders of an account, for duplicate detection
+const int RECENT_ORDERS = 8;
+struct alignas(64) RecentOrders {
+    uint32_t fingerprint[RECENT_ORDERS]; // 0: empty
+    uint32_t time[RECENT_ORDERS];        // TSC >> TIME_SHIFT
+};
+static_assert(sizeof(RecentOrders) == 64, "one cache line per account");
+
+const int TIME_SHIFT = 16; // about 30 us at 2 GHz; the uint32 wraps after a day and a half
+
+// Checks and bookings for one order flow: check() and on_execution() from one thread, the
+// reference prices may be updated from another. Exposures are kept per (account, symbol) in an
+// open-addressing table sized at construction; a pair gets its entry on its first check and
+// keeps it, so nothing is allocated on the order path.
+class PreTradeChecker {
+private:
+    static const uint64_t EMPTY = ~uint64_t(0);
+
+    struct PositionEntry {
+        uint64_t key; // account << 32 | symbol, EMPTY: unused
+        Exposure exposure;
+    };
+
+    std::vector<AccountState> accounts;
+    std::vector<RecentOrders> recent;
+    std::unique_ptr<Reference[]> references;
+    size_t symbol_count;
+    std::unique_ptr<PositionEntry[]> positions;
+    size_t position_mask = 0;
+    size_t max_positions;
+    size_t position_count = 0;
+    uint32_t duplicate_window = 0;
+
+    static int64_t to_ticks(double price) { return static_cast<int64_t>(price * wire::PRICE_SCALE + 0.5); }
+
+    static uint32_t fingerprint(uint32_t symbol_id, bool is_bid, int64_t ticks, int32_t quantity) {
+        uint64_t key = (static_cast<uint64_t>(ticks) << 1 | is_bid) * 0x9e3779b97f4a7c15ULL ^
+                       (static_cast<uint64_t>(symbol_id) << 32 | static_cast<uint32_t>(quantity)) * 0xc2b2ae3d27d4eb4fULL;
+        return static_cast<uint32_t>(key >> 32) | 1;
+    }
+
+    static uint64_t hash(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return key;
+    }
+
+    size_t probe(uint64_t key) const {
+        size_t i = hash(key) & position_mask;
+        while (positions[i].key != key && positions[i].key != EMPTY)
+            i = (i + 1) & position_mask;
+        return i;
+    }
+
+    // nullptr when the pair is new and the table is full
+    Exposure* claim(uint32_t account, uint32_t symbol) {
+        const uint64_t key = static_cast<uint64_t>(account) << 32 | symbol;
+        PositionEntry& entry = positions[probe(key)];
+        if (entry.key == EMPTY) {
+            if (position_count == max_positions)
+                return nullptr;
+            entry.key = key;
+            position_count++;
+        }
+        return &entry.exposure;
+    }
+
+public:
+    // Symbol ids run from 0 to symbol_count - 1; at most max_positions (account, symbol) pairs
+    // are traded. Orders with the same symbol, side, price and quantity as an accepted order less than
+    // duplicate_window_us before are refused.
+    PreTradeChecker(size_t account_count, size_t symbol_count, size_t max_positions,
+                    double duplicate_window_us = 1000.0,
+                    double cycles_per_ns = latency::TscClock::instance().cycles_per_ns())
+        : accounts(account_count, AccountState()), recent(account_count, RecentOrders()),
+          references(new Reference[symbol_count]), symbol_count(symbol_count), max_positions(max_positions) {
+        if (max_positions == 0)
+            throw std::invalid_argument("position table needs room for one position");
+        size_t table_size = 1;
+        while (table_size < max_positions * 2)
+            table_size <<= 1;
+        position_mask = table_size - 1;
+        positions.reset(new PositionEntry[table_size]);
+        for (size_t i = 0; i < table_size; i++)
+            positions[i] = PositionEntry{EMPTY, Exposure()};
+        duplicate_window = static_cast<uint32_t>(duplicate_window_us * 1000.0 * cycles_per_ns) >> TIME_SHIFT;
+    }
+
+    // Keeps the account's exposure
+    void set_limits(uint32_t account, const Limits& limits) {
+        if (account >= accounts.size())
+            throw std::out_of_range("unknown account");
+        AccountState& state = accounts[account];
+        state.max_order_quantity = limits.max_order_quantity;
+        state.max_open_orders = limits.max_open_orders;
+        state.max_notional = static_cast<int64_t>(limits.max_notional * wire::PRICE_SCALE);
+        state.collar = to_ticks(limits.collar);
+        state.max_position = limits.max_position;
+    }
+
+    // Hub prices, straight from a BboUpdate; symbols beyond the symbol count are ignored
+    void update_reference(uint32_t symbol_id, int64_t bid_price, int64_t offer_price) {
+        if (symbol_id >= symbol_count)
+            return;
+        references[symbol_id].bid.store(bid_price, std::memory_order_relaxed);
+        references[symbol_id].ask.store(offer_price, std::memory_order_relaxed);
+    }
+
+    // Returns the failed checks, 0 to accept. An accepted order is booked as open right away,
+    // so the next check sees it.
+    uint32_t check(uint32_t account, const order_state::OrderRecord& order, uint64_t now_tsc) {
+        if (account >= accounts.size())
+            return UNKNOWN_ACCOUNT;
+        Exposure* held = order.symbol_id < symbol_count ? claim(account, order.symbol_id) : nullptr;
+        if (held == nullptr)
+            return UNKNOWN_SYMBOL;
+        Exposure& exposure = *held;
+        AccountState& state = accounts[account];
+        RecentOrders& orders = recent[account];
+        const Reference& reference = references[order.symbol_id];
+        const int64_t ticks = to_ticks(order.price);
+        const int64_t quantity = order.quantity;
+        const int64_t bid = reference.bid.load(std::memory_order_relaxed);
+        const int64_t ask = reference.ask.load(std::memory_order_relaxed);
+        const int64_t buy = order.is_bid;
+
+        uint32_t failed = ((quantity <= 0) | (quantity > state.max_order_quantity)) * ORDER_SIZE;
+        failed |= (static_cast<__int128>(ticks) * quantity > state.max_notional) * NOTIONAL;
+        failed |= ((ticks <= 0) | (bid <= 0) | (ask <= 0) | (ticks < bid - state.collar) |
+                   (ticks > ask + state.collar)) * PRICE_COLLAR;
+        // Buys are checked as if every open buy filled, sells as if every open sell did
+        int64_t open = buy ? exposure.open_buy_quantity : exposure.open_sell_quantity;
+        int64_t worst = (buy ? exposure.position : -exposure.position) + open + quantity;
+        failed |= (worst > state.max_position) * POSITION;
+        failed |= (state.open_orders >= state.max_open_orders) * OPEN_ORDERS;
+
+        const uint32_t print = fingerprint(order.symbol_id, order.is_bid, ticks, order.quantity);
+        const uint32_t time = static_cast<uint32_t>(now_tsc >> TIME_SHIFT);
+        uint32_t duplicate = 0;
+        for (int i = 0; i < RECENT_ORDERS; i++)
+            duplicate |= (orders.fingerprint[i] == print) & (time - orders.time[i] < duplicate_window);
+        failed |= duplicate * DUPLICATE;
+
+        // Booked with masks rather than a branch on the result
+        const int64_t accepted = failed == 0;
+        exposure.open_buy_quantity += quantity * (accepted & buy);
+        exposure.open_sell_quantity += quantity * (accepted & (buy ^ 1));
+        state.open_orders += static_cast<int32_t>(accepted);
+        uint32_t slot = state.recent_cursor % RECENT_ORDERS;
+        orders.fingerprint[slot] = accepted ? print : orders.fingerprint[slot];
+        orders.time[slot] = accepted ? time : orders.time[slot];
+        state.recent_cursor += static_cast<uint32_t>(accepted);
+        return failed;
+    }
+
+    // Books an execution report the OMS applied to order, as it was before the report: fills
+    // move quantity from open to position, and an order that is done frees its open quantity
+    void on_execution(uint32_t account, const order_state::OrderRecord& order,
+                      const order_state::ExecutionUpdate& update) {
+        using order_state::OrderEvent;
+        if (account >= accounts.size())
+            return;
+        AccountState& state = accounts[account];
+        const int64_t fill = update.event == OrderEvent::FILL ? update.last_quantity : 0;
+        const bool done = fill >= order.leaves_quantity || update.event == OrderEvent::CANCEL_ACK ||
+                          update.event == OrderEvent::REJECT || update.event == OrderEvent::REPLACE_ACK;
+        const int64_t released = done ? order.leaves_quantity : fill;
+        state.open_orders -= done;
+        const uint64_t key = static_cast<uint64_t>(account) << 32 | order.symbol_id;
+        PositionEntry& entry = positions[probe(key)];
+        if (entry.key != key)
+            return; // never checked here, nothing was booked for it
+        entry.exposure.position += order.is_bid ? fill : -fill;
+        (order.is_bid ? entry.exposure.open_buy_quantity : entry.exposure.open_sell_quantity) -= released;
+    }
+
+    const AccountState& account_state(uint32_t account) const { return accounts[account]; }
+    // nullptr until the account's first order in the symbol
+    const Exposure* exposure(uint32_t account, uint32_t symbol_id) const {
+        const uint64_t key = static_cast<uint64_t>(account) << 32 | symbol_id;
+        const PositionEntry& entry = positions[probe(key)];
+        return entry.key == key ? &entry.exposure : nullptr;
+    }
+};
+
+} // namespace pretrade
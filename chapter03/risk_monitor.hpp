@@ -0,0 +1,156 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "lockfree_queue.hpp"
+#include "position_book.hpp"
+#include "wait_strategy.hpp"
+
+// Limit monitoring on every position or price update. The update path only evaluates what the
+// update can have changed: the symbol's own exposure, and the portfolio figures the position book
+// already keeps as running totals. Concentration needs the largest symbol exposure, which a
+// max tree over the symbols keeps at O(log symbols) per update instead of a rescan. Alerts are
+// raised when a limit is crossed and again when it clears, and leave through a lock-free queue:
+// formatting and delivery happen on a low-priority thread, never on the update path.
+namespace monitor
+{
+
+enum class AlertType : uint8_t {
+    SYMBOL_EXPOSURE,  // |quantity| x mark of one symbol
+    GROSS_EXPOSURE,
+    DRAWDOWN,         // realized + unrealized PnL below its peak
+    CONCENTRATION,    // largest symbol's share of the gross exposure
+};
+
+inline const char* alert_name(AlertType type) {
+    switch (type) {
+        case AlertType::SYMBOL_EXPOSURE: return "symbol_exposure";
+        case AlertType::GROSS_EXPOSURE: return "gross_exposure";
+        case AlertType::DRAWDOWN: return "drawdown";
+        case AlertType::CONCENTRATION: return "concentration";
+        default: return "unknown";
+    }
+}
+
+struct Alert {
+    uint64_t time;      // TSC of the update that crossed the limit
+    double value;
+    double limit;
+    uint32_t symbol;    // the symbol updated, or the largest one for CONCENTRATION
+    AlertType type;
+    bool breached;      // false: back within the limit
+};
+
+// 0 leaves a limit off
+struct Limits {
+    double max_symbol_exposure = 0.0;
+    double max_gross_exposure = 0.0;
+    double max_drawdown = 0.0;
+    double max_concentration = 0.0;      // share in (0, 1]
+    double concentration_floor = 0.0;    // gross exposure below which concentration is not checked
+};
+
+// evaluate() from the thread that updates the position book, drain() from one other thread
+class RiskMonitor {
+private:
+    Limits limits;
+    size_t leaves = 1;
+    std::vector<double> largest;          // max tree: leaves from index `leaves`, root at 1
+    std::vector<uint8_t> symbol_breached;
+    uint8_t portfolio_breached = 0;       // bit per AlertType
+    double peak_equity = -std::numeric_limits<double>::infinity(); // until the first equity seen
+    queues::SpscQueue<Alert> alerts;
+    wait::WakeSignal alerts_signal;
+    uint64_t raised = 0;
+    uint64_t dropped = 0;
+
+    void raise(uint64_t now, AlertType type, uint32_t symbol, double value, double limit, bool breached) {
+        raised++;
+        if (!alerts.try_push(Alert{now, value, limit, symbol, type, breached}))
+            dropped++; // the alert thread is stuck: never block the update path on it
+        alerts_signal.notify();
+    }
+
+    // Raises when a portfolio limit changes state
+    void portfolio_limit(uint64_t now, AlertType type, uint32_t symbol, bool is, double value, double limit) {
+        const uint8_t bit = uint8_t(1) << static_cast<int>(type);
+        if (bool(portfolio_breached & bit) != is) {
+            raise(now, type, symbol, value, limit, is);
+            portfolio_breached ^= bit;
+        }
+    }
+
+    void update_largest(uint32_t symbol, double exposure) {
+        size_t node = leaves + symbol;
+        largest[node] = exposure;
+        for (node >>= 1; node; node >>= 1)
+            largest[node] = std::fmax(largest[2 * node], largest[2 * node + 1]);
+    }
+
+    uint32_t largest_symbol() const {
+        size_t node = 1;
+        while (node < leaves)
+            node = largest[2 * node] >= largest[2 * node + 1] ? 2 * node : 2 * node + 1;
+        return static_cast<uint32_t>(node - leaves);
+    }
+
+public:
+    RiskMonitor(size_t symbols, const Limits& limits, size_t alert_capacity = 4096)
+        : limits(limits), symbol_breached(symbols, 0), alerts(alert_capacity) {
+        while (leaves < symbols)
+            leaves <<= 1;
+        largest.assign(2 * leaves, 0.0);
+    }
+
+    // After book changed symbol; returns the alerts raised
+    size_t evaluate(uint32_t symbol, const positions::PositionBook& book, uint64_t now) {
+        if (symbol >= symbol_breached.size())
+            return 0;
+        const uint64_t before = raised;
+        const positions::Position position = book.position(symbol);
+        const positions::Totals& totals = book.totals();
+        const double exposure = std::fabs(position.quantity) * position.mark;
+        update_largest(symbol, exposure);
+
+        const bool over = limits.max_symbol_exposure > 0.0 && exposure > limits.max_symbol_exposure;
+        if (bool(symbol_breached[symbol]) != over) {
+            raise(now, AlertType::SYMBOL_EXPOSURE, symbol, exposure, limits.max_symbol_exposure, over);
+            symbol_breached[symbol] = over;
+        }
+
+        const double gross = totals.gross_exposure;
+        portfolio_limit(now, AlertType::GROSS_EXPOSURE, symbol,
+                        limits.max_gross_exposure > 0.0 && gross > limits.max_gross_exposure, gross,
+                        limits.max_gross_exposure);
+
+        const double equity = totals.realized_pnl + totals.unrealized_pnl;
+        peak_equity = std::fmax(peak_equity, equity);
+        const double drawdown = peak_equity - equity;
+        portfolio_limit(now, AlertType::DRAWDOWN, symbol, limits.max_drawdown > 0.0 && drawdown > limits.max_drawdown,
+                        drawdown, limits.max_drawdown);
+
+        const double share = gross > 0.0 ? largest[1] / gross : 0.0;
+        const bool concentrated = limits.max_concentration > 0.0 && gross >= limits.concentration_floor &&
+                                  share > limits.max_concentration;
+        if (concentrated != breached(AlertType::CONCENTRATION))
+            portfolio_limit(now, AlertType::CONCENTRATION, largest_symbol(), concentrated, share,
+                            limits.max_concentration);
+        return raised - before;
+    }
+
+    // Alert thread: calls fn(const Alert&) for every queued alert, returns how many
+    template <typename Fn>
+    size_t drain(Fn&& fn) { return alerts.drain(fn); }
+    wait::WakeSignal& signal() { return alerts_signal; }
+    bool pending() const { return !alerts.empty(); }
+
+    // Update thread; a limit crossed by the change is reported on the next evaluate
+    void set_limits(const Limits& new_limits) { limits = new_limits; }
+
+    bool breached(AlertType type) const { return portfolio_breached & (uint8_t(1) << static_cast<int>(type)); }
+    bool symbol_breach(uint32_t symbol) const { return symbol_breached[symbol]; }
+    uint64_t dropped_alerts() const { return dropped; }
+};
+
+} // namespace monitor
@@ -1,10 +1,26 @@
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 #include <vector>
 #include <unordered_map>
 #include <queue>
 #include <thread>
 #include <mutex>
 #include <zmq.hpp>
+#include "conflation_buffer.hpp"
+#include "wait_strategy.hpp"
+#include "shm_ring.hpp"
+#include "hub_messages.hpp"
+#include "order_state.hpp"
+#include "pretrade_risk.hpp"
+#include "position_book.hpp"
+#include "lockfree_queue.hpp"
+#include "var_engine.hpp"
+#include "risk_monitor.hpp"
+#include <pthread.h>
+#include <memory>
 
 using namespace std;
 
@@ -12,79 +28,365 @@ class MarketData {
     // Market data class
 };
 
-class Position {
-    // Position data class
-};
+// Net quantity, average cost and PnL of one symbol, see position_book.hpp
+typedef positions::Position Position;
 
-class RiskMetrics {
-    // Risk metrics class
+struct RiskMetrics {
+    positions::Totals portfolio; // PnL and exposure over every position
+    var::RiskEstimate valueAtRisk{0.0, 0.0}; // as of the last RevalueScenarios, under varLock
 };
 
-class Order {
-    // Order class
+// One of our executions, as reported to the RMS
+struct Fill {
+    uint32_t symbol_id;
+    bool is_buy;
+    int32_t quantity;
+    double price;
 };
 
+// Accounts with pre-trade limits, see pretrade_risk.hpp
+const size_t RMS_MAX_ACCOUNTS = 1024;
+// Symbol ids the position table covers, the hub's dense ids
+const size_t RMS_MAX_SYMBOLS = 16384;
+// (account, symbol) pairs the pre-trade checks keep an exposure for
+const size_t RMS_MAX_POSITIONS = 1 << 18;
+const size_t RMS_FILL_QUEUE_CAPACITY = 1 << 16;
+// How often a blocked hub receive wakes up to check for Stop()
+const int RMS_RECEIVE_TIMEOUT_MS = 100;
+
 class RMS {
+public:
+    // Order record, see order_state.hpp
+    typedef order_state::OrderRecord Order;
+
 private:
     zmq::context_t context;
     zmq::socket_t subscriber;
     std::thread marketDataThread;
     std::vector<MarketData> marketData;
-    std::vector<Position> positions;
+    // Owned by the market data thread: fills are queued from any thread and applied there,
+    // ahead of the market data message that follows them
+    positions::PositionBook positionBook{RMS_MAX_SYMBOLS};
+    queues::MpscQueue<Fill> fills{RMS_FILL_QUEUE_CAPACITY};
     RiskMetrics riskMetrics;
+    std::unique_ptr<var::Scenarios> scenarios;
+    std::unique_ptr<var::VarEngine> varEngine;
+    // The VaR calls never read the position book: when asked, the market data thread copies the
+    // quantity and mark columns of the scenario symbols into varInputs
+    std::mutex varInputsLock;
+    std::vector<double> varInputs[2];           // quantities, marks
+    std::atomic<uint64_t> varRequested{0};
+    std::atomic<uint64_t> varPublished{0};
+    // Serializes the VaR calls, which share the engine and its copy of the inputs
+    std::mutex varLock;
+    std::vector<double> varColumns[2];
+    // Limits checked on every position or price update, alerts delivered by alertThread
+    monitor::RiskMonitor riskMonitor{RMS_MAX_SYMBOLS, monitor::Limits()};
+    std::thread alertThread;
+    wait::WaitStrategy alertWaiter{wait::Mode::SPIN_PARK, 100, 10000000};
+    conflation::ConflationBuffer* conflated = nullptr;
+    int consumerId = -1;
+    wait::WaitStrategy waiter;
+    std::unique_ptr<shm::ShmSubscriber> shmSubscriber;
+    pretrade::PreTradeChecker preTrade{RMS_MAX_ACCOUNTS, RMS_MAX_SYMBOLS, RMS_MAX_POSITIONS};
+    // The market data loop of the transport this RMS was built for, run by Start()
+    void (RMS::*receive)() = &RMS::ReceiveMarketData;
+    bool started = false;
+    std::atomic<bool> running{true};
+
+    // Setup calls share state with the market data thread and have no synchronization
+    void RequireNotStarted(const char* what) const {
+        if (started)
+            throw std::logic_error(std::string(what) + " after the RMS threads started");
+    }
 
 public:
     RMS() : context(1), subscriber(context, ZMQ_SUB) {
         subscriber.connect("tcp://localhost:5556");
         subscriber.setsockopt(ZMQ_SUBSCRIBE, "", 0);
-        marketDataThread = std::thread(&RMS::ReceiveMarketData, this);
+        subscriber.setsockopt(ZMQ_RCVTIMEO, RMS_RECEIVE_TIMEOUT_MS); // to notice Stop()
+    }
+    // Only the listed symbols: the hub filters on the topic prefix, so updates for other
+    // symbols never reach this process
+    RMS(const std::vector<uint32_t>& symbols) : context(1), subscriber(context, ZMQ_SUB) {
+        subscriber.connect("tcp://localhost:5556");
+        subscriber.setsockopt(ZMQ_RCVTIMEO, RMS_RECEIVE_TIMEOUT_MS);
+        for (uint32_t symbol_id : symbols)
+            Subscribe(wire::make_topic(symbol_id));
+    }
+    // Same-host alternative to the TCP subscription: map the hub's shared-memory ring.
+    // Risk only needs the latest state, so by default a lagging RMS is conflated rather
+    // than holding back the hub.
+    RMS(const std::string& shmName, shm::SlowConsumerPolicy policy = shm::SlowConsumerPolicy::CONFLATE)
+        : context(1), subscriber(context, ZMQ_SUB), shmSubscriber(new shm::ShmSubscriber(shmName, policy)),
+          receive(&RMS::ReceiveShmMarketData) {}
+    // Risk only needs the latest state per symbol: drain the conflation buffer at our own pace
+    // instead of reading every message published by the hub.
+    RMS(conflation::ConflationBuffer& buffer)
+        : context(1), subscriber(context, ZMQ_SUB), conflated(&buffer), receive(&RMS::ReceiveConflatedMarketData) {
+        consumerId = buffer.register_consumer();
     }
 
     ~RMS() {
+        Stop();
         if (marketDataThread.joinable()) {
             marketDataThread.join();
         }
+        if (alertThread.joinable()) {
+            alertThread.join();
+        }
+    }
+
+    // After setup (positions, limits, scenarios, wait strategy): starts the market data and
+    // alert threads. Setup calls made later throw.
+    void Start() {
+        RequireNotStarted("Start");
+        started = true;
+        marketDataThread = std::thread(receive, this);
+        alertThread = std::thread(&RMS::DeliverAlerts, this);
+    }
+
+    // Any thread: both threads return within a receive timeout or a park
+    void Stop() {
+        running.store(false, std::memory_order_relaxed);
+        riskMonitor.signal().notify();
     }
 
     void ReceiveMarketData() {
-        while (true) {
+        while (running.load(std::memory_order_relaxed)) {
             zmq::message_t update;
-            subscriber.recv(&update);
-            std::string update_str(static_cast<char*>(update.data()), update.size());
-            // Process the update
-            // ...
+            if (subscriber.recv(&update))
+                OnHubMessage(update.data(), update.size());
+            else
+                PublishVarInputs(); // a quiet feed still answers the VaR calls
         }
     }
 
-    void FetchPositionData() {
-        // Fetch position data from the OMS
-        // ...
+    // Call before Start: a zmq socket must stay on one thread
+    void Subscribe(const wire::Topic& topic) {
+        subscriber.setsockopt(ZMQ_SUBSCRIBE, topic.bytes, topic.size);
     }
 
+    // Hub messages are read in place, see hub_messages.hpp
+    void OnHubMessage(const void* data, size_t size) {
+        ApplyFills();
+        PublishVarInputs();
+        wire::MessageHeader headerCopy;
+        const wire::MessageHeader* header = wire::peek_header(data, size, headerCopy);
+        if (header == nullptr)
+            return; // unknown version or truncated
+        switch (header->type) {
+            case wire::MessageType::BBO:
+                wire::BboUpdate bboCopy;
+                if (const wire::BboUpdate* bbo = wire::message_cast<wire::BboUpdate>(data, size, bboCopy)) {
+                    // Process the new top of book
+                    preTrade.update_reference(header->symbol_id, bbo->bid_price, bbo->offer_price);
+                    positionBook.on_quote(header->symbol_id, wire::from_wire_price(bbo->bid_price),
+                                          wire::from_wire_price(bbo->offer_price));
+                    MonitorRisk(header->symbol_id);
+                    // ...
+                }
+                break;
+            case wire::MessageType::DEPTH_DELTA:
+            case wire::MessageType::TRADE:
+            case wire::MessageType::ORDER_STATE:
+                // ...
+                break;
+        }
+    }
+
+    void ReceiveShmMarketData() {
+        uint32_t idle = 0;
+        while (running.load(std::memory_order_relaxed)) {
+            size_t received = shmSubscriber->poll([&](const char* data, uint32_t length) {
+                OnHubMessage(data, length); // in place, no copy out of the ring
+            });
+            if (received)
+                idle = 0;
+            else if (shmSubscriber->disconnected())
+                shmSubscriber->rejoin(); // fell a full ring behind under the DISCONNECT policy
+            else {
+                PublishVarInputs();
+                waiter.idle(idle++);
+            }
+        }
+    }
+
+    void ReceiveConflatedMarketData() {
+        wait::WakeSignal& updates = conflated->wake_signal();
+        uint32_t idle = 0;
+        while (running.load(std::memory_order_relaxed)) {
+            uint32_t seen = updates.current();
+            ApplyFills();
+            PublishVarInputs();
+            size_t delivered = conflated->drain(consumerId, [&](const conflation::MarketSnapshot& snapshot) {
+                // The latest state of snapshot.symbol_id, as a hub BBO would bring it
+                const double bid = snapshot.best_bid().price, offer = snapshot.best_offer().price;
+                preTrade.update_reference(snapshot.symbol_id, wire::to_wire_price(bid), wire::to_wire_price(offer));
+                positionBook.on_quote(snapshot.symbol_id, bid, offer);
+                MonitorRisk(snapshot.symbol_id);
+            });
+            if (delivered) {
+                idle = 0;
+                CalculateRiskMetrics(); // a batch touched many symbols: remark them all at once
+            }
+            else
+                waiter.idle(idle++, &updates, seen);
+        }
+    }
+
+    // Risk is not latency critical: typically SPIN_PARK so an idle RMS gives its core back.
+    // Before Start.
+    void SetWaitStrategy(const wait::WaitStrategy& strategy) {
+        RequireNotStarted("SetWaitStrategy");
+        waiter = strategy;
+    }
+
+    conflation::ConsumerMetrics ConflationMetrics() const {
+        return conflated->metrics(consumerId);
+    }
+
+    // Start of day position from the OMS; before Start
+    void FetchPositionData(uint32_t symbolId, double quantity, double averageCost) {
+        RequireNotStarted("FetchPositionData");
+        positionBook.load(symbolId, quantity, averageCost);
+    }
+
+    // Any thread
+    void OnFill(const Fill& fill) {
+        while (!fills.try_push(fill))
+            wait::cpu_relax();
+    }
+
+    // Market data thread
+    void ApplyFills() {
+        fills.drain([&](const Fill& fill) {
+            positionBook.on_fill(fill.symbol_id, fill.is_buy, fill.quantity, fill.price);
+            MonitorRisk(fill.symbol_id);
+        });
+    }
+
+    // Market data thread, once per message or idle pass: copies the position columns the VaR
+    // calls asked for since the last copy
+    void PublishVarInputs() {
+        const uint64_t requested = varRequested.load(std::memory_order_acquire);
+        if (requested == varPublished.load(std::memory_order_relaxed))
+            return;
+        {
+            std::lock_guard<std::mutex> lock(varInputsLock);
+            const size_t n = varInputs[0].size();
+            std::copy(positionBook.quantities(), positionBook.quantities() + n, varInputs[0].begin());
+            std::copy(positionBook.marks(), positionBook.marks() + n, varInputs[1].begin());
+        }
+        varPublished.store(requested, std::memory_order_release);
+    }
+
+    // Positions as of now: a copy from the market data thread once it runs, the book itself
+    // before Start. varLock held.
+    void FetchVarColumns() {
+        if (started) {
+            const uint64_t ticket = varRequested.fetch_add(1, std::memory_order_acq_rel) + 1;
+            while (varPublished.load(std::memory_order_acquire) < ticket) {
+                if (!running.load(std::memory_order_relaxed))
+                    throw std::logic_error("RMS stopped, no positions to revalue");
+                std::this_thread::yield();
+            }
+        } else {
+            varRequested.fetch_add(1, std::memory_order_relaxed);
+            PublishVarInputs();
+        }
+        std::lock_guard<std::mutex> lock(varInputsLock);
+        varColumns[0] = varInputs[0];
+        varColumns[1] = varInputs[1];
+    }
+
+    // Market data thread: marks every position to its latest mid in one pass, which also
+    // clears the rounding the incremental totals pick up
     void CalculateRiskMetrics() {
-        // Calculate risk metrics
-        // ...
+        riskMetrics.portfolio = positionBook.remark();
+    }
+
+    // Before Start
+    void SetAccountLimits(uint32_t account, const pretrade::Limits& limits) {
+        RequireNotStarted("SetAccountLimits");
+        preTrade.set_limits(account, limits);
+    }
+
+    // Returns the pretrade::Failure bits, 0 when the order may go out; accepted orders count
+    // against the account until OnExecution reports them done. ValidateOrder and OnExecution
+    // from one thread, the one the orders flow through.
+    uint32_t ValidateOrder(uint32_t account, const Order& order) {
+        return preTrade.check(account, order, latency::rdtsc());
     }
 
     bool ValidateOrder(const Order& order) {
-        // Validate order
-        // ...
-        return true;
+        return ValidateOrder(0, order) == 0;
     }
 
-    void AssessPortfolioRisk(const Order& order) {
-        // Assess portfolio risk
-        // ...
+    // order as it was before the report was applied
+    void OnExecution(uint32_t account, const Order& order, const order_state::ExecutionUpdate& update) {
+        preTrade.on_execution(account, order, update);
     }
 
-    void MonitorRisk() {
-        // Monitor risk
-        // ...
+    // Historical or Monte Carlo scenarios for VaR, see var_engine.hpp; before Start
+    void SetScenarios(std::unique_ptr<var::Scenarios> source, double confidence = 0.99) {
+        RequireNotStarted("SetScenarios");
+        if (source->symbols() > RMS_MAX_SYMBOLS)
+            throw std::invalid_argument("scenarios cover more symbols than the position table");
+        varEngine.reset(new var::VarEngine(*source, confidence));
+        for (int column = 0; column < 2; column++) {
+            varInputs[column].assign(source->symbols(), 0.0);
+            varColumns[column].assign(source->symbols(), 0.0);
+        }
+        scenarios = std::move(source);
     }
 
-    void SendAlert() {
-        // Send alert
-        // ...
+    // Any thread but the market data thread, which it waits for: revalues every position as
+    // of the call in every scenario, on all cores
+    var::RiskEstimate RevalueScenarios() {
+        if (!varEngine)
+            throw std::logic_error("no VaR scenarios set");
+        std::lock_guard<std::mutex> lock(varLock);
+        FetchVarColumns();
+        riskMetrics.valueAtRisk = varEngine->revalue(varColumns[0].data(), varColumns[1].data());
+        return riskMetrics.valueAtRisk;
+    }
+
+    // Any thread: VaR and ES of the portfolio as last revalued plus order in symbolId, from the
+    // cached scenario PnL; waits for a revaluation in progress
+    var::RiskEstimate AssessPortfolioRisk(uint32_t symbolId, const Order& order) {
+        if (!varEngine)
+            throw std::logic_error("no VaR scenarios set");
+        std::lock_guard<std::mutex> lock(varLock);
+        return varEngine->what_if(symbolId, order.is_bid ? order.quantity : -order.quantity, order.price);
+    }
+
+    // Before Start: the market data thread evaluates against them without synchronization
+    void SetMonitorLimits(const monitor::Limits& limits) {
+        RequireNotStarted("SetMonitorLimits");
+        riskMonitor.set_limits(limits);
+    }
+
+    // Market data thread, after the position book changed symbolId: only that symbol and the
+    // portfolio totals are looked at, see risk_monitor.hpp
+    void MonitorRisk(uint32_t symbolId) {
+        riskMonitor.evaluate(symbolId, positionBook, latency::rdtsc());
+    }
+
+    // Alert thread: lowest scheduling class, parks until the monitor raises something
+    void DeliverAlerts() {
+        sched_param param{0};
+        pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+        while (running.load(std::memory_order_relaxed)) {
+            alertWaiter.wait_until([&]() { return riskMonitor.pending() || !running.load(std::memory_order_relaxed); },
+                                   &riskMonitor.signal());
+            riskMonitor.drain([&](const monitor::Alert& alert) { SendAlert(alert); });
+        }
+    }
+
+    void SendAlert(const monitor::Alert& alert) {
+        std::cerr << "RISK " << (alert.breached ? "BREACH " : "CLEARED ") << monitor::alert_name(alert.type)
+                  << " symbol=" << alert.symbol << " value=" << alert.value << " limit=" << alert.limit << std::endl;
     }
 
     void AnalyzeTrades() {
@@ -0,0 +1,554 @@
+#pragma once
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace shm
+{
+
+const uint32_t MAX_CONSUMERS = 16;
+// Distinct topics one conflated poll keeps apart; beyond them the poll stops and the next one
+// carries on
+const uint32_t CONFLATE_TOPICS = 4096;
+const uint64_t RING_MAGIC = 0x4c4f4248554252ULL; // "LOBHUBR"
+const uint32_t RING_VERSION = 2;
+
+// What the publisher does when a consumer falls a whole ring behind
+enum class SlowConsumerPolicy : uint32_t {
+    DROP_NEWEST, // the publisher skips the update: every consumer loses it, nobody is overrun
+    DROP_OLDEST, // the consumer is overrun and resumes from the oldest record still in the ring
+    CONFLATE,    // past half a ring of lag the consumer jumps ahead, keeping the latest record per topic
+    DISCONNECT   // the consumer is detached and has to rejoin() from the live position
+};
+
+inline const char* policy_name(SlowConsumerPolicy policy) {
+    switch (policy) {
+        case SlowConsumerPolicy::DROP_NEWEST: return "drop_newest";
+        case SlowConsumerPolicy::DROP_OLDEST: return "drop_oldest";
+        case SlowConsumerPolicy::CONFLATE: return "conflate";
+        case SlowConsumerPolicy::DISCONNECT: return "disconnect";
+    }
+    return "unknown";
+}
+
+// Consumer slot states
+const uint32_t SLOT_FREE = 0;
+const uint32_t SLOT_ACTIVE = 1;
+const uint32_t SLOT_DISCONNECTED = 2; // kicked out by the publisher, still owned by the subscriber
+const uint32_t SLOT_CLAIMING = 3;     // subscriber is filling in the slot
+
+struct alignas(64) ConsumerCursor {
+    std::atomic<uint64_t> read_pos;
+    std::atomic<uint32_t> active;
+    std::atomic<uint32_t> policy;
+    std::atomic<uint64_t> acked; // sequence of the last record read or skipped
+    std::atomic<uint64_t> lost;  // messages skipped by an overrun, conflation or a disconnect
+};
+
+// Publisher-side view of one consumer
+struct ConsumerStats {
+    uint32_t slot;
+    uint32_t state;
+    SlowConsumerPolicy policy;
+    uint64_t lag_bytes;
+    uint64_t lag_messages;
+    uint64_t lost;
+};
+
+// Lives at the start of the shared mapping; every field is read by other processes
+struct RingHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t max_consumers;
+    uint64_t capacity; // bytes of data area, power of two
+    alignas(64) std::atomic<uint64_t> write_pos;
+    std::atomic<uint64_t> published;  // messages committed, also the sequence of the last record
+    std::atomic<uint64_t> tail_pos;   // oldest record not yet overwritten
+    ConsumerCursor consumers[MAX_CONSUMERS];
+};
+
+struct RecordHeader {
+    uint32_t length; // payload bytes, or bytes skipped for a padding record
+    uint32_t flags;
+    uint64_t sequence; // 1-based message sequence, lets a reader count what it missed
+};
+const uint32_t RECORD_PADDING = 1;
+
+inline size_t data_offset() { return (sizeof(RingHeader) + 63) & ~size_t(63); }
+inline uint64_t record_size(size_t payload) { return sizeof(RecordHeader) + ((payload + 7) & ~uint64_t(7)); }
+
+// RAII shm_open + mmap. The creator owns the name and unlinks it on destruction.
+class SharedRegion {
+private:
+    std::string name;
+    void* base = nullptr;
+    size_t size = 0;
+    bool owner;
+
+public:
+    SharedRegion(const std::string& name, size_t create_size) : name(name), owner(create_size > 0) {
+        int fd = owner ? shm_open(name.c_str(), O_CREAT | O_RDWR | O_TRUNC, 0600)
+                       : shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+        if (owner) {
+            if (ftruncate(fd, create_size) != 0) {
+                int err = errno;
+                ::close(fd);
+                throw std::system_error(err, std::generic_category(), "ftruncate " + name);
+            }
+            size = create_size;
+        } else {
+            struct stat st;
+            fstat(fd, &st);
+            size = st.st_size;
+        }
+        base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+        int err = errno;
+        ::close(fd);
+        if (base == MAP_FAILED)
+            throw std::system_error(err, std::generic_category(), "mmap " + name);
+    }
+    ~SharedRegion() {
+        munmap(base, size);
+        if (owner)
+            shm_unlink(name.c_str());
+    }
+    SharedRegion(const SharedRegion&) = delete;
+    SharedRegion& operator=(const SharedRegion&) = delete;
+
+    char* data() const { return static_cast<char*>(base); }
+    size_t bytes() const { return size; }
+};
+
+// Single producer, up to MAX_CONSUMERS readers in any process. Variable-length records are
+// written in place; every consumer has its own cursor in the shared header. The producer
+// never overwrites bytes a DROP_NEWEST consumer has not read yet; the other policies are
+// applied to a consumer that falls too far behind so it cannot stall the publisher.
+class ShmPublisher {
+private:
+    SharedRegion region;
+    RingHeader* header;
+    char* ring;
+    uint64_t mask;
+    uint64_t write_pos = 0;
+    uint64_t cached_min_read = 0; // refreshed only when the ring looks full
+    uint64_t tail_pos = 0;
+    uint64_t published = 0;
+    uint64_t dropped = 0;
+    uint64_t disconnected = 0;
+    uint64_t claimed = 0;
+
+    // Oldest position the publisher must preserve to write up to limit. DISCONNECT consumers
+    // that would block the write are detached here; lossy consumers never hold it back.
+    uint64_t min_read_pos(uint64_t limit) {
+        uint64_t capacity = mask + 1;
+        uint64_t min_pos = write_pos;
+        for (uint32_t i = 0; i < MAX_CONSUMERS; i++) {
+            ConsumerCursor& consumer = header->consumers[i];
+            if (consumer.active.load(std::memory_order_acquire) != SLOT_ACTIVE)
+                continue;
+            SlowConsumerPolicy policy = static_cast<SlowConsumerPolicy>(consumer.policy.load(std::memory_order_relaxed));
+            if (policy == SlowConsumerPolicy::DROP_OLDEST || policy == SlowConsumerPolicy::CONFLATE)
+                continue;
+            uint64_t pos = consumer.read_pos.load(std::memory_order_acquire);
+            if (policy == SlowConsumerPolicy::DISCONNECT && limit - pos > capacity) {
+                uint32_t expected = SLOT_ACTIVE;
+                if (consumer.active.compare_exchange_strong(expected, SLOT_DISCONNECTED, std::memory_order_acq_rel))
+                    disconnected++;
+                continue;
+            }
+            if (pos < min_pos)
+                min_pos = pos;
+        }
+        return min_pos;
+    }
+
+    // Publishes where the oldest intact record now starts, before its bytes are reused.
+    // Lossy readers validate their copies against it, like a seqlock.
+    void advance_tail(uint64_t target) {
+        if (tail_pos >= target)
+            return;
+        while (tail_pos < target) {
+            const RecordHeader* rec = reinterpret_cast<const RecordHeader*>(ring + (tail_pos & mask));
+            tail_pos += (rec->flags & RECORD_PADDING) ? rec->length : record_size(rec->length);
+        }
+        header->tail_pos.store(tail_pos, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+public:
+    static const uint64_t DEFAULT_CAPACITY = 1 << 24;
+
+    ShmPublisher(const std::string& name, uint64_t capacity = DEFAULT_CAPACITY)
+        : region(name, data_offset() + capacity) {
+        if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+            throw std::invalid_argument("shm ring capacity must be a power of two");
+        header = new (region.data()) RingHeader();
+        header->magic = RING_MAGIC;
+        header->version = RING_VERSION;
+        header->max_consumers = MAX_CONSUMERS;
+        header->capacity = capacity;
+        header->write_pos.store(0, std::memory_order_relaxed);
+        header->published.store(0, std::memory_order_relaxed);
+        header->tail_pos.store(0, std::memory_order_relaxed);
+        for (uint32_t i = 0; i < MAX_CONSUMERS; i++) {
+            header->consumers[i].read_pos.store(0, std::memory_order_relaxed);
+            header->consumers[i].active.store(SLOT_FREE, std::memory_order_relaxed);
+            header->consumers[i].policy.store(0, std::memory_order_relaxed);
+            header->consumers[i].acked.store(0, std::memory_order_relaxed);
+            header->consumers[i].lost.store(0, std::memory_order_relaxed);
+        }
+        ring = region.data() + data_offset();
+        mask = capacity - 1;
+    }
+
+    // Reserves room for a payload and returns where to write it, or nullptr when a
+    // DROP_NEWEST consumer is too far behind. Nothing is visible until commit().
+    char* claim(size_t length) {
+        uint64_t needed = record_size(length);
+        uint64_t capacity = mask + 1;
+        uint64_t offset = write_pos & mask;
+        uint64_t tail_room = capacity - offset;
+        if (tail_room < needed)
+            needed += tail_room; // the record goes to the start, after a padding record
+        if (needed > capacity)
+            return nullptr;
+        if (write_pos + needed - cached_min_read > capacity) {
+            cached_min_read = min_read_pos(write_pos + needed);
+            if (write_pos + needed - cached_min_read > capacity) {
+                dropped++;
+                return nullptr;
+            }
+        }
+        if (write_pos + needed > capacity)
+            advance_tail(write_pos + needed - capacity);
+        if (tail_room < record_size(length)) {
+            RecordHeader* pad = reinterpret_cast<RecordHeader*>(ring + offset);
+            pad->length = static_cast<uint32_t>(tail_room);
+            pad->flags = RECORD_PADDING;
+            pad->sequence = 0;
+            write_pos += tail_room;
+            offset = 0;
+        }
+        RecordHeader* rec = reinterpret_cast<RecordHeader*>(ring + offset);
+        rec->length = static_cast<uint32_t>(length);
+        rec->flags = 0;
+        rec->sequence = published + 1;
+        claimed = record_size(length);
+        return ring + offset + sizeof(RecordHeader);
+    }
+
+    void commit() {
+        write_pos += claimed;
+        claimed = 0;
+        header->published.store(++published, std::memory_order_relaxed);
+        header->write_pos.store(write_pos, std::memory_order_release);
+    }
+
+    bool send(const void* data, size_t length) {
+        char* dst = claim(length);
+        if (dst == nullptr)
+            return false;
+        std::memcpy(dst, data, length);
+        commit();
+        return true;
+    }
+
+    uint64_t dropped_messages() const { return dropped; }
+    uint64_t disconnected_consumers() const { return disconnected; }
+    uint64_t position() const { return write_pos; }
+
+    // Lag of every attached consumer, read from the shared cursors. Cheap enough to poll
+    // from a metrics thread; never called on the publish path.
+    std::vector<ConsumerStats> consumer_stats() const {
+        std::vector<ConsumerStats> stats;
+        uint64_t w = header->write_pos.load(std::memory_order_acquire);
+        uint64_t messages = header->published.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < MAX_CONSUMERS; i++) {
+            const ConsumerCursor& consumer = header->consumers[i];
+            uint32_t state = consumer.active.load(std::memory_order_acquire);
+            if (state != SLOT_ACTIVE && state != SLOT_DISCONNECTED)
+                continue;
+            ConsumerStats s;
+            s.slot = i;
+            s.state = state;
+            s.policy = static_cast<SlowConsumerPolicy>(consumer.policy.load(std::memory_order_relaxed));
+            uint64_t r = consumer.read_pos.load(std::memory_order_acquire);
+            s.lag_bytes = w > r ? w - r : 0;
+            uint64_t acked = consumer.acked.load(std::memory_order_relaxed);
+            s.lag_messages = messages > acked ? messages - acked : 0;
+            s.lost = consumer.lost.load(std::memory_order_relaxed);
+            stats.push_back(s);
+        }
+        return stats;
+    }
+};
+
+class ShmSubscriber {
+private:
+    SharedRegion region;
+    RingHeader* header;
+    const char* ring;
+    uint64_t mask;
+    ConsumerCursor* cursor = nullptr;
+    SlowConsumerPolicy policy;
+    uint64_t joined_at = 0; // sequence published when we (re)attached
+    uint64_t acked = 0;
+    uint64_t consumed = 0;
+    uint64_t lost = 0;
+    std::vector<char> scratch; // copy of a record, trusted once checked against tail_pos
+
+    // CONFLATE only, allocated with the subscriber: the latest record of each topic seen by the
+    // current conflated poll, in an open-addressing table cleared by bumping the epoch
+    struct ConflatedTopic {
+        uint64_t key;      // first 5 bytes of the message
+        uint32_t epoch;    // entry is in use when it matches conflate_epoch
+        uint32_t length;
+        uint64_t offset;   // of its bytes in conflated_bytes
+        uint64_t capacity;
+    };
+    std::vector<ConflatedTopic> topics;
+    std::vector<uint32_t> topic_order; // entries in order of first appearance
+    std::vector<char> conflated_bytes;
+    uint64_t conflated_used = 0;
+    uint32_t conflate_epoch = 0;
+
+    uint64_t tail() const {
+        return header->tail_pos.load(std::memory_order_acquire);
+    }
+
+    // Copies the record at r into rec and scratch. False when the publisher overwrote it meanwhile.
+    bool copy_record(uint64_t r, RecordHeader& rec) {
+        std::memcpy(&rec, ring + (r & mask), sizeof(RecordHeader));
+        const uint64_t room = mask + 1 - (r & mask); // a record never wraps
+        if (rec.length > room || (!(rec.flags & RECORD_PADDING) && sizeof(RecordHeader) + rec.length > room))
+            return false; // torn header
+        if (!(rec.flags & RECORD_PADDING)) {
+            if (scratch.size() < rec.length)
+                scratch.resize(rec.length);
+            std::memcpy(scratch.data(), ring + (r & mask) + sizeof(RecordHeader), rec.length);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return header->tail_pos.load(std::memory_order_relaxed) <= r;
+    }
+
+    template <typename Callback>
+    uint64_t read_in_place(uint64_t r, uint64_t w, Callback& on_message, size_t& n, size_t max_messages) {
+        while (r < w && n < max_messages) {
+            const RecordHeader* rec = reinterpret_cast<const RecordHeader*>(ring + (r & mask));
+            if (rec->flags & RECORD_PADDING) {
+                r += rec->length;
+                continue;
+            }
+            on_message(reinterpret_cast<const char*>(rec + 1), rec->length);
+            acked = rec->sequence;
+            r += record_size(rec->length);
+            n++;
+        }
+        return r;
+    }
+
+    // DROP_OLDEST: read from copies, and jump to the oldest intact record when overrun.
+    // DISCONNECT reads the same way, since the publisher reuses a detached reader's bytes at
+    // once, but stops at the first overwritten record: it was detached before the overwrite.
+    template <typename Callback>
+    uint64_t read_copies(uint64_t r, uint64_t w, Callback& on_message, size_t& n, size_t max_messages) {
+        RecordHeader rec;
+        while (r < w && n < max_messages) {
+            if (r < tail() || !copy_record(r, rec)) {
+                if (policy == SlowConsumerPolicy::DISCONNECT)
+                    break;
+                r = tail();
+                continue;
+            }
+            if (rec.flags & RECORD_PADDING) {
+                r += rec.length;
+                continue;
+            }
+            on_message(static_cast<const char*>(scratch.data()), rec.length);
+            acked = rec.sequence;
+            r += record_size(rec.length);
+            n++;
+        }
+        return r;
+    }
+
+    // Index of key's entry in the current epoch, or of the free entry it would take
+    size_t conflated_slot(uint64_t key) const {
+        const size_t table_mask = topics.size() - 1;
+        size_t i = (key * 0x9e3779b97f4a7c15ULL >> 32) & table_mask;
+        while (topics[i].epoch == conflate_epoch && topics[i].key != key)
+            i = (i + 1) & table_mask;
+        return i;
+    }
+
+    // CONFLATE: keeps only the latest record per topic (the first 5 bytes of a hub message)
+    // between r and w and delivers those, in order of first appearance. At most max_messages
+    // topics: the scan stops before the first record of one more, or of one that does not fit
+    // the preallocated table, and the next poll starts there.
+    template <typename Callback>
+    uint64_t read_conflated(uint64_t r, uint64_t w, Callback& on_message, size_t& n, size_t max_messages) {
+        if (++conflate_epoch == 0) { // wrapped: entries of epoch 0 would look current
+            for (ConflatedTopic& entry : topics)
+                entry.epoch = 0;
+            conflate_epoch = 1;
+        }
+        topic_order.clear();
+        conflated_used = 0;
+        RecordHeader rec;
+        while (r < w) {
+            if (r < tail() || !copy_record(r, rec)) {
+                r = tail(); // lapped during the scan: carry on from the oldest intact record
+                continue;
+            }
+            if (rec.flags & RECORD_PADDING) {
+                r += rec.length;
+                continue;
+            }
+            uint64_t key = 0;
+            std::memcpy(&key, scratch.data(), rec.length < 5 ? rec.length : 5);
+            const size_t slot = conflated_slot(key);
+            ConflatedTopic& topic = topics[slot];
+            const bool known = topic.epoch == conflate_epoch;
+            if (!known && (topic_order.size() >= max_messages || topic_order.size() == CONFLATE_TOPICS))
+                break;
+            const bool grows = !known || rec.length > topic.capacity;
+            if (grows && conflated_bytes.size() - conflated_used < rec.length)
+                break; // out of room for this scan: the rest waits for the next poll
+            if (!known) {
+                topic = ConflatedTopic{key, conflate_epoch, 0, 0, 0};
+                topic_order.push_back(static_cast<uint32_t>(slot));
+            }
+            if (grows) {
+                topic.offset = conflated_used;
+                topic.capacity = rec.length;
+                conflated_used += rec.length;
+            }
+            std::memcpy(conflated_bytes.data() + topic.offset, scratch.data(), rec.length);
+            topic.length = rec.length;
+            acked = rec.sequence;
+            r += record_size(rec.length);
+        }
+        for (uint32_t index : topic_order) {
+            const ConflatedTopic& topic = topics[index];
+            on_message(static_cast<const char*>(conflated_bytes.data() + topic.offset), topic.length);
+            n++;
+        }
+        return r;
+    }
+
+public:
+    explicit ShmSubscriber(const std::string& name, SlowConsumerPolicy policy = SlowConsumerPolicy::DROP_NEWEST)
+        : region(name, 0), policy(policy) {
+        header = reinterpret_cast<RingHeader*>(region.data());
+        if (region.bytes() < data_offset() || header->magic != RING_MAGIC || header->version != RING_VERSION)
+            throw std::runtime_error("not a hub ring: " + name);
+        ring = region.data() + data_offset();
+        mask = header->capacity - 1;
+        for (uint32_t i = 0; i < MAX_CONSUMERS && cursor == nullptr; i++) {
+            uint32_t expected = SLOT_FREE;
+            if (header->consumers[i].active.load(std::memory_order_relaxed) == SLOT_FREE &&
+                header->consumers[i].active.compare_exchange_strong(expected, SLOT_CLAIMING, std::memory_order_seq_cst))
+                cursor = &header->consumers[i];
+        }
+        if (cursor == nullptr)
+            throw std::runtime_error("no free consumer slot in " + name);
+        if (policy == SlowConsumerPolicy::CONFLATE) {
+            // A conflated poll scans at most a ring's worth of records, whose latest per topic fit
+            topics.assign(2 * CONFLATE_TOPICS, ConflatedTopic{0, 0, 0, 0, 0});
+            topic_order.reserve(CONFLATE_TOPICS);
+            conflated_bytes.resize(header->capacity);
+        }
+        cursor->policy.store(static_cast<uint32_t>(policy), std::memory_order_relaxed);
+        cursor->lost.store(0, std::memory_order_relaxed);
+        // Start from the live position: the publisher may have moved on while we registered
+        uint64_t w = header->write_pos.load(std::memory_order_acquire);
+        joined_at = acked = header->published.load(std::memory_order_relaxed);
+        cursor->acked.store(acked, std::memory_order_relaxed);
+        cursor->read_pos.store(w, std::memory_order_relaxed);
+        cursor->active.store(SLOT_ACTIVE, std::memory_order_release);
+    }
+    ~ShmSubscriber() {
+        cursor->active.store(SLOT_FREE, std::memory_order_release);
+    }
+    ShmSubscriber(const ShmSubscriber&) = delete;
+    ShmSubscriber& operator=(const ShmSubscriber&) = delete;
+
+    // Calls on_message(const char* data, uint32_t length) for each new record. DROP_NEWEST
+    // reads in place; the other policies read from a private copy since the publisher may be
+    // overwriting the record, or may detach a DISCONNECT reader mid-poll and reuse its bytes.
+    // The bytes stay valid until poll() returns.
+    // Returns the number of records delivered.
+    template <typename Callback>
+    size_t poll(Callback&& on_message, size_t max_messages = SIZE_MAX) {
+        if (cursor->active.load(std::memory_order_relaxed) != SLOT_ACTIVE)
+            return 0;
+        uint64_t w = header->write_pos.load(std::memory_order_acquire);
+        uint64_t r = cursor->read_pos.load(std::memory_order_relaxed);
+        size_t n = 0;
+        switch (policy) {
+            case SlowConsumerPolicy::DROP_NEWEST:
+                r = read_in_place(r, w, on_message, n, max_messages);
+                break;
+            case SlowConsumerPolicy::DISCONNECT:
+            case SlowConsumerPolicy::DROP_OLDEST:
+                r = read_copies(r, w, on_message, n, max_messages);
+                break;
+            case SlowConsumerPolicy::CONFLATE:
+                if (w - r > (mask + 1) / 2 || r < tail())
+                    r = read_conflated(r, w, on_message, n, max_messages);
+                else
+                    r = read_copies(r, w, on_message, n, max_messages);
+                break;
+        }
+        consumed += n;
+        uint64_t missed = acked - joined_at - consumed;
+        if (missed != lost) {
+            lost = missed;
+            cursor->lost.store(lost, std::memory_order_relaxed);
+        }
+        cursor->acked.store(acked, std::memory_order_relaxed);
+        cursor->read_pos.store(r, std::memory_order_release);
+        return n;
+    }
+
+    // True once the publisher has detached this DISCONNECT consumer for lagging
+    bool disconnected() const {
+        return cursor->active.load(std::memory_order_acquire) == SLOT_DISCONNECTED;
+    }
+
+    // Reattaches a disconnected consumer at the live position. What was published while it
+    // was detached is not replayed and is counted as lost.
+    void rejoin() {
+        uint64_t w = header->write_pos.load(std::memory_order_acquire);
+        uint64_t published = header->published.load(std::memory_order_relaxed);
+        acked = published;
+        lost = acked - joined_at - consumed;
+        cursor->lost.store(lost, std::memory_order_relaxed);
+        cursor->acked.store(acked, std::memory_order_relaxed);
+        cursor->read_pos.store(w, std::memory_order_relaxed);
+        cursor->active.store(SLOT_ACTIVE, std::memory_order_release);
+    }
+
+    // Bytes published but not yet consumed by this subscriber
+    uint64_t lag() const {
+        return header->write_pos.load(std::memory_order_acquire) - cursor->read_pos.load(std::memory_order_relaxed);
+    }
+
+    // Messages this subscriber never saw: overwritten, conflated away or missed while detached
+    uint64_t lost_messages() const { return lost; }
+    SlowConsumerPolicy slow_consumer_policy() const { return policy; }
+};
+
+} // namespace shm
@@ -14,8 +14,8 @@ public:
     SmartBlockingLimitOrderBook(int precision, int depth): LimitOrderBook(precision, depth){}
 
 
-    void add_order(const Order& order, bool is_bid) override {
-        LimitOrderBook::add_order(order, is_bid);
+    bool add_order(const Order& order, bool is_bid) override {
+        bool applied = LimitOrderBook::add_order(order, is_bid);
         //check if pointer has changed
         if (TMP_ptr_bid_end != ptr_bid_end)
         {
@@ -23,6 +23,7 @@ public:
             std::unique_lock<std::shared_mutex> lock(lob_mutex);
             TMP_ptr_bid_end = ptr_bid_end;
         }
+        return applied;
     }
 
     Order get_best_bid() override {
@@ -1,4 +1,6 @@
 #include "exploring_circular_array.hpp"
+#include "latency_tracer.hpp"
+#include "wait_strategy.hpp"
 #include <thread>
 #include <sched.h>
 
@@ -9,9 +11,14 @@ namespace strategy {
     class StrategyModule {
     private:
         LimitOrderBook& orderBook;
+        wait::WakeSignal* bookUpdates;
+        wait::WaitStrategy waiter;
 
     public:
-        StrategyModule(LimitOrderBook& lob) : orderBook(lob) {}
+        StrategyModule(LimitOrderBook& lob) : orderBook(lob), bookUpdates(nullptr) {}
+        // Evaluate only when the feed handler signals a book change, idling with the given strategy
+        StrategyModule(LimitOrderBook& lob, wait::WakeSignal& updates, wait::WaitStrategy waiter)
+            : orderBook(lob), bookUpdates(&updates), waiter(waiter) {}
 
         void run() {
             // Pin this thread to the first CPU core
@@ -20,29 +27,42 @@ namespace strategy {
             CPU_SET(0, &cpuset);
             pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
 
-            // Busy waiting loop
-            while (true) {
-                Order best_bid = orderBook.get_best_bid();
-                Order best_offer = orderBook.get_best_offer();
-
-                // Dummy strategy logic
-                if (best_bid.price > 100 && best_offer.price < 200) {
-                    // Place a buy order
-                    Order buy_order;
-                    buy_order.price = best_offer.price - 1;
-                    buy_order.quantity = 100;
-                    orderBook.add_order(buy_order, true);
-                    std::cout << "Placed buy order at price: " << buy_order.price << "\n";
-                }
-                else if (best_offer.price > 300 && best_bid.price < 400) {
-                    // Place a sell order
-                    Order sell_order;
-                    sell_order.price = best_bid.price + 1;
-                    sell_order.quantity = 100;
-                    orderBook.add_order(sell_order, false);
-                    std::cout << "Placed sell order at price: " << sell_order.price << "\n";
+            if (bookUpdates == nullptr) {
+                // Busy waiting loop
+                while (true) {
+                    on_book_update();
                 }
             }
+            uint32_t seen = bookUpdates->current();
+            while (true) {
+                seen = waiter.wait_for(*bookUpdates, seen);
+                on_book_update();
+            }
+        }
+
+        // Strategy callback: evaluate the current top of book and place orders
+        void on_book_update() {
+            TRACE_SCOPE(latency::Stage::STRATEGY_CALLBACK);
+            Order best_bid = orderBook.get_best_bid();
+            Order best_offer = orderBook.get_best_offer();
+
+            // Dummy strategy logic
+            if (best_bid.price > 100 && best_offer.price < 200) {
+                // Place a buy order
+                Order buy_order;
+                buy_order.price = best_offer.price - 1;
+                buy_order.quantity = 100;
+                orderBook.add_order(buy_order, true);
+                std::cout << "Placed buy order at price: " << buy_order.price << "\n";
+            }
+            else if (best_offer.price > 300 && best_bid.price < 400) {
+                // Place a sell order
+                Order sell_order;
+                sell_order.price = best_bid.price + 1;
+                sell_order.quantity = 100;
+                orderBook.add_order(sell_order, false);
+                std::cout << "Placed sell order at price: " << sell_order.price << "\n";
+            }
         }
     };
 
@@ -11,10 +11,10 @@ private:
     std::shared_mutex lob_mutex;
 public:
     SynchronizedLimitOrderBook(int precision, int depth): LimitOrderBook(precision, depth){}
-    void add_order(const Order& order, bool is_bid) override {
+    bool add_order(const Order& order, bool is_bid) override {
         std::unique_lock<std::shared_mutex> lock(lob_mutex);
         // Call the base class method
-        LimitOrderBook::add_order(order, is_bid);
+        return LimitOrderBook::add_order(order, is_bid);
     }
 
     Order get_best_bid() override {
@@ -0,0 +1,82 @@
+#include <cassert>
+#include <iostream>
+#include "../conflation_buffer.hpp"
+
+    conflation::MarketSnapshot make_snapshot(uint32_t symbol_id, double bid, double offer)
+    {
+        conflation::MarketSnapshot snapshot{};
+        snapshot.symbol_id = symbol_id;
+        snapshot.bid_levels = snapshot.offer_levels = 1;
+        snapshot.bids[0] = {bid, 100};
+        snapshot.offers[0] = {offer, 100};
+        return snapshot;
+    }
+
+    void test_conflation_keeps_latest()
+    {
+        //Slow consumer drains after several updates => sees only the latest one per symbol
+        conflation::ConflationBuffer buffer(100, 2);
+        int fast = buffer.register_consumer();
+        int slow = buffer.register_consumer();
+
+        buffer.publish(make_snapshot(7, 10.01, 10.02));
+        int delivered = 0;
+        buffer.drain(fast, [&](const conflation::MarketSnapshot&) { delivered++; });
+        assert(delivered == 1);
+
+        buffer.publish(make_snapshot(7, 10.02, 10.03));
+        buffer.publish(make_snapshot(7, 10.03, 10.04));
+        buffer.publish(make_snapshot(70, 20.00, 20.01));
+
+        double last_bid = 0;
+        delivered = 0;
+        buffer.drain(slow, [&](const conflation::MarketSnapshot& s) {
+            if (s.symbol_id == 7) last_bid = s.best_bid().price;
+            delivered++;
+        });
+        assert(delivered == 2);
+        assert(last_bid == 10.03);
+        assert(buffer.metrics(slow).delivered == 2);
+        assert(buffer.metrics(slow).conflated == 2);
+        std::cout << "######CONFLATION TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_conflation_independent_consumers()
+    {
+        //Each consumer has its own dirty set: draining one does not consume the other's updates
+        conflation::ConflationBuffer buffer(10, 2);
+        int first = buffer.register_consumer();
+        int second = buffer.register_consumer();
+        assert(buffer.register_consumer() == -1);
+
+        buffer.publish(make_snapshot(3, 1.0, 2.0));
+        assert(buffer.drain(first, [](const conflation::MarketSnapshot&) {}) == 1);
+        assert(buffer.drain(first, [](const conflation::MarketSnapshot&) {}) == 0);
+        assert(buffer.drain(second, [](const conflation::MarketSnapshot&) {}) == 1);
+        assert(buffer.metrics(first).conflated == 0);
+        std::cout << "######CONFLATION TEST CASE 2 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_conflation_late_consumer()
+    {
+        //A consumer registered after updates were published does not count them as conflated
+        conflation::ConflationBuffer buffer(10, 2);
+        int early = buffer.register_consumer();
+        buffer.publish(make_snapshot(3, 1.0, 2.0));
+        buffer.publish(make_snapshot(3, 1.1, 2.1));
+        int late = buffer.register_consumer();
+        assert(buffer.drain(late, [](const conflation::MarketSnapshot&) {}) == 0);
+        buffer.publish(make_snapshot(3, 1.2, 2.2));
+        assert(buffer.drain(late, [](const conflation::MarketSnapshot&) {}) == 1);
+        assert(buffer.metrics(late).conflated == 0);
+        assert(buffer.drain(early, [](const conflation::MarketSnapshot&) {}) == 1);
+        assert(buffer.metrics(early).conflated == 2);
+        std::cout << "######CONFLATION TEST CASE 3 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_conflation_buffer_tests()
+    {
+        test_conflation_keeps_latest();
+        test_conflation_independent_consumers();
+        test_conflation_late_consumer();
+    }
@@ -0,0 +1,80 @@
+#include <cassert>
+#include <iostream>
+#include <map>
+#include <string>
+#include "../fix_encoder.hpp"
+
+    std::map<int, std::string> fix_fields(const std::string& message)
+    {
+        std::map<int, std::string> fields;
+        size_t start = 0;
+        while (start < message.size()) {
+            size_t equals = message.find('=', start);
+            size_t end = message.find(fix::SOH, equals);
+            fields[std::stoi(message.substr(start, equals - start))] = message.substr(equals + 1, end - equals - 1);
+            start = end + 1;
+        }
+        return fields;
+    }
+
+    // BodyLength and CheckSum recomputed from scratch, as the venue would
+    void check_fix_framing(const std::string& message)
+    {
+        size_t body_start = message.find(fix::SOH, message.find("9=")) + 1;
+        size_t trailer = message.rfind("10=");
+        assert(std::stoul(fix_fields(message)[9]) == trailer - body_start);
+        unsigned sum = 0;
+        for (size_t i = 0; i < trailer; i++)
+            sum += static_cast<unsigned char>(message[i]);
+        assert(std::stoul(fix_fields(message)[10]) == sum % 256);
+        assert(message.back() == fix::SOH);
+    }
+
+    void test_fix_encoder_new_order_single()
+    {
+        //Patched slots parse back to the order values and the framing stays valid order after order
+        fix::NewOrderSingleEncoder encoder("OMS", "VENUE", "LOB");
+        const uint64_t NOON = 1718884800ULL * 1000000000ULL; // 2024-06-20 12:00:00 UTC
+        order_state::OrderRecord order = order_state::make_order(42, 10.01, 300, true);
+        std::string first(encoder.data(), encoder.encode(order, 1, NOON + 1234567890ULL));
+        check_fix_framing(first);
+        std::map<int, std::string> fields = fix_fields(first);
+        assert(fields[8] == "FIX.4.4" && fields[35] == "D" && fields[49] == "OMS" && fields[56] == "VENUE");
+        assert(std::stoull(fields[34]) == 1 && std::stoull(fields[11]) == 42 && fields[54] == "1");
+        assert(std::stoul(fields[38]) == 300 && std::stod(fields[44]) == 10.01);
+        assert(fields[52] == "20240620-12:00:01.234" && fields[60] == fields[52]);
+
+        order = order_state::make_order(987654321, 1234.5678, 7, false);
+        std::string second(encoder.data(), encoder.encode(order, 2, NOON + 61000000000ULL)); // next minute
+        check_fix_framing(second);
+        fields = fix_fields(second);
+        assert(second.size() == first.size());
+        assert(std::stoull(fields[34]) == 2 && std::stoull(fields[11]) == 987654321 && fields[54] == "2");
+        assert(std::stoul(fields[38]) == 7 && fields[44] == "00001234.5678");
+        assert(fields[52] == "20240620-12:01:01.000");
+
+        order.quantity = 1000000000; // wider than the OrderQty slot
+        assert(encoder.encode(order, 3, NOON) == 0);
+        std::cout << "######FIX ENCODER TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_fix_encoder_cancel_request()
+    {
+        //OrderCancelRequest shares the header slots and framing with NewOrderSingle
+        fix::OrderCancelRequestEncoder encoder("OMS", "VENUE", "LOB");
+        const uint64_t NOON = 1718884800ULL * 1000000000ULL;
+        order_state::OrderRecord order = order_state::make_order(42, 10.01, 300, false);
+        std::string cancel(encoder.data(), encoder.encode(order, 1000000000000000001ULL, 7, NOON));
+        check_fix_framing(cancel);
+        std::map<int, std::string> fields = fix_fields(cancel);
+        assert(fields[35] == "F" && std::stoull(fields[34]) == 7 && fields[55] == "LOB");
+        assert(std::stoull(fields[11]) == 1000000000000000001ULL && std::stoull(fields[41]) == 42);
+        assert(fields[54] == "2" && std::stoul(fields[38]) == 300 && fields[60] == "20240620-12:00:00.000");
+        std::cout << "######FIX ENCODER TEST CASE 2 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_fix_encoder_tests()
+    {
+        test_fix_encoder_new_order_single();
+        test_fix_encoder_cancel_request();
+    }
@@ -0,0 +1,77 @@
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include "../hub_messages.hpp"
+
+    void test_hub_message_alignment()
+    {
+        //Aligned buffers are read in place; a buffer one byte off, as a ZeroMQ frame may be,
+        //is read through the copy with the same content
+        wire::BboUpdate update;
+        wire::init_header(update, 7, 42, 0);
+        update.bid_price = wire::to_wire_price(10.01);
+        update.bid_quantity = 100;
+        update.offer_price = wire::to_wire_price(10.02);
+        update.offer_quantity = 200;
+        alignas(8) char buffer[sizeof(wire::BboUpdate) + 8];
+        wire::BboUpdate copy;
+
+        std::memcpy(buffer, &update, sizeof(update));
+        const wire::BboUpdate* aligned = wire::message_cast<wire::BboUpdate>(buffer, sizeof(update), copy);
+        assert(aligned == reinterpret_cast<const wire::BboUpdate*>(buffer));
+
+        std::memcpy(buffer + 1, &update, sizeof(update));
+        const wire::BboUpdate* shifted = wire::message_cast<wire::BboUpdate>(buffer + 1, sizeof(update), copy);
+        assert(shifted == &copy);
+        assert(shifted->header.symbol_id == 7 && shifted->header.sequence == 42);
+        assert(shifted->bid_price == update.bid_price && shifted->offer_quantity == 200);
+        wire::MessageHeader headerCopy;
+        const wire::MessageHeader* header = wire::peek_header(buffer + 1, sizeof(update), headerCopy);
+        assert(header == &headerCopy && header->type == wire::MessageType::BBO);
+
+        assert(!wire::message_cast<wire::BboUpdate>(buffer + 1, sizeof(update) - 1, copy));        // truncated
+        assert(!wire::peek_header(buffer + 1, sizeof(wire::MessageHeader) - 1, headerCopy));
+        std::cout << "######HUB MESSAGES TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    // What a ZeroMQ SUB socket does with a subscription: match the leading bytes
+    bool topic_matches(const wire::Topic& topic, const void* message)
+    {
+        return std::memcmp(topic.bytes, message, topic.size) == 0;
+    }
+
+    void test_hub_message_topics()
+    {
+        //A symbol topic is the leading 4 bytes of every message about that symbol; adding the
+        //type narrows it to one message type. Other symbols never match, whatever their bytes
+        wire::BboUpdate bbo;
+        wire::init_header(bbo, 0x01020304, 1, 0);
+        wire::Trade trade;
+        wire::init_header(trade, 0x01020304, 2, 0);
+        wire::BboUpdate other;
+        wire::init_header(other, 0x01020305, 3, 0);
+        wire::BboUpdate byteSwapped;
+        wire::init_header(byteSwapped, 0x04030201, 4, 0);
+
+        wire::Topic symbol = wire::make_topic(0x01020304);
+        assert(symbol.size == wire::SYMBOL_TOPIC_SIZE);
+        assert(topic_matches(symbol, &bbo) && topic_matches(symbol, &trade));
+        assert(!topic_matches(symbol, &other) && !topic_matches(symbol, &byteSwapped));
+
+        wire::Topic bboOnly = wire::make_topic(0x01020304, wire::MessageType::BBO);
+        assert(bboOnly.size == wire::TOPIC_SIZE);
+        assert(topic_matches(bboOnly, &bbo) && !topic_matches(bboOnly, &trade) && !topic_matches(bboOnly, &other));
+
+        //Messages with the same topic may share a batch, see ZmqTransport::queue
+        wire::BboUpdate next;
+        wire::init_header(next, 0x01020304, 5, 0);
+        assert(wire::same_topic(&bbo, &next));
+        assert(!wire::same_topic(&bbo, &trade) && !wire::same_topic(&bbo, &other));
+        std::cout << "######HUB MESSAGES TEST CASE 2 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_hub_messages_tests()
+    {
+        test_hub_message_alignment();
+        test_hub_message_topics();
+    }
@@ -0,0 +1,101 @@
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <thread>
+#include "../hub_transport.hpp"
+#include "../lockfree_queue.hpp"
+
+    void test_message_pool_recycles()
+    {
+        //Buffers are distinct and cache line sized; an empty pool counts the miss instead of
+        //allocating, and a released buffer comes back
+        hub_transport::MessagePool pool(4, 100);
+        assert(pool.capacity_bytes() == 128);
+        std::set<char*> buffers;
+        for (int i = 0; i < 4; i++) {
+            char* buffer = pool.acquire();
+            assert(buffer != nullptr && reinterpret_cast<uintptr_t>(buffer) % 64 == 0);
+            std::memset(buffer, i, pool.capacity_bytes());
+            buffers.insert(buffer);
+        }
+        assert(buffers.size() == 4);
+        char* first = *buffers.begin();
+        char* last = *buffers.rbegin();
+        assert(last - first == 3 * 128);
+        assert(pool.acquire() == nullptr && pool.exhausted_count() == 1);
+
+        hub_transport::MessagePool::release_callback(last, &pool);  // as ZeroMQ would
+        assert(pool.acquire() == last);
+        pool.release(first);
+        pool.release(last);
+        assert(pool.acquire() == last && pool.acquire() == first);  // most recently released first
+        assert(pool.acquire() == nullptr && pool.exhausted_count() == 2);
+
+        hub_transport::MessagePool empty(0, 64);
+        assert(empty.acquire() == nullptr);
+        std::cout << "######HUB TRANSPORT TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_message_pool_concurrent_release()
+    {
+        //One thread acquires while another releases, as the hub and ZeroMQ's I/O thread do: a
+        //buffer is never handed out while it is still owned
+        const uint32_t BUFFERS = 16;
+        const int ROUNDS = 200000;
+        hub_transport::MessagePool pool(BUFFERS, 64);
+        queues::SpscQueue<char*> sent(32);
+        std::unique_ptr<std::atomic<bool>[]> owned(new std::atomic<bool>[BUFFERS]);
+        for (uint32_t i = 0; i < BUFFERS; i++)
+            owned[i].store(false);
+        char* base = pool.acquire();
+        pool.release(base);
+        std::atomic<bool> done{false};
+
+        std::thread io([&] {
+            char* buffer;
+            while (!done.load() || !sent.empty()) {
+                if (!sent.try_pop(buffer)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                uint32_t index = static_cast<uint32_t>((buffer - base) / 64);
+                uint32_t stamp;
+                std::memcpy(&stamp, buffer, sizeof(stamp));
+                assert(stamp == index);
+                owned[index].store(false);
+                pool.release(buffer);
+            }
+        });
+        int acquired = 0;
+        while (acquired < ROUNDS) {
+            char* buffer = pool.acquire();
+            if (buffer == nullptr) {
+                std::this_thread::yield();
+                continue;
+            }
+            uint32_t index = static_cast<uint32_t>((buffer - base) / 64);
+            assert(index < BUFFERS && !owned[index].exchange(true));
+            std::memcpy(buffer, &index, sizeof(index));
+            while (!sent.try_push(buffer))
+                std::this_thread::yield();
+            acquired++;
+        }
+        done.store(true);
+        io.join();
+
+        std::set<char*> all;  // everything is back in the pool
+        for (uint32_t i = 0; i < BUFFERS; i++)
+            all.insert(pool.acquire());
+        assert(all.size() == BUFFERS && all.count(nullptr) == 0 && pool.acquire() == nullptr);
+        std::cout << "######HUB TRANSPORT TEST CASE 2 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_hub_transport_tests()
+    {
+        test_message_pool_recycles();
+        test_message_pool_concurrent_release();
+    }
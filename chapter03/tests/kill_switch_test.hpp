@@ -0,0 +1,142 @@
+#include <cassert>
+#include <iostream>
+#include <vector>
+#include "../kill_switch.hpp"
+
+    struct CancelSent {
+        int session;
+        throttle::Priority priority;
+        int64_t id;
+        uint64_t time;
+    };
+
+    void test_kill_working_orders()
+    {
+        //Orders stay findable as others leave their venue's array; fills and cancels acknowledged
+        //take them out, a partial fill does not
+        using order_state::OrderEvent;
+        kill::WorkingOrders working(8);
+        for (int64_t id = 1; id <= 6; id++)
+            assert(working.add(static_cast<int>(id % 2), order_state::make_order(id, 10.0, 100, true)));
+        assert(!working.add(0, order_state::make_order(4, 10.0, 100, true)));  // already working
+        assert(working.size() == 6 && working.working(0) == 3 && working.working(1) == 3);
+        assert(working.apply(order_state::ExecutionUpdate{2, 10.0, 40, OrderEvent::FILL}));
+        assert(working.find(2)->leaves_quantity == 60 && working.size() == 6);
+        assert(working.apply(order_state::ExecutionUpdate{2, 10.0, 60, OrderEvent::FILL}));     // first of venue 0
+        assert(!working.find(2) && working.working(0) == 2);
+        assert(working.find(6)->id == 6 && working.find(4)->id == 4);
+        assert(!working.apply(order_state::ExecutionUpdate{3, 0.0, 0, OrderEvent::CANCEL_ACK})); // none requested
+        assert(working.apply(order_state::ExecutionUpdate{3, 0.0, 0, OrderEvent::CANCEL_REQUEST}));
+        assert(working.apply(order_state::ExecutionUpdate{3, 0.0, 0, OrderEvent::CANCEL_ACK}));
+        assert(!working.apply(order_state::ExecutionUpdate{3, 10.0, 10, OrderEvent::FILL}));    // gone
+        assert(working.remove(1) && !working.remove(1) && working.size() == 3);
+        for (int64_t id = 10; id < 15; id++)
+            assert(working.add(1, order_state::make_order(id, 10.0, 100, true)));
+        assert(!working.add(1, order_state::make_order(15, 10.0, 100, true)));                  // full
+        std::vector<int64_t> ids;
+        working.for_each(1, [&](order_state::OrderRecord& order) { ids.push_back(order.id); });
+        assert((ids == std::vector<int64_t>{5, 10, 11, 12, 13, 14}));
+        std::cout << "######KILL SWITCH TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_kill_cancel_all()
+    {
+        //Simulated clock, 1 cycle per ns: one cancel per working order, none for one already being
+        //cancelled, paced by the venue limit even when the session queues are far smaller than
+        //the number of orders
+        const uint64_t MS = 1000000;
+        kill::KillSwitch killSwitch;
+        assert(killSwitch.engage(5) && !killSwitch.engage(6) && killSwitch.engaged_time() == 5);
+        throttle::OrderThrottle limiter(4, 1.0);
+        limiter.add_session(limiter.add_venue(1000, 5, 0), 0, 1, 0);  // 1 per ms, bursts of 5
+        limiter.add_session(limiter.add_venue(0, 1, 0), 0, 1, 0);     // unlimited
+        kill::WorkingOrders working(64);
+        for (int64_t id = 0; id < 30; id++)
+            working.add(id < 20 ? 0 : 1, order_state::make_order(id, 10.0, 100, id & 1));
+        working.apply(order_state::ExecutionUpdate{7, 0.0, 0, order_state::OrderEvent::CANCEL_REQUEST});
+        uint64_t now = 0;
+        std::vector<CancelSent> sent;
+        auto send = [&](int s, throttle::Priority p, const order_state::OrderRecord& order) {
+            sent.push_back(CancelSent{s, p, order.id, now});
+        };
+        size_t cancels = kill::cancel_all(working, limiter, [&] {
+            now += MS / 4;
+            limiter.dispatch(now, send);
+        });
+        assert(cancels == 29);
+        while (!limiter.idle()) {
+            now += MS / 4;
+            limiter.dispatch(now, send);
+        }
+        assert(sent.size() == 29 && working.size() == 30);
+        for (const CancelSent& s : sent)
+            assert(s.priority == throttle::Priority::CANCEL && s.id != 7);
+        working.for_each(0, [](order_state::OrderRecord& order) {
+            assert(order.state == order_state::OrderState::CANCEL_PENDING);
+        });
+        std::vector<uint64_t> limited;
+        for (const CancelSent& s : sent)
+            if (s.session == 0)
+                limited.push_back(s.time);
+        assert(limited.size() == 19);
+        for (size_t i = 0; i < limited.size(); i++)
+            for (size_t j = i; j < limited.size(); j++)
+                assert(j - i + 1 <= 5 + (limited[j] - limited[i]) / MS);
+        assert(kill::cancel_all(working, limiter, [] {}) == 0);  // thrown again: nothing new to cancel
+        std::cout << "######KILL SWITCH TEST CASE 2 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_kill_cancel_sweep_resumes()
+    {
+        //A sweep submits only what the session queues take and returns; fills applied between
+        //two calls remove orders, visited or not, and every order still working gets exactly one
+        //cancel
+        const uint64_t MS = 1000000;
+        throttle::OrderThrottle limiter(4, 1.0);
+        limiter.add_session(limiter.add_venue(1000, 1, 0), 0, 1, 0);  // 1 per ms
+        limiter.add_session(limiter.add_venue(0, 1, 0), 0, 1, 0);     // unlimited
+        kill::WorkingOrders working(64);
+        for (int64_t id = 0; id < 12; id++)
+            working.add(0, order_state::make_order(id, 10.0, 100, true));
+        for (int64_t id = 20; id < 23; id++)
+            working.add(1, order_state::make_order(id, 10.0, 100, false));
+        std::vector<CancelSent> sent;
+        auto send = [&](int s, throttle::Priority p, const order_state::OrderRecord& order) {
+            sent.push_back(CancelSent{s, p, order.id, 0});
+        };
+        kill::CancelSweep sweep;
+        sweep.start(working);
+        assert(!sweep.resume(working, limiter) && sweep.submitted() == 7);  // venue 0's queue holds 4
+        assert(working.find(11)->state == order_state::OrderState::CANCEL_PENDING);
+        assert(working.find(2)->state == order_state::OrderState::NEW);
+        assert(working.apply(order_state::ExecutionUpdate{2, 10.0, 100, order_state::OrderEvent::FILL}));   // not visited
+        assert(working.apply(order_state::ExecutionUpdate{10, 10.0, 100, order_state::OrderEvent::FILL}));  // cancel queued
+        uint64_t now = 0;
+        while (!sweep.resume(working, limiter)) {
+            limiter.dispatch(now, send);
+            now += MS;
+        }
+        while (!limiter.idle()) {
+            limiter.dispatch(now, send);
+            now += MS;
+        }
+        assert(sweep.submitted() == 14 && sent.size() == 14 && working.size() == 13);
+        std::vector<int> cancels(23, 0);
+        for (const CancelSent& s : sent)
+            cancels[s.id]++;
+        for (int64_t id = 0; id < 23; id++)
+            assert(cancels[id] == ((id < 12 && id != 2) || id >= 20 ? 1 : 0));
+        working.for_each(0, [](order_state::OrderRecord& order) {
+            assert(order.state == order_state::OrderState::CANCEL_PENDING);
+        });
+        sweep.start(working);
+        assert(sweep.resume(working, limiter) && sweep.submitted() == 0);  // all being cancelled
+        std::cout << "######KILL SWITCH TEST CASE 3 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_kill_switch_tests()
+    {
+        test_kill_working_orders();
+        test_kill_cancel_all();
+        test_kill_cancel_sweep_resumes();
+    }
@@ -0,0 +1,87 @@
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "../latency_tracer.hpp"
+
+    void test_trace_ring()
+    {
+        //Events come out in the order they went in; once the ring is full new events are dropped
+        //and counted rather than overwriting what the aggregator has not read
+        const uint64_t CAPACITY = 1 << 14;
+        std::unique_ptr<latency::TraceRing> ring(new latency::TraceRing());
+        for (uint64_t i = 0; i < 10; i++)
+            ring->push(latency::Stage::ON_MESSAGE, i, i + 5);
+        std::vector<latency::TraceEvent> events;
+        assert(ring->drain([&](const latency::TraceEvent& e) { events.push_back(e); }) == 10);
+        for (uint64_t i = 0; i < 10; i++)
+            assert(events[i].start == i && events[i].end == i + 5 && events[i].stage == latency::Stage::ON_MESSAGE);
+        assert(ring->drain([](const latency::TraceEvent&) {}) == 0);
+
+        for (uint64_t i = 0; i < CAPACITY + 5; i++)
+            ring->push(latency::Stage::FROM_APP, i, i);
+        assert(ring->dropped_events() == 5);
+        events.clear();
+        assert(ring->drain([&](const latency::TraceEvent& e) { events.push_back(e); }) == CAPACITY);
+        assert(events.front().start == 0 && events.back().start == CAPACITY - 1);
+        std::cout << "######LATENCY TRACER TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_tsc_clock()
+    {
+        //Cycles convert to roughly the nanoseconds steady_clock saw pass
+        const latency::TscClock& tsc = latency::TscClock::instance();
+        assert(tsc.cycles_per_ns() > 0.0);
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t c0 = latency::rdtsc();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        uint64_t c1 = latency::rdtsc();
+        double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+        double measured = static_cast<double>(tsc.to_ns(c1 - c0));
+        assert(measured > elapsed * 0.5 && measured < elapsed * 1.5);
+        std::cout << "######LATENCY TRACER TEST CASE 2 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_trace_aggregator()
+    {
+        //Each thread records into its own ring; the aggregator folds every ring into the stage
+        //histograms, periodically while running and once more on stop
+        const int SCOPES = 1000;
+        latency::TraceAggregator aggregator;
+        aggregator.start(std::chrono::milliseconds(1));
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 2; t++)
+            threads.emplace_back([SCOPES] {
+                for (int i = 0; i < SCOPES; i++) {
+                    latency::ScopedTrace trace(latency::Stage::STRATEGY_CALLBACK);
+                    if (i % 100 == 0)
+                        std::this_thread::yield();
+                }
+            });
+        for (std::thread& thread : threads)
+            thread.join();
+        {
+            TRACE_SCOPE(latency::Stage::BOOK_ADD_ORDER);  // recorded only in a LATENCY_TRACE build
+        }
+        aggregator.stop();
+
+        latency::Histogram strategy = aggregator.snapshot(latency::Stage::STRATEGY_CALLBACK);
+        assert(strategy.count() == 2 * SCOPES);
+        assert(strategy.min() <= strategy.percentile(50) && strategy.percentile(50) <= strategy.max());
+        assert(aggregator.snapshot(latency::Stage::BOOK_ADD_ORDER).count() == (LATENCY_TRACE ? 1u : 0u));
+        assert(aggregator.snapshot(latency::Stage::FROM_APP).count() == 0);
+        std::ostringstream report;
+        aggregator.print(report);
+        assert(report.str().find(latency::stage_name(latency::Stage::STRATEGY_CALLBACK)) != std::string::npos);
+        std::cout << "######LATENCY TRACER TEST CASE 3 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_latency_tracer_tests()
+    {
+        test_trace_ring();
+        test_tsc_clock();
+        test_trace_aggregator();
+    }
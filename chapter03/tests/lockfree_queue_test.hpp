@@ -0,0 +1,142 @@
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "../lockfree_queue.hpp"
+
+    struct QueueTestItem {
+        uint32_t producer;
+        uint32_t sequence;
+    };
+
+    const uint32_t QUEUE_TEST_ITEMS = 20000; // per producer
+
+    template <typename Queue>
+    void push_sequence(Queue& queue, uint32_t producer)
+    {
+        for (uint32_t i = 0; i < QUEUE_TEST_ITEMS; i++)
+            while (!queue.try_push(QueueTestItem{producer, i}))
+                std::this_thread::yield();
+    }
+
+    // Every item of every producer exactly once, each producer's in the order it pushed them
+    void check_per_producer(const std::vector<std::vector<QueueTestItem>>& received, uint32_t producers)
+    {
+        std::vector<uint32_t> count(producers, 0);
+        std::vector<std::vector<bool>> seen(producers, std::vector<bool>(QUEUE_TEST_ITEMS, false));
+        for (const std::vector<QueueTestItem>& items : received) {
+            std::vector<int64_t> last(producers, -1);
+            for (const QueueTestItem& item : items) {
+                assert(item.producer < producers && item.sequence < QUEUE_TEST_ITEMS);
+                assert(static_cast<int64_t>(item.sequence) > last[item.producer]);
+                assert(!seen[item.producer][item.sequence]);
+                last[item.producer] = item.sequence;
+                seen[item.producer][item.sequence] = true;
+                count[item.producer]++;
+            }
+        }
+        for (uint32_t p = 0; p < producers; p++)
+            assert(count[p] == QUEUE_TEST_ITEMS);
+    }
+
+    void test_spsc_queue()
+    {
+        //Full and empty are reported, not waited on; a consumer on another thread gets every
+        //item in order, through try_pop and drain alike
+        bool refused = false;
+        try {
+            queues::SpscQueue<QueueTestItem> odd(6);
+        } catch (const std::invalid_argument&) {
+            refused = true;
+        }
+        assert(refused);
+
+        queues::SpscQueue<QueueTestItem> queue(4);
+        QueueTestItem item;
+        assert(!queue.try_pop(item) && queue.empty());
+        for (uint32_t i = 0; i < 4; i++)
+            assert(queue.try_push(QueueTestItem{0, i}));
+        assert(!queue.try_push(QueueTestItem{0, 4}) && queue.size() == 4);
+        assert(queue.try_pop(item) && item.sequence == 0);
+        assert(queue.drain([](const QueueTestItem&) {}, 2) == 2 && queue.size() == 1);
+        assert(queue.try_pop(item) && item.sequence == 3 && queue.empty());
+
+        queues::SpscQueue<QueueTestItem> shared(64);
+        std::thread producer([&] { push_sequence(shared, 0); });
+        std::vector<std::vector<QueueTestItem>> received(1);
+        bool pop = true;
+        while (received[0].size() < QUEUE_TEST_ITEMS) {
+            if (pop && shared.try_pop(item))
+                received[0].push_back(item);
+            else if (!pop)
+                shared.drain([&](const QueueTestItem& next) { received[0].push_back(next); });
+            pop = !pop;
+            std::this_thread::yield();
+        }
+        producer.join();
+        check_per_producer(received, 1);
+        assert(shared.empty());
+        std::cout << "######LOCKFREE QUEUE TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_mpsc_queue()
+    {
+        //Several producers, one consumer: nothing lost or duplicated, each producer's items in order
+        const uint32_t PRODUCERS = 4;
+        queues::MpscQueue<QueueTestItem> queue(64);
+        std::vector<std::thread> producers;
+        for (uint32_t p = 0; p < PRODUCERS; p++)
+            producers.emplace_back([&queue, p] { push_sequence(queue, p); });
+        std::vector<std::vector<QueueTestItem>> received(1);
+        while (received[0].size() < PRODUCERS * QUEUE_TEST_ITEMS) {
+            if (queue.drain([&](QueueTestItem& item) { received[0].push_back(item); }, 16) == 0)
+                std::this_thread::yield();
+        }
+        for (std::thread& producer : producers)
+            producer.join();
+        QueueTestItem item;
+        assert(!queue.try_pop(item) && queue.empty());
+        check_per_producer(received, PRODUCERS);
+        std::cout << "######LOCKFREE QUEUE TEST CASE 2 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_mpmc_queue()
+    {
+        //Several producers and consumers: every item reaches exactly one consumer, and each
+        //consumer sees a producer's items in the order they were pushed
+        const uint32_t PRODUCERS = 3;
+        const uint32_t CONSUMERS = 3;
+        queues::MpmcQueue<QueueTestItem> queue(64);
+        std::atomic<uint32_t> remaining{PRODUCERS * QUEUE_TEST_ITEMS};
+        std::vector<std::vector<QueueTestItem>> received(CONSUMERS);
+        std::vector<std::thread> threads;
+        for (uint32_t c = 0; c < CONSUMERS; c++)
+            threads.emplace_back([&, c] {
+                QueueTestItem item;
+                while (remaining.load(std::memory_order_relaxed) > 0) {
+                    if (queue.try_pop(item)) {
+                        received[c].push_back(item);
+                        remaining.fetch_sub(1, std::memory_order_relaxed);
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        for (uint32_t p = 0; p < PRODUCERS; p++)
+            threads.emplace_back([&queue, p] { push_sequence(queue, p); });
+        for (std::thread& thread : threads)
+            thread.join();
+        assert(queue.empty());
+        check_per_producer(received, PRODUCERS);
+        std::cout << "######LOCKFREE QUEUE TEST CASE 3 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_lockfree_queue_tests()
+    {
+        test_spsc_queue();
+        test_mpsc_queue();
+        test_mpmc_queue();
+    }
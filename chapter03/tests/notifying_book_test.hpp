@@ -0,0 +1,99 @@
+#include <cassert>
+#include <iostream>
+#include <vector>
+#include "../messaging_hub.hpp"
+
+    // Message types in the order a shared-memory subscriber received them
+    std::vector<wire::MessageType> received_types(shm::ShmSubscriber& subscriber, std::vector<wire::BboUpdate>& bbos)
+    {
+        std::vector<wire::MessageType> types;
+        subscriber.poll([&](const char* data, uint32_t length) {
+            wire::MessageHeader headerCopy;
+            const wire::MessageHeader* header = wire::peek_header(data, length, headerCopy);
+            assert(header != nullptr);
+            types.push_back(header->type);
+            wire::BboUpdate bboCopy;
+            if (const wire::BboUpdate* bbo = wire::message_cast<wire::BboUpdate>(data, length, bboCopy))
+                if (header->type == wire::MessageType::BBO)
+                    bbos.push_back(*bbo);
+        });
+        return types;
+    }
+
+    void test_notifying_book_changes()
+    {
+        //Every add, update and delete the book applies reaches the change queue with its side and
+        //action and bumps the signal; a discarded price does neither. A full queue counts the
+        //change instead of blocking the writer, and the snapshot still shows its result
+        notifying::NotifyingLimitOrderBook book(2, 100, 2);
+        conflation::MarketSnapshot snapshot;
+        assert(book.read_snapshot(snapshot) == 0);
+        uint32_t seen = book.change_signal().current();
+        assert(book.add_order(circular_array::Order(1, 10.01, 100), true));
+        assert(!book.add_order(circular_array::Order(9, 5.00, 100), true));   // outside the window
+        assert(book.change_signal().current() == seen + 1);
+        assert(book.update_order(circular_array::Order(1, 10.01, 150), true));
+        assert(book.add_order(circular_array::Order(2, 10.02, 100), false));
+        assert(book.change_signal().current() == seen + 3);
+        assert(book.overflowed_changes() == 1);
+        assert(book.read_snapshot(snapshot) == 3);
+        assert(snapshot.bid_levels == 1 && snapshot.best_bid().price == 10.01 && snapshot.best_bid().quantity == 150);
+        assert(snapshot.offer_levels == 1 && snapshot.best_offer().quantity == 100);
+
+        std::vector<notifying::BookChange> changes;
+        assert(book.change_queue().drain([&](const notifying::BookChange& change) { changes.push_back(change); }) == 2);
+        assert(changes[0].is_bid && changes[0].price == 10.01 && changes[0].quantity == 100);
+        assert(changes[0].action == wire::DepthAction::NEW);
+        assert(changes[1].quantity == 150 && changes[1].action == wire::DepthAction::CHANGE);
+        assert(book.delete_order(circular_array::Order(1, 10.01, 150), true));
+        notifying::BookChange change;
+        assert(book.change_queue().try_pop(change) && change.action == wire::DepthAction::DELETE && change.is_bid);
+        assert(book.read_snapshot(snapshot) == 4 && snapshot.bid_levels == 0 && snapshot.best_bid().quantity == 0);
+        std::cout << "######NOTIFYING BOOK TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_notifying_book_hub_cycles()
+    {
+        //On a notifying book a cycle publishes a delta per change then one top of book, taken
+        //from the book's snapshot, and the same snapshot to the conflation buffer; nothing when
+        //the queue is empty. On a plain book it publishes when the top moved
+        typedef messaging_hub<hub_transport::ShmTransport> ShmHub;
+        notifying::NotifyingLimitOrderBook book(2, 100);
+        conflation::ConflationBuffer buffer(16, 1);
+        int consumer = buffer.register_consumer();
+        ShmHub hub(book, &buffer, 7, "/lob_notifying_test");
+        shm::ShmSubscriber subscriber("/lob_notifying_test");
+        std::vector<wire::BboUpdate> bbos;
+        assert(hub.publish_cycle() == 0);
+        book.add_order(circular_array::Order(1, 10.01, 100), true);
+        book.add_order(circular_array::Order(2, 10.02, 200), false);
+        assert(hub.publish_cycle() == 2);
+        std::vector<wire::MessageType> types = received_types(subscriber, bbos);
+        assert(types.size() == 3 && types[0] == wire::MessageType::DEPTH_DELTA &&
+               types[1] == wire::MessageType::DEPTH_DELTA && types[2] == wire::MessageType::BBO);
+        assert(bbos.size() == 1 && bbos[0].bid_quantity == 100 && bbos[0].offer_quantity == 200);
+        assert(bbos[0].header.symbol_id == 7 && bbos[0].header.sequence == 3);
+        conflation::MarketSnapshot latest{};
+        assert(buffer.drain(consumer, [&](const conflation::MarketSnapshot& next) { latest = next; }) == 1);
+        assert(latest.symbol_id == 7 && latest.best_bid().price == 10.01 && latest.best_offer().quantity == 200);
+        assert(hub.publish_cycle() == 0 && received_types(subscriber, bbos).empty());
+
+        circular_array::LimitOrderBook plain(2, 100);
+        ShmHub polling(plain, nullptr, 8, "/lob_notifying_test_plain");
+        shm::ShmSubscriber plainSubscriber("/lob_notifying_test_plain");
+        bbos.clear();
+        plain.add_order(circular_array::Order(1, 10.01, 100), true);
+        assert(polling.publish_cycle() == 1);
+        assert(polling.publish_cycle() == 0);      // same top: nothing to send
+        plain.update_order(circular_array::Order(1, 10.01, 300), true);
+        assert(polling.publish_cycle() == 1);
+        types = received_types(plainSubscriber, bbos);
+        assert(types.size() == 2 && bbos.size() == 2 && bbos[1].bid_quantity == 300);
+        std::cout << "######NOTIFYING BOOK TEST CASE 2 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_notifying_book_tests()
+    {
+        test_notifying_book_changes();
+        test_notifying_book_hub_cycles();
+    }
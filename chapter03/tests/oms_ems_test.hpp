@@ -0,0 +1,210 @@
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include "../oms_ems.hpp"
+
+    const char* OMS_JOURNAL_TEST_DIR = "/tmp/lob_oms_journal_test";
+
+    wire::BboUpdate oms_bbo(uint32_t symbol_id, double bid, double offer)
+    {
+        wire::BboUpdate bbo;
+        wire::init_header(bbo, symbol_id, 1, 0);
+        bbo.bid_price = wire::to_wire_price(bid);
+        bbo.offer_price = wire::to_wire_price(offer);
+        bbo.bid_quantity = bbo.offer_quantity = 1000;
+        return bbo;
+    }
+
+    void test_oms_ems_order_flow()
+    {
+        //An order the OMS accepts is routed by the EMS to the cheaper venue and works there; a kill
+        //cancels it, and the OMS refuses orders until trading resumes
+        conflation::ConflationBuffer buffer(16, 1);
+        EMS ems;
+        int cheap = ems.AddVenue("A", "LOB", 0.0);
+        int dear = ems.AddVenue("B", "LOB", 0.0);
+        ems.Router().update_quote(cheap, 9.99, 1000, 10.00, 1000);
+        ems.Router().update_quote(dear, 9.99, 1000, 10.05, 1000);
+        OMS oms(buffer, 1024);
+        oms.AttachEms(ems);
+        oms.AttachKillSwitch(ems.Switch());
+        pretrade::Limits limits;
+        limits.max_order_quantity = 1000;
+        limits.max_open_orders = 10;
+        limits.max_notional = 1e6;
+        limits.collar = 0.5;
+        limits.max_position = 5000;
+        oms.SetRiskLimits(limits);
+        wire::BboUpdate bbo = oms_bbo(0, 9.99, 10.00);
+        oms.OnHubMessage(&bbo, sizeof(bbo));
+
+        //The test thread is the OMS thread: orders are checked and sent when it processes them
+        assert(oms.SendOrder(order_state::make_order(1, 10.00, 100, true)));
+        assert(oms.SendOrder(order_state::make_order(2, 10.00, 2000, true)));  // above the order size
+        oms.ProcessOrderUpdates();
+        assert(oms.LastRejection() == pretrade::ORDER_SIZE && oms.RejectedOrders() == 1);
+        ems.ProcessOrderQueue();
+        assert(ems.WorkingOrderCount() == 1);
+
+        assert(ems.Kill());
+        assert(!oms.SendOrder(order_state::make_order(3, 10.00, 100, true)));
+        ems.ProcessOrderQueue();
+        ems.ExecutionReport(order_state::ExecutionUpdate{routing::child_order_id(1, cheap), 0.0, 0,
+                                                         order_state::OrderEvent::CANCEL_ACK});
+        ems.ProcessOrderQueue();
+        assert(ems.WorkingOrderCount() == 0);
+        ems.Resume();
+        assert(oms.SendOrder(order_state::make_order(4, 10.00, 200, true)));
+        oms.ProcessOrderUpdates();
+        ems.ProcessOrderQueue();
+        assert(ems.WorkingOrderCount() == 1 && oms.RejectedOrders() == 1);
+        std::cout << "######OMS EMS TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_oms_ems_unrouted_order()
+    {
+        //Hub BBOs reach the router through the EMS thread; a parent order no venue has liquidity
+        //for comes back to the OMS as a reject and frees its exposure
+        conflation::ConflationBuffer buffer(16, 1);
+        EMS ems;
+        int venue = ems.AddVenue("A", "LOB", 0.0);
+        OMS oms(buffer, 1024);
+        oms.AttachEms(ems);
+        oms.FeedVenueQuotes(venue, 0);
+        pretrade::Limits limits;
+        limits.max_order_quantity = 1000;
+        limits.max_open_orders = 2;
+        limits.max_notional = 1e6;
+        limits.collar = 0.5;
+        limits.max_position = 5000;
+        oms.SetRiskLimits(limits);
+        wire::BboUpdate bbo = oms_bbo(0, 9.99, 10.00);
+        oms.OnHubMessage(&bbo, sizeof(bbo));
+
+        assert(oms.SendOrder(order_state::make_order(1, 10.00, 100, true)));
+        oms.ProcessOrderUpdates();
+        ems.ProcessOrderQueue();
+        assert(ems.WorkingOrderCount() == 1 && ems.UnroutedOrders() == 0);
+
+        ems.UpdateQuote(venue, 9.99, 1000, 10.00, 0);  // the offers are gone
+        assert(oms.SendOrder(order_state::make_order(2, 10.00, 200, true)));
+        oms.ProcessOrderUpdates();
+        assert(oms.LiveOrderCount() == 2);
+        ems.ProcessOrderQueue();
+        assert(ems.WorkingOrderCount() == 1 && ems.UnroutedOrders() == 1);
+        oms.ProcessOrderUpdates();
+        assert(oms.LiveOrderCount() == 1 && oms.InvalidTransitions() == 0);
+        assert(oms.SendOrder(order_state::make_order(3, 10.00, 300, true)));  // room for it again
+        oms.ProcessOrderUpdates();
+        assert(oms.RejectedOrders() == 0 && oms.LiveOrderCount() == 2);
+        std::cout << "######OMS EMS TEST CASE 2 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_oms_journal_single_writer()
+    {
+        //Orders and execution reports sent from several threads reach the journal through the OMS
+        //thread alone: every one of them is recovered, in one unbroken sequence
+        const int64_t ORDERS_PER_THREAD = 200;
+        journal::remove_journal(OMS_JOURNAL_TEST_DIR);
+        conflation::ConflationBuffer buffer(16, 1);
+        EMS ems;
+        ems.AddVenue("A", "LOB", 0.0);
+        {
+            OMS oms(buffer, 1024);
+            oms.OpenJournal(OMS_JOURNAL_TEST_DIR);
+            oms.AttachEms(ems);
+            pretrade::Limits limits;
+            limits.max_order_quantity = 1000;
+            limits.max_open_orders = 1000;
+            limits.max_notional = 1e9;
+            limits.collar = 0.5;
+            limits.max_position = 1000000;
+            oms.SetRiskLimits(limits);
+            wire::BboUpdate bbo = oms_bbo(0, 9.99, 10.00);
+            oms.OnHubMessage(&bbo, sizeof(bbo));
+            std::thread omsThread(&OMS::run, &oms);
+            std::vector<std::thread> senders;
+            for (int64_t t = 0; t < 2; t++)
+                senders.emplace_back([&oms, t, ORDERS_PER_THREAD] {
+                    for (int64_t i = 0; i < ORDERS_PER_THREAD; i++) {
+                        int64_t id = t * ORDERS_PER_THREAD + i + 1;
+                        assert(oms.SendOrder(order_state::make_order(id, 10.00, static_cast<int32_t>(i + 1), t == 0)));
+                        oms.ExecutionReport(order_state::ExecutionUpdate{id, 0.0, 0, order_state::OrderEvent::ACK});
+                    }
+                });
+            for (std::thread& sender : senders)
+                sender.join();
+            oms.Stop();
+            omsThread.join();
+            oms.ProcessOrderUpdates(); // whatever run() left after the stop
+            assert(oms.RejectedOrders() == 0);
+        }
+        order_store::OrderStore recovered(1024);
+        journal::RecoveryResult result = journal::recover(OMS_JOURNAL_TEST_DIR, recovered);
+        assert(!result.torn && result.rejected == 0);
+        assert(result.records == 4 * ORDERS_PER_THREAD && result.last_sequence == result.records);
+        for (int64_t id = 1; id <= 2 * ORDERS_PER_THREAD; id++)
+            assert(recovered.find(id) && recovered.find(id)->state == order_state::OrderState::ACKNOWLEDGED);
+        journal::remove_journal(OMS_JOURNAL_TEST_DIR);
+        std::cout << "######OMS EMS TEST CASE 3 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_oms_conflated_collar()
+    {
+        //With no hub BBO the collar refuses every order; a conflated snapshot gives it a reference
+        conflation::ConflationBuffer buffer(16, 1);
+        EMS ems;
+        ems.AddVenue("A", "LOB", 0.0);
+        OMS oms(buffer, 1024);
+        oms.AttachEms(ems);
+        pretrade::Limits limits;
+        limits.max_order_quantity = 1000;
+        limits.max_open_orders = 10;
+        limits.max_notional = 1e6;
+        limits.collar = 0.5;
+        limits.max_position = 5000;
+        oms.SetRiskLimits(limits);
+        assert(oms.SendOrder(order_state::make_order(1, 10.00, 100, true)));
+        oms.ProcessOrderUpdates();
+        assert(oms.LastRejection() == pretrade::PRICE_COLLAR);
+
+        conflation::MarketSnapshot quote{};
+        quote.symbol_id = 0;
+        quote.bid_levels = quote.offer_levels = 1;
+        quote.bids[0] = {9.99, 100};
+        quote.offers[0] = {10.00, 100};
+        oms.Start();
+        bool refused = false;
+        try {
+            oms.SetWaitStrategy(wait::WaitStrategy(wait::Mode::SPIN_PARK, 10, 1000000L));
+        } catch (const std::logic_error&) {
+            refused = true;   // the market data thread already waits with it
+        }
+        assert(refused);
+        refused = false;
+        try {
+            oms.Subscribe(wire::make_topic(1));
+        } catch (const std::logic_error&) {
+            refused = true;   // the socket belongs to the market data thread now
+        }
+        assert(refused);
+        buffer.publish(quote);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (oms.ConflationMetrics().delivered == 0 && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::yield();   // the market data thread has applied the snapshot once counted
+        assert(oms.ConflationMetrics().delivered == 1);
+        assert(oms.SendOrder(order_state::make_order(2, 10.00, 100, true)));
+        oms.ProcessOrderUpdates();
+        assert(oms.LiveOrderCount() == 1);
+        std::cout << "######OMS EMS TEST CASE 4 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_oms_ems_tests()
+    {
+        test_oms_ems_order_flow();
+        test_oms_ems_unrouted_order();
+        test_oms_journal_single_writer();
+        test_oms_conflated_collar();
+    }
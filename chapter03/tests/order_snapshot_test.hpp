@@ -0,0 +1,108 @@
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../order_snapshot.hpp"
+
+    const char* SNAPSHOT_TEST_DIR = "/tmp/lob_snapshot_test";
+
+    void snapshot_test_events(journal::OrderJournal& log, order_store::OrderStore& live, int64_t first, int64_t last)
+    {
+        using namespace order_state;
+        for (int64_t id = first; id < last; id++) {
+            OrderRecord order = make_order(id, 10.01, 100, true);
+            live.insert(order);
+            log.append_order(order);
+            ExecutionUpdate updates[] = {{id, 10.01, 0, OrderEvent::ACK},
+                                         {id, 10.01, id % 4 == 0 ? 100 : 30, OrderEvent::FILL}};
+            for (const ExecutionUpdate& update : updates) {
+                log.append_update(update);
+                order_store::apply_update(live, update);
+            }
+        }
+    }
+
+    void test_snapshot_restart()
+    {
+        //Snapshot halfway, keep trading, restart: snapshot + journal tail rebuild the live orders
+        //and the segments before the snapshot are gone
+        journal::remove_journal(SNAPSHOT_TEST_DIR);
+        order_store::OrderStore live(1000);
+        size_t live_at_snapshot = 0;
+        {
+            journal::OrderJournal log(SNAPSHOT_TEST_DIR, 1, 32, 100);
+            snapshot_test_events(log, live, 0, 100);
+            snapshot::checkpoint(SNAPSHOT_TEST_DIR, live, log.last_sequence());
+            live_at_snapshot = live.size();
+            snapshot_test_events(log, live, 100, 150);
+        }
+        assert(journal::list_segments(SNAPSHOT_TEST_DIR).size() < 450 / 32 + 1);
+
+        order_store::OrderStore restarted(1000);
+        snapshot::RestartResult result = snapshot::restart(SNAPSHOT_TEST_DIR, restarted);
+        assert(result.snapshot.orders == live_at_snapshot && result.snapshot.journal_sequence == 300);
+        assert(result.journal.records == 150 && result.journal.last_sequence == 450 && !result.journal.torn);
+        assert(restarted.size() == live.size());
+        live.for_each_live([&](const order_state::OrderRecord& order) {
+            const order_state::OrderRecord* copy = restarted.find(order.id);
+            assert(copy && copy->state == order.state && copy->leaves_quantity == order.leaves_quantity);
+        });
+        std::cout << "######ORDER SNAPSHOT TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_snapshot_corrupted()
+    {
+        //A snapshot that fails its checksum is refused before any of it reaches the store
+        std::string path = snapshot::snapshot_path(SNAPSHOT_TEST_DIR);
+        int fd = open(path.c_str(), O_WRONLY);
+        uint64_t garbage = 0xdeadbeefdeadbeefULL;
+        pwrite(fd, &garbage, sizeof(garbage), snapshot::SNAPSHOT_DATA_OFFSET + 8);
+        close(fd);
+        order_store::OrderStore store(1000);
+        bool refused = false;
+        try {
+            snapshot::load_snapshot(SNAPSHOT_TEST_DIR, store);
+        } catch (const std::runtime_error&) {
+            refused = true;
+        }
+        assert(refused && store.size() == 0);
+        unlink(path.c_str());
+        journal::remove_journal(SNAPSHOT_TEST_DIR);
+        std::cout << "######ORDER SNAPSHOT TEST CASE 2 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_snapshot_background()
+    {
+        //The owning thread only copies the live orders; the snapshot written by the background
+        //thread restarts to the same orders as a synchronous checkpoint
+        journal::remove_journal(SNAPSHOT_TEST_DIR);
+        order_store::OrderStore live(1000);
+        size_t live_at_snapshot = 0;
+        {
+            journal::OrderJournal log(SNAPSHOT_TEST_DIR, 1, 32, 100);
+            snapshot::BackgroundCheckpoint checkpoints(SNAPSHOT_TEST_DIR);
+            snapshot_test_events(log, live, 0, 100);
+            assert(checkpoints.capture(live, log.last_sequence()));
+            live_at_snapshot = live.size();
+            snapshot_test_events(log, live, 100, 150);  // trading goes on while it is written
+            while (checkpoints.busy())
+                std::this_thread::yield();
+            assert(checkpoints.written_sequence() == 300 && checkpoints.failed_checkpoints() == 0);
+        }
+        order_store::OrderStore restarted(1000);
+        snapshot::RestartResult result = snapshot::restart(SNAPSHOT_TEST_DIR, restarted);
+        assert(result.snapshot.orders == live_at_snapshot && result.snapshot.journal_sequence == 300);
+        assert(result.journal.last_sequence == 450 && restarted.size() == live.size());
+        unlink(snapshot::snapshot_path(SNAPSHOT_TEST_DIR).c_str());
+        journal::remove_journal(SNAPSHOT_TEST_DIR);
+        std::cout << "######ORDER SNAPSHOT TEST CASE 3 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_order_snapshot_tests()
+    {
+        test_snapshot_restart();
+        test_snapshot_corrupted();
+        test_snapshot_background();
+    }
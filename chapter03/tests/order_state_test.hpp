@@ -0,0 +1,56 @@
+#include <cassert>
+#include <iostream>
+#include "../order_state.hpp"
+
+    order_state::ExecutionUpdate make_update(order_state::OrderEvent event, int32_t quantity = 0)
+    {
+        return order_state::ExecutionUpdate{1, 10.01, quantity, event};
+    }
+
+    void test_order_state_fills()
+    {
+        //Partial fills track cum/leaves; the fill that empties leaves moves the order to FILLED
+        using namespace order_state;
+        OrderRecord order = make_order(1, 10.01, 300, true);
+        assert(apply(order, make_update(OrderEvent::ACK)));
+        assert(order.state == OrderState::ACKNOWLEDGED);
+        assert(apply(order, make_update(OrderEvent::FILL, 100)));
+        assert(order.state == OrderState::PARTIALLY_FILLED);
+        assert(order.cum_quantity == 100 && order.leaves_quantity == 200);
+        assert(!apply(order, make_update(OrderEvent::FILL, 250))); // overfill
+        assert(order.leaves_quantity == 200);
+        assert(apply(order, make_update(OrderEvent::FILL, 200)));
+        assert(order.state == OrderState::FILLED && is_terminal(order.state));
+        assert(!apply(order, make_update(OrderEvent::CANCEL_REQUEST)));
+        std::cout << "######ORDER STATE TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_order_state_cancel()
+    {
+        //Cancel reject returns to the previous state, or to PARTIALLY_FILLED after a fill while pending
+        using namespace order_state;
+        OrderRecord order = make_order(2, 10.01, 300, false);
+        assert(apply(order, make_update(OrderEvent::ACK)));
+        assert(apply(order, make_update(OrderEvent::CANCEL_REQUEST)));
+        assert(order.state == OrderState::CANCEL_PENDING);
+        assert(apply(order, make_update(OrderEvent::CANCEL_REJECT)));
+        assert(order.state == OrderState::ACKNOWLEDGED);
+
+        assert(apply(order, make_update(OrderEvent::CANCEL_REQUEST)));
+        assert(apply(order, make_update(OrderEvent::FILL, 50)));
+        assert(order.state == OrderState::CANCEL_PENDING);
+        assert(apply(order, make_update(OrderEvent::CANCEL_REJECT)));
+        assert(order.state == OrderState::PARTIALLY_FILLED);
+
+        assert(apply(order, make_update(OrderEvent::CANCEL_REQUEST)));
+        assert(apply(order, make_update(OrderEvent::CANCEL_ACK)));
+        assert(order.state == OrderState::CANCELLED && order.leaves_quantity == 0 && order.cum_quantity == 50);
+        assert(!apply(order, make_update(OrderEvent::ACK)));
+        std::cout << "######ORDER STATE TEST CASE 2 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_order_state_tests()
+    {
+        test_order_state_fills();
+        test_order_state_cancel();
+    }
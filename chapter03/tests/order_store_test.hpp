@@ -0,0 +1,73 @@
+#include <cassert>
+#include <iostream>
+#include <unordered_map>
+#include "../order_store.hpp"
+
+    void test_order_store_basic()
+    {
+        //Insert/find/erase/archive, duplicate ids and a full store are refused
+        using namespace order_state;
+        order_store::OrderStore store(4, 2);
+        assert(store.insert(make_order(10, 10.01, 100, true)));
+        assert(store.insert(make_order(11, 10.02, 200, false)));
+        assert(!store.insert(make_order(10, 10.03, 300, true)));
+        assert(store.find(11)->quantity == 200);
+        assert(store.find(12) == nullptr);
+
+        store.find(10)->state = OrderState::FILLED;
+        assert(store.archive(10));
+        assert(!store.archive(10));
+        assert(store.find(10) == nullptr);
+        assert(store.archived_count() == 1 && store.archived_at(0).id == 10);
+        assert(store.archived_at(0).state == OrderState::FILLED);
+        assert(store.erase(11) && !store.erase(11));
+        assert(store.size() == 0);
+
+        for (int64_t id = 0; id < 4; id++)
+            assert(store.insert(make_order(id, 10.01, 100, true)));
+        assert(!store.insert(make_order(4, 10.01, 100, true)));
+        for (int64_t id = 0; id < 4; id++)
+            assert(store.archive(id));
+        assert(store.archived_count() == 5 && store.archived_at(4).id == 3); // spans three segments
+        std::cout << "######ORDER STORE TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_order_store_churn()
+    {
+        //Random churn against std::unordered_map: backward-shift deletes must keep every live id reachable
+        using namespace order_state;
+        const size_t CAPACITY = 1000;
+        order_store::OrderStore store(CAPACITY);
+        std::unordered_map<int64_t, int32_t> expected;
+        uint64_t seed = 42;
+        for (int step = 0; step < 200000; step++) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            int64_t id = static_cast<int64_t>((seed >> 33) % 3000);
+            bool live = expected.count(id) != 0;
+            if (live && (seed & 1)) {
+                assert(store.erase(id));
+                expected.erase(id);
+            } else if (!live) {
+                bool inserted = store.insert(make_order(id, 10.01, step, true)) != nullptr;
+                assert(inserted == (expected.size() < CAPACITY));
+                if (inserted)
+                    expected[id] = step;
+            } else {
+                assert(store.find(id)->quantity == expected[id]);
+            }
+        }
+        assert(store.size() == expected.size());
+        size_t visited = 0;
+        store.for_each_live([&](const OrderRecord& order) {
+            assert(expected.at(order.id) == order.quantity);
+            visited++;
+        });
+        assert(visited == expected.size());
+        std::cout << "######ORDER STORE TEST CASE 2 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_order_store_tests()
+    {
+        test_order_store_basic();
+        test_order_store_churn();
+    }
@@ -0,0 +1,65 @@
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include "../position_book.hpp"
+
+    bool pnl_close(double a, double b)
+    {
+        return std::fabs(a - b) < 1e-9;
+    }
+
+    void test_position_book_fills()
+    {
+        //Average cost moves when adding, PnL is realized when reducing, a fill through flat
+        //opens the rest at the fill price
+        positions::PositionBook book(4);
+        book.on_fill(2, true, 100, 10.00);
+        book.on_fill(2, true, 300, 10.40);
+        assert(book.position(2).quantity == 400 && pnl_close(book.position(2).average_cost, 10.30));
+        book.on_fill(2, false, 100, 10.50);
+        assert(book.position(2).quantity == 300 && pnl_close(book.position(2).realized_pnl, 20.0));
+        assert(pnl_close(book.position(2).average_cost, 10.30));
+        book.on_fill(2, false, 500, 10.00);                         // long 300 -> short 200
+        assert(book.position(2).quantity == -200 && pnl_close(book.position(2).average_cost, 10.00));
+        assert(pnl_close(book.position(2).realized_pnl, 20.0 - 90.0));
+        book.on_fill(2, true, 200, 9.50);                           // short covered lower
+        assert(book.position(2).quantity == 0 && book.position(2).average_cost == 0.0);
+        assert(pnl_close(book.totals().realized_pnl, 20.0 - 90.0 + 100.0));
+        assert(book.position(2).mark == 0.0 && book.totals().unrealized_pnl == 0.0); // never quoted
+        std::cout << "######POSITION BOOK TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_position_book_marks()
+    {
+        //Quotes update unrealized PnL and exposures incrementally; a full remark agrees with
+        //them and with new marks gives what the quotes would have
+        positions::PositionBook book(7);
+        book.load(0, 100, 10.0);
+        book.load(3, -50, 20.0);
+        book.on_fill(6, true, 10, 5.0);
+        book.on_quote(0, 10.9, 11.1);   // mid 11
+        book.on_quote(3, 21.9, 22.1);   // mid 22
+        book.on_quote(5, 1.0, 1.2);     // flat
+        book.on_quote(6, 4.0, 0.0);     // one-sided: no mark
+        book.on_quote(9, 1.0, 2.0);     // not in the table
+        positions::Totals incremental = book.totals();
+        assert(pnl_close(incremental.unrealized_pnl, 100 - 100) && pnl_close(book.position(3).unrealized_pnl, -100));
+        assert(pnl_close(incremental.net_exposure, 1100 - 1100) && pnl_close(incremental.gross_exposure, 2200));
+
+        positions::Totals full = book.remark();
+        assert(pnl_close(full.unrealized_pnl, incremental.unrealized_pnl) &&
+               pnl_close(full.gross_exposure, incremental.gross_exposure));
+        double marks[7] = {12.0, 0.0, 0.0, 19.0, 1.1, 1.1, 6.0};
+        full = book.remark(marks);
+        assert(pnl_close(full.unrealized_pnl, 200 + 50 + 10) && pnl_close(full.net_exposure, 1200 - 950 + 60));
+        assert(pnl_close(full.gross_exposure, 1200 + 950 + 60) && book.position(6).mark == 6.0);
+        book.on_fill(0, false, 100, 12.0);
+        assert(pnl_close(book.totals().unrealized_pnl, 50 + 10) && pnl_close(book.totals().realized_pnl, 200));
+        std::cout << "######POSITION BOOK TEST CASE 2 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_position_book_tests()
+    {
+        test_position_book_fills();
+        test_position_book_marks();
+    }
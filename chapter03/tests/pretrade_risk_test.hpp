@@ -0,0 +1,89 @@
+#include <cassert>
+#include <iostream>
+#include "../pretrade_risk.hpp"
+
+    pretrade::Limits pretrade_test_limits()
+    {
+        pretrade::Limits limits;
+        limits.max_order_quantity = 1000;
+        limits.max_open_orders = 3;
+        limits.max_notional = 5000.0;
+        limits.collar = 0.50;
+        limits.max_position = 1500;
+        return limits;
+    }
+
+    void test_pretrade_limits()
+    {
+        //Each limit on its own, against a 10.00 / 10.10 market; a failing order books nothing
+        using pretrade::PreTradeChecker;
+        using order_state::make_order;
+        const uint64_t MS = 2000000; // TSC cycles at 2 GHz
+        PreTradeChecker checker(2, 2, 4, 1000.0, 2.0);
+        checker.set_limits(0, pretrade_test_limits());
+        uint64_t now = 1ULL << 40;
+        assert(checker.check(0, make_order(1, 10.05, 100, true), now) == pretrade::PRICE_COLLAR); // no BBO yet
+        checker.update_reference(0, wire::to_wire_price(10.00), wire::to_wire_price(10.10));
+
+        assert(checker.check(1, make_order(1, 10.05, 100, true), now) != 0);  // no limits set
+        assert(checker.check(7, make_order(1, 10.05, 100, true), now) == pretrade::UNKNOWN_ACCOUNT);
+        assert(checker.check(0, make_order(1, 10.05, 1001, true), now) == (pretrade::ORDER_SIZE | pretrade::NOTIONAL));
+        assert(checker.check(0, make_order(1, 10.05, 0, true), now) == pretrade::ORDER_SIZE);
+        assert(checker.check(0, make_order(1, 10.05, 500, true), now) == pretrade::NOTIONAL);  // 5025
+        assert(checker.check(0, make_order(1, 10.61, 100, true), now) == pretrade::PRICE_COLLAR);
+        assert(checker.check(0, make_order(1, 9.49, 100, false), now) == pretrade::PRICE_COLLAR);
+        assert(checker.check(0, make_order(1, 9.50, 100, false), now) == 0);
+        assert(checker.exposure(0, 0)->open_sell_quantity == 100 && checker.account_state(0).open_orders == 1);
+
+        //The collar is around the order's own symbol, which has no BBO yet
+        assert(checker.check(0, make_order(1, 9.50, 100, false, 1), now) == pretrade::PRICE_COLLAR);
+        assert(checker.check(0, make_order(1, 9.50, 100, false, 2), now) == pretrade::UNKNOWN_SYMBOL);
+        checker.update_reference(1, wire::to_wire_price(20.00), wire::to_wire_price(20.10));
+        assert(checker.check(0, make_order(1, 10.05, 100, true, 1), now) == pretrade::PRICE_COLLAR);
+        assert(checker.exposure(0, 1)->open_buy_quantity == 0);
+
+        //Same side, price and quantity inside the window: duplicate; after it: fine
+        assert(checker.check(0, make_order(2, 9.50, 100, false), now + MS / 2) == pretrade::DUPLICATE);
+        assert(checker.check(0, make_order(2, 9.50, 100, true), now + MS / 2) == 0);
+        assert(checker.check(0, make_order(3, 9.50, 100, false), now + 2 * MS) == 0);
+        assert(checker.check(0, make_order(4, 9.60, 100, false), now + 2 * MS) == pretrade::OPEN_ORDERS);
+        std::cout << "######PRETRADE RISK TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_pretrade_position()
+    {
+        //Buys count every open buy as filled; fills move quantity from open to position and
+        //done orders free their open quantity and count
+        using order_state::make_order;
+        using order_state::ExecutionUpdate;
+        using order_state::OrderEvent;
+        pretrade::PreTradeChecker checker(1, 2, 2, 0.0, 2.0); // no duplicate window
+        checker.set_limits(0, pretrade_test_limits());
+        checker.update_reference(0, wire::to_wire_price(4.00), wire::to_wire_price(4.01));
+        checker.update_reference(1, wire::to_wire_price(4.00), wire::to_wire_price(4.01));
+        uint64_t now = 1ULL << 40;
+        order_state::OrderRecord first = make_order(1, 4.00, 1000, true);
+        assert(checker.check(0, first, now) == 0);
+        assert(checker.check(0, make_order(2, 4.00, 600, true), now) == pretrade::POSITION);
+        assert(checker.check(0, make_order(2, 4.00, 500, true), now) == 0);
+        assert(checker.check(0, make_order(3, 4.01, 1000, false), now) == 0); // sells are not limited by buys
+
+        checker.on_execution(0, first, ExecutionUpdate{1, 4.00, 400, OrderEvent::FILL});
+        first.leaves_quantity = 600;
+        assert(checker.exposure(0, 0)->position == 400 && checker.exposure(0, 0)->open_buy_quantity == 1100);
+        checker.on_execution(0, first, ExecutionUpdate{1, 0.0, 0, OrderEvent::CANCEL_ACK});
+        assert(checker.exposure(0, 0)->open_buy_quantity == 500 && checker.account_state(0).open_orders == 2);
+        assert(checker.check(0, make_order(4, 4.00, 600, true), now) == 0);  // 400 + 500 + 600
+        assert(checker.check(0, make_order(5, 4.00, 1, true), now) == (pretrade::POSITION | pretrade::OPEN_ORDERS));
+        //Each symbol has its own position limit
+        checker.on_execution(0, make_order(4, 4.00, 600, true), ExecutionUpdate{4, 0.0, 0, OrderEvent::CANCEL_ACK});
+        assert(checker.check(0, make_order(6, 4.00, 1000, true, 1), now) == 0);
+        assert(checker.exposure(0, 1)->open_buy_quantity == 1000 && checker.exposure(0, 0)->open_buy_quantity == 500);
+        std::cout << "######PRETRADE RISK TEST CASE 2 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_pretrade_risk_tests()
+    {
+        test_pretrade_limits();
+        test_pretrade_position();
+    }
@@ -0,0 +1,118 @@
+#include <cassert>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "../risk_monitor.hpp"
+
+    std::vector<monitor::Alert> drain_alerts(monitor::RiskMonitor& risk)
+    {
+        std::vector<monitor::Alert> alerts;
+        risk.drain([&](const monitor::Alert& alert) { alerts.push_back(alert); });
+        return alerts;
+    }
+
+    void test_risk_monitor_limits()
+    {
+        //Alerts fire when a limit is crossed and when it clears, not on every update in between
+        using monitor::AlertType;
+        positions::PositionBook book(100);
+        monitor::Limits limits;
+        limits.max_symbol_exposure = 5000;
+        limits.max_gross_exposure = 12000;
+        limits.max_drawdown = 500;
+        monitor::RiskMonitor risk(100, limits);
+        book.on_fill(7, true, 400, 10.0);
+        book.on_quote(7, 9.5, 10.5);
+        assert(risk.evaluate(7, book, 1) == 0);
+        book.on_fill(7, true, 200, 10.0);
+        assert(risk.evaluate(7, book, 2) == 1 && risk.symbol_breach(7));
+        book.on_quote(7, 10.5, 11.5);
+        assert(risk.evaluate(7, book, 3) == 0); // still above: nothing new
+        std::vector<monitor::Alert> alerts = drain_alerts(risk);
+        assert(alerts.size() == 1 && alerts[0].type == AlertType::SYMBOL_EXPOSURE && alerts[0].breached);
+        assert(alerts[0].symbol == 7 && alerts[0].value == 6000 && alerts[0].time == 2);
+
+        book.on_fill(42, false, 700, 10.0);
+        book.on_quote(42, 9.5, 10.5);
+        assert(risk.evaluate(42, book, 4) == 2);  // 42 above its own limit, gross 6600 + 7000
+        book.on_quote(7, 9.5, 10.5);              // 7 falls back to 6000: still above
+        book.on_quote(42, 10.5, 11.5);            // short 700 loses 700
+        assert(risk.evaluate(42, book, 5) == 1);  // drawdown from the 600 peak
+        alerts = drain_alerts(risk);
+        assert(alerts.size() == 3 && alerts[1].type == AlertType::GROSS_EXPOSURE && alerts[1].value == 6600 + 7000);
+        assert(alerts[2].type == AlertType::DRAWDOWN && alerts[2].breached);
+        assert(risk.breached(AlertType::DRAWDOWN) && risk.breached(AlertType::GROSS_EXPOSURE));
+
+        book.on_fill(42, true, 700, 11.0);        // flat: realized -700
+        assert(risk.evaluate(42, book, 6) == 2);  // symbol and gross limits clear, the drawdown stays
+        alerts = drain_alerts(risk);
+        assert(!alerts[0].breached && alerts[0].type == AlertType::SYMBOL_EXPOSURE && alerts[0].symbol == 42);
+        assert(!alerts[1].breached && alerts[1].type == AlertType::GROSS_EXPOSURE);
+        std::cout << "######RISK MONITOR TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_risk_monitor_concentration()
+    {
+        //The largest position's share of the gross exposure, tracked without rescanning; the
+        //alerts reach a separate draining thread
+        positions::PositionBook book(1000);
+        monitor::Limits limits;
+        limits.max_concentration = 0.25;
+        limits.concentration_floor = 1000;
+        monitor::RiskMonitor risk(1000, limits);
+        std::vector<monitor::Alert> received;
+        std::thread alerts([&] {
+            wait::WaitStrategy waiter(wait::Mode::SPIN_PARK, 100);
+            while (received.size() < 3) {
+                waiter.wait_until([&]() { return risk.pending(); }, &risk.signal());
+                risk.drain([&](const monitor::Alert& alert) { received.push_back(alert); });
+            }
+        });
+        for (uint32_t s = 0; s < 10; s++) {
+            book.on_fill(s * 100, true, 100, 1.0);
+            book.on_quote(s * 100, 1.0, 1.0);
+            risk.evaluate(s * 100, book, s);  // one symbol of 100 is 100%, but below the floor
+        }
+        assert(!risk.breached(monitor::AlertType::CONCENTRATION));
+        book.on_fill(300, true, 300, 1.0);
+        book.on_quote(300, 1.0, 1.0);
+        assert(risk.evaluate(300, book, 10) == 1); // 400 of 1300
+        book.on_fill(900, true, 300, 1.0);
+        book.on_quote(900, 1.0, 1.0);
+        assert(risk.evaluate(900, book, 11) == 1); // 400 of 1600 is the limit, not above it
+        book.on_fill(500, true, 1000, 1.0);
+        book.on_quote(500, 1.0, 1.0);
+        assert(risk.evaluate(500, book, 12) == 1); // 1100 of 2600
+        alerts.join();
+        assert(received.size() == 3 && received[0].symbol == 300 && received[0].breached);
+        assert(received[1].symbol == 300 && !received[1].breached);
+        assert(received[2].symbol == 500 && received[2].breached && received[2].value == 1100.0 / 2600.0);
+        std::cout << "######RISK MONITOR TEST CASE 2 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_risk_monitor_drawdown_from_first_equity()
+    {
+        //Drawdown is measured from the first equity seen: a book that starts at a loss is not in
+        //drawdown until it falls from there
+        positions::PositionBook book(10);
+        monitor::Limits limits;
+        limits.max_drawdown = 500;
+        monitor::RiskMonitor risk(10, limits);
+        book.on_fill(1, true, 1000, 10.0);
+        book.on_quote(1, 9.35, 9.45);             // -600
+        assert(risk.evaluate(1, book, 1) == 0);
+        book.on_quote(1, 8.95, 9.05);             // -1000
+        assert(risk.evaluate(1, book, 2) == 0 && !risk.breached(monitor::AlertType::DRAWDOWN));
+        book.on_quote(1, 8.85, 8.95);             // -1100: 500 below the first
+        assert(risk.evaluate(1, book, 3) == 0);
+        book.on_quote(1, 8.75, 8.85);             // -1200
+        assert(risk.evaluate(1, book, 4) == 1 && risk.breached(monitor::AlertType::DRAWDOWN));
+        std::cout << "######RISK MONITOR TEST CASE 3 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_risk_monitor_tests()
+    {
+        test_risk_monitor_limits();
+        test_risk_monitor_concentration();
+        test_risk_monitor_drawdown_from_first_equity();
+    }
@@ -0,0 +1,81 @@
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "../rms.hpp"
+
+    void test_rms_start_stop()
+    {
+        //Setup happens before Start and is refused after it, while the market data thread may
+        //be reading what it would change; Stop lets both threads return
+        conflation::ConflationBuffer buffer(16, 1);
+        RMS rms(buffer);
+        rms.FetchPositionData(3, 100.0, 10.0);
+        pretrade::Limits limits;
+        limits.max_order_quantity = 1000;
+        rms.SetAccountLimits(0, limits);
+        rms.SetMonitorLimits(monitor::Limits());
+        rms.Start();
+        bool refused = false;
+        try {
+            rms.FetchPositionData(4, 100.0, 10.0);
+        } catch (const std::logic_error&) {
+            refused = true;
+        }
+        assert(refused);
+        refused = false;
+        try {
+            rms.SetMonitorLimits(monitor::Limits());
+        } catch (const std::logic_error&) {
+            refused = true;
+        }
+        assert(refused);
+        refused = false;
+        try {
+            rms.Start();
+        } catch (const std::logic_error&) {
+            refused = true;
+        }
+        assert(refused);
+        rms.Stop();
+        std::cout << "######RMS TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_rms_var_while_running()
+    {
+        //VaR runs on the test thread against the positions as the market data thread has them:
+        //a long of 100 at a mid of 10 loses 2% of 1000 on the 3rd worst of 10 days
+        std::vector<double> returns = {
+            0.01, -0.02, 0.03, -0.05, 0.00, 0.02, -0.01, 0.04, -0.03, 0.01,   // symbol 0
+            0.00, 0.01, -0.01, 0.02, -0.04, 0.00, 0.01, -0.02, 0.03, 0.00,    // symbol 1
+        };
+        conflation::ConflationBuffer buffer(16, 1);
+        RMS rms(buffer);
+        rms.SetScenarios(std::unique_ptr<var::Scenarios>(new var::HistoricalScenarios(2, 10, returns)), 0.8);
+        rms.FetchPositionData(0, 100.0, 9.0);
+        assert(rms.RevalueScenarios().value_at_risk == 0.0);  // not marked yet
+        rms.Start();
+        conflation::MarketSnapshot quote{};
+        quote.symbol_id = 0;
+        quote.bid_levels = quote.offer_levels = 1;
+        quote.bids[0] = {9.99, 100};
+        quote.offers[0] = {10.01, 100};
+        buffer.publish(quote);
+        var::RiskEstimate risk{0.0, 0.0};
+        for (int tries = 0; tries < 10000 && risk.value_at_risk == 0.0; tries++)
+            risk = rms.RevalueScenarios();  // until the market data thread has marked it
+        assert(std::fabs(risk.value_at_risk - 20.0) < 1e-9);
+        var::RiskEstimate hedged = rms.AssessPortfolioRisk(1, order_state::make_order(1, 50.0, 20, false, 1));
+        assert(std::fabs(rms.RevalueScenarios().value_at_risk - risk.value_at_risk) < 1e-9);
+        assert(hedged.value_at_risk != risk.value_at_risk);
+        rms.Stop();
+        std::cout << "######RMS TEST CASE 2 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_rms_tests()
+    {
+        test_rms_start_stop();
+        test_rms_var_while_running();
+    }
@@ -0,0 +1,163 @@
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "../shm_ring.hpp"
+
+    // 16-byte payload: 5-byte topic (symbol id + type) like a hub message, then a value
+    struct RingTestMessage {
+        uint32_t symbol_id;
+        uint8_t type;
+        uint8_t pad[3];
+        uint64_t value;
+    };
+
+    void publish_values(shm::ShmPublisher& publisher, uint32_t symbols, uint64_t from, uint64_t to)
+    {
+        for (uint64_t v = from; v < to; v++) {
+            RingTestMessage msg{};
+            msg.symbol_id = static_cast<uint32_t>(v % symbols);
+            msg.type = 1;
+            msg.value = v;
+            publisher.send(&msg, sizeof(msg));
+        }
+    }
+
+    std::vector<uint64_t> poll_values(shm::ShmSubscriber& subscriber, size_t max_messages = SIZE_MAX)
+    {
+        std::vector<uint64_t> values;
+        subscriber.poll([&](const char* data, uint32_t length) {
+            assert(length == sizeof(RingTestMessage));
+            RingTestMessage msg;
+            std::memcpy(&msg, data, sizeof(msg));
+            values.push_back(msg.value);
+        }, max_messages);
+        return values;
+    }
+
+    // Each record is 32 bytes (16-byte record header + payload): a 1 KiB ring holds 32 of them
+    const uint64_t RING_TEST_CAPACITY = 1024;
+
+    void test_shm_drop_newest_holds_publisher()
+    {
+        //A lagging DROP_NEWEST consumer is never overrun: the publisher skips updates instead
+        shm::ShmPublisher publisher("/lob_ring_test_newest", RING_TEST_CAPACITY);
+        shm::ShmSubscriber subscriber("/lob_ring_test_newest", shm::SlowConsumerPolicy::DROP_NEWEST);
+        publish_values(publisher, 4, 0, 40);
+        assert(publisher.dropped_messages() == 8);
+        std::vector<uint64_t> values = poll_values(subscriber);
+        assert(values.size() == 32);
+        assert(values.front() == 0 && values.back() == 31);
+        assert(subscriber.lost_messages() == 0);
+
+        std::vector<shm::ConsumerStats> stats = publisher.consumer_stats();
+        assert(stats.size() == 1 && stats[0].lag_messages == 0 && stats[0].lag_bytes == 0);
+        std::cout << "######SHM RING TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_shm_drop_oldest_overrun()
+    {
+        //A DROP_OLDEST consumer does not hold the publisher back and resumes from the oldest intact record
+        shm::ShmPublisher publisher("/lob_ring_test_oldest", RING_TEST_CAPACITY);
+        shm::ShmSubscriber subscriber("/lob_ring_test_oldest", shm::SlowConsumerPolicy::DROP_OLDEST);
+        publish_values(publisher, 4, 0, 100);
+        assert(publisher.dropped_messages() == 0);
+
+        std::vector<shm::ConsumerStats> stats = publisher.consumer_stats();
+        assert(stats.size() == 1 && stats[0].lag_messages == 100);
+
+        std::vector<uint64_t> values = poll_values(subscriber);
+        assert(values.size() == 32);
+        assert(values.front() == 68 && values.back() == 99);
+        assert(subscriber.lost_messages() == 68);
+        stats = publisher.consumer_stats();
+        assert(stats[0].lag_messages == 0 && stats[0].lost == 68);
+        std::cout << "######SHM RING TEST CASE 2 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_shm_conflate_keeps_latest_per_topic()
+    {
+        //A CONFLATE consumer more than half a ring behind gets only the latest record per topic
+        shm::ShmPublisher publisher("/lob_ring_test_conflate", RING_TEST_CAPACITY);
+        shm::ShmSubscriber subscriber("/lob_ring_test_conflate", shm::SlowConsumerPolicy::CONFLATE);
+        publish_values(publisher, 4, 0, 20);
+        std::vector<uint64_t> values = poll_values(subscriber);
+        assert(values.size() == 4);
+        assert(values[0] == 16 && values[1] == 17 && values[2] == 18 && values[3] == 19);
+        assert(subscriber.lost_messages() == 16);
+
+        //Within half a ring it reads every record
+        publish_values(publisher, 4, 20, 25);
+        values = poll_values(subscriber);
+        assert(values.size() == 5 && values.front() == 20);
+        assert(subscriber.lost_messages() == 16);
+        std::cout << "######SHM RING TEST CASE 3 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_shm_conflate_max_messages()
+    {
+        //A conflated poll delivers at most max_messages topics: the scan stops at the first record
+        //of one more, and the next poll picks up from there without losing it
+        shm::ShmPublisher publisher("/lob_ring_test_conflate_max", RING_TEST_CAPACITY);
+        shm::ShmSubscriber subscriber("/lob_ring_test_conflate_max", shm::SlowConsumerPolicy::CONFLATE);
+        publish_values(publisher, 4, 0, 20);
+        std::vector<uint64_t> values = poll_values(subscriber, 2);
+        assert(values.size() == 2 && values[0] == 0 && values[1] == 1);
+        values = poll_values(subscriber, 2);
+        assert(values.size() == 2 && values[0] == 2 && values[1] == 3);
+        values = poll_values(subscriber);  // half a ring left: read record by record
+        assert(values.size() == 16 && values.front() == 4 && values.back() == 19);
+        assert(subscriber.lost_messages() == 0);
+        std::cout << "######SHM RING TEST CASE 5 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_shm_disconnect_and_rejoin()
+    {
+        //A DISCONNECT consumer a full ring behind is detached; the publisher keeps going
+        shm::ShmPublisher publisher("/lob_ring_test_disconnect", RING_TEST_CAPACITY);
+        shm::ShmSubscriber subscriber("/lob_ring_test_disconnect", shm::SlowConsumerPolicy::DISCONNECT);
+        publish_values(publisher, 4, 0, 40);
+        assert(publisher.dropped_messages() == 0);
+        assert(publisher.disconnected_consumers() == 1);
+        assert(subscriber.disconnected());
+        assert(subscriber.poll([](const char*, uint32_t) {}) == 0);
+
+        subscriber.rejoin();
+        assert(!subscriber.disconnected());
+        assert(subscriber.lost_messages() == 40);
+        publish_values(publisher, 4, 40, 42);
+        std::vector<uint64_t> values = poll_values(subscriber);
+        assert(values.size() == 2 && values[0] == 40);
+        std::cout << "######SHM RING TEST CASE 4 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_shm_disconnect_mid_poll()
+    {
+        //A DISCONNECT consumer overrun while it is inside poll() is detached and its bytes are
+        //reused at once: it stops at the first overwritten record instead of delivering it
+        shm::ShmPublisher publisher("/lob_ring_test_disconnect_mid", RING_TEST_CAPACITY);
+        shm::ShmSubscriber subscriber("/lob_ring_test_disconnect_mid", shm::SlowConsumerPolicy::DISCONNECT);
+        publish_values(publisher, 4, 0, 10);
+        std::vector<uint64_t> values;
+        size_t delivered = subscriber.poll([&](const char* data, uint32_t length) {
+            assert(length == sizeof(RingTestMessage));
+            RingTestMessage msg;
+            std::memcpy(&msg, data, sizeof(msg));
+            values.push_back(msg.value);
+            if (values.size() == 1)
+                publish_values(publisher, 4, 10, 50);  // laps the reader mid-poll
+        });
+        assert(delivered == 1 && values.size() == 1 && values[0] == 0);
+        assert(publisher.disconnected_consumers() == 1 && subscriber.disconnected());
+        std::cout << "######SHM RING TEST CASE 6 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_shm_ring_tests()
+    {
+        test_shm_drop_newest_holds_publisher();
+        test_shm_drop_oldest_overrun();
+        test_shm_conflate_keeps_latest_per_topic();
+        test_shm_disconnect_and_rejoin();
+        test_shm_conflate_max_messages();
+        test_shm_disconnect_mid_poll();
+    }
@@ -0,0 +1,116 @@
+#include <cassert>
+#include <iostream>
+#include <vector>
+#include "../throttle.hpp"
+
+    struct ThrottledSend {
+        int session;
+        throttle::Priority priority;
+        int64_t id;
+        uint64_t time;
+    };
+
+    void test_throttle_burst()
+    {
+        //Simulated clock, 1 cycle per ns: a venue allowing 1000 msg/s with bursts of 10 takes the
+        //first 10 of a 50 order burst at once, then one per ms; nothing ever beats the rate
+        const uint64_t MS = 1000000;
+        throttle::OrderThrottle limiter(64, 1.0);
+        int venue = limiter.add_venue(1000, 10, 0);
+        int session = limiter.add_session(venue, 0, 1, 0); // the venue limit only
+        std::vector<ThrottledSend> sent;
+        auto record = [&](uint64_t now) {
+            return [&sent, now](int s, throttle::Priority p, const order_state::OrderRecord& order) {
+                sent.push_back(ThrottledSend{s, p, order.id, now});
+            };
+        };
+        for (int64_t id = 0; id < 50; id++)
+            assert(limiter.submit(session, throttle::Priority::NEW, order_state::make_order(id, 10.0, 100, true)) ==
+                   throttle::SubmitResult::QUEUED);
+        assert(limiter.dispatch(0, record(0)) == 10);
+        assert(limiter.dispatch(MS / 2, record(MS / 2)) == 0);
+        for (uint64_t now = MS; now <= 40 * MS; now += MS)
+            assert(limiter.dispatch(now, record(now)) == 1);
+        assert(limiter.idle() && sent.size() == 50);
+        for (size_t i = 0; i < sent.size(); i++)
+            assert(sent[i].id == static_cast<int64_t>(i));
+        //Any window holds at most the burst plus one per ms elapsed
+        for (size_t i = 0; i < sent.size(); i++)
+            for (size_t j = i; j < sent.size(); j++)
+                assert(j - i + 1 <= 10 + (sent[j].time - sent[i].time) / MS);
+
+        //Idle long enough and the burst is back, but no more than the burst
+        assert(limiter.dispatch(1000 * MS, record(1000 * MS)) == 0);
+        for (int64_t id = 50; id < 80; id++)
+            limiter.submit(session, throttle::Priority::NEW, order_state::make_order(id, 10.0, 100, true));
+        assert(limiter.dispatch(1000 * MS, record(1000 * MS)) == 10);
+        std::cout << "######THROTTLE TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_throttle_cancels_first()
+    {
+        //With the session out of tokens, queued cancels leave before queued new orders; a cancel
+        //for a new order still queued withdraws it and sends neither
+        const uint64_t MS = 1000000;
+        throttle::OrderThrottle limiter(64, 1.0);
+        int venue = limiter.add_venue(0, 1, 0);               // no venue limit
+        int slow = limiter.add_session(venue, 1000, 2, 0);
+        int fast = limiter.add_session(venue, 0, 1, 0);       // shares the venue, unlimited
+        std::vector<ThrottledSend> sent;
+        auto send = [&](int s, throttle::Priority p, const order_state::OrderRecord& order) {
+            sent.push_back(ThrottledSend{s, p, order.id, 0});
+        };
+        for (int64_t id = 1; id <= 6; id++)
+            limiter.submit(slow, throttle::Priority::NEW, order_state::make_order(id, 10.0, 100, true));
+        limiter.submit(fast, throttle::Priority::NEW, order_state::make_order(7, 10.0, 100, true));
+        assert(limiter.dispatch(0, send) == 3); // 2 from the burst, the unlimited session's one
+        assert(limiter.submit(slow, throttle::Priority::CANCEL, order_state::make_order(1, 10.0, 100, true)) ==
+               throttle::SubmitResult::QUEUED);
+        assert(limiter.submit(slow, throttle::Priority::CANCEL, order_state::make_order(5, 10.0, 100, true)) ==
+               throttle::SubmitResult::WITHDRAWN);
+        assert(limiter.submit(slow, throttle::Priority::CANCEL, order_state::make_order(2, 10.0, 100, true)) ==
+               throttle::SubmitResult::QUEUED);
+        for (uint64_t now = MS; now <= 10 * MS; now += MS)
+            limiter.dispatch(now, send);
+        assert(limiter.idle() && limiter.withdrawn_orders() == 1);
+        std::vector<int64_t> order;
+        for (const ThrottledSend& s : sent)
+            order.push_back(s.priority == throttle::Priority::CANCEL ? -s.id : s.id);
+        assert((order == std::vector<int64_t>{1, 2, 7, -1, -2, 3, 4, 6}));
+        std::cout << "######THROTTLE TEST CASE 2 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_throttle_cancels_first_across_sessions()
+    {
+        //Two sessions share a venue limit: the second session's cancel takes the venue's token
+        //before the first session's new orders, though the first session is dispatched first
+        const uint64_t MS = 1000000;
+        throttle::OrderThrottle limiter(64, 1.0);
+        int venue = limiter.add_venue(1000, 2, 0);
+        int orders = limiter.add_session(venue, 0, 1, 0);
+        int cancels = limiter.add_session(venue, 0, 1, 0);
+        std::vector<ThrottledSend> sent;
+        auto send = [&](int s, throttle::Priority p, const order_state::OrderRecord& order) {
+            sent.push_back(ThrottledSend{s, p, order.id, 0});
+        };
+        for (int64_t id = 1; id <= 4; id++)
+            limiter.submit(orders, throttle::Priority::NEW, order_state::make_order(id, 10.0, 100, true));
+        limiter.submit(cancels, throttle::Priority::CANCEL, order_state::make_order(9, 10.0, 100, true));
+        assert(limiter.dispatch(0, send) == 2);
+        assert(sent[0].session == cancels && sent[0].priority == throttle::Priority::CANCEL && sent[0].id == 9);
+        assert(sent[1].session == orders && sent[1].id == 1);
+        limiter.submit(cancels, throttle::Priority::CANCEL, order_state::make_order(8, 10.0, 100, true));
+        assert(limiter.dispatch(MS, send) == 1 && sent[2].id == 8);
+        for (uint64_t now = 2 * MS; now <= 5 * MS; now += MS)
+            limiter.dispatch(now, send);
+        assert(limiter.idle() && sent.size() == 6);
+        assert(sent[3].id == 2 && sent[4].id == 3 && sent[5].id == 4);
+        std::cout << "######THROTTLE TEST CASE 3 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_throttle_tests()
+    {
+        test_throttle_burst();
+        test_throttle_cancels_first();
+        test_throttle_cancels_first_across_sessions();
+    }
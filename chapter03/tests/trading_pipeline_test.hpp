@@ -0,0 +1,50 @@
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include "../trading_pipeline.hpp"
+
+    void test_trading_pipeline_top_of_book()
+    {
+        //The feed publishes back to back, so the book stage runs ahead of the strategy; each
+        //event still carries the top of book right after its own update, and the child order
+        //the strategy builds from it reaches execution unchanged
+        const int UPDATES = 5000;
+        int stale = 0;
+        int sent = 0;
+        int64_t last_quantity = 0;
+        auto strategy = [&stale](const pipeline::MarketEvent& event, circular_array::Order& child, bool& child_is_bid) {
+            if (!event.is_bid)
+                return false;
+            stale += event.best_bid.quantity != event.update.quantity || event.best_offer.price != 10.05;
+            child = event.best_offer;
+            child_is_bid = true;
+            return event.update.quantity % 10 == 0;
+        };
+        auto risk = [](const circular_array::Order& child, bool) { return child.quantity > 0; };
+        auto execution = [&sent, &last_quantity](const circular_array::Order& child, bool child_is_bid) {
+            assert(child_is_bid && child.price == 10.05);
+            last_quantity = child.quantity;
+            sent++;
+        };
+        circular_array::LimitOrderBook book(2, 100);
+        pipeline::TradingPipeline<decltype(strategy), decltype(risk), decltype(execution)> trading(
+            book, strategy, risk, execution, wait::WaitStrategy(), 64);
+        trading.start();
+        trading.publish(circular_array::Order(2, 10.05, 700), false, wire::DepthAction::NEW);
+        trading.publish(circular_array::Order(1, 10.01, 1), true, wire::DepthAction::NEW);
+        int64_t last = 0;
+        for (int i = 2; i <= UPDATES; i++)
+            last = trading.publish(circular_array::Order(1, 10.01, i), true, wire::DepthAction::CHANGE);
+        while (trading.completed() < last)
+            std::this_thread::yield();
+        trading.stop();
+        assert(stale == 0);
+        assert(sent == UPDATES / 10 && last_quantity == 700);
+        assert(trading.end_to_end_latency().count() == static_cast<uint64_t>(UPDATES + 1));
+        std::cout << "######TRADING PIPELINE TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_trading_pipeline_tests()
+    {
+        test_trading_pipeline_top_of_book();
+    }
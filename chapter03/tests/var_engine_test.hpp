@@ -0,0 +1,69 @@
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <tbb/task_arena.h>
+#include "../var_engine.hpp"
+
+    void test_var_historical()
+    {
+        //Ten days of two symbols: VaR is the loss of the worst day beyond the confidence, ES the
+        //average of the days at or beyond it; a what-if equals revaluing the changed portfolio
+        std::vector<double> returns = {
+            0.01, -0.02, 0.03, -0.05, 0.00, 0.02, -0.01, 0.04, -0.03, 0.01,   // symbol 0
+            0.00, 0.01, -0.01, 0.02, -0.04, 0.00, 0.01, -0.02, 0.03, 0.00,    // symbol 1
+        };
+        var::HistoricalScenarios history(2, 10, returns);
+        var::VarEngine engine(history, 0.8);  // the 3rd worst day of 10
+        double quantities[2] = {100, 0}, marks[2] = {10.0, 50.0};
+        var::RiskEstimate risk = engine.revalue(quantities, marks);
+        assert(std::fabs(risk.value_at_risk - 20.0) < 1e-9);                          // -0.02 x 1000
+        assert(std::fabs(risk.expected_shortfall - (50.0 + 30.0 + 20.0) / 3) < 1e-9);
+        assert(std::fabs(engine.scenario_pnl()[3] + 50.0) < 1e-9);
+
+        var::RiskEstimate hedged = engine.what_if(1, -20, 50.0);
+        quantities[1] = -20;
+        var::RiskEstimate full = engine.revalue(quantities, marks);
+        assert(std::fabs(hedged.value_at_risk - full.value_at_risk) < 1e-9);
+        assert(std::fabs(hedged.expected_shortfall - full.expected_shortfall) < 1e-9);
+        std::cout << "######VAR ENGINE TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_var_monte_carlo()
+    {
+        //One symbol, normal returns: 99% VaR close to 2.326 sigma x exposure. The same seed
+        //gives the same scenarios whatever the number of threads.
+        const size_t SCENARIOS = 40000;
+        var::MonteCarloScenarios model({0.5, 1.0, 0.0}, {0.01, 0.02, 0.03}, SCENARIOS, 42);
+        double quantities[3] = {0, 0, 1000}, marks[3] = {20.0, 30.0, 10.0};
+        var::VarEngine engine(model, 0.99);
+        var::RiskEstimate single = engine.revalue(quantities, marks);
+        assert(std::fabs(single.value_at_risk / (2.326 * 0.03 * 10000) - 1.0) < 0.05);
+        assert(std::fabs(single.expected_shortfall / (2.665 * 0.03 * 10000) - 1.0) < 0.05);
+
+        quantities[0] = 500;
+        quantities[1] = -300;
+        var::RiskEstimate parallel = engine.revalue(quantities, marks);
+        std::vector<double> pnl = engine.scenario_pnl();
+        tbb::task_arena one_thread(1);
+        var::RiskEstimate serial;
+        one_thread.execute([&] { serial = engine.revalue(quantities, marks); });
+        assert(serial.value_at_risk == parallel.value_at_risk && engine.scenario_pnl() == pnl);
+
+        var::MonteCarloScenarios same(std::vector<double>{0.5, 1.0, 0.0}, std::vector<double>{0.01, 0.02, 0.03},
+                                      SCENARIOS, 42);
+        double column[7];
+        std::vector<double> expected(SCENARIOS);
+        model.returns(1, 0, SCENARIOS, expected.data());
+        same.returns(1, 1001, 7, column); // an odd first scenario starts inside a draw pair
+        for (int i = 0; i < 7; i++)
+            assert(column[i] == expected[1001 + i]);
+        std::cout << "######VAR ENGINE TEST CASE 2 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_var_engine_tests()
+    {
+        test_var_historical();
+        test_var_monte_carlo();
+    }
@@ -0,0 +1,40 @@
+#include <cassert>
+#include <iostream>
+#include "../venue_router.hpp"
+
+    void test_venue_router_split()
+    {
+        //Cheapest venue (price + fee) first, each for the size it is expected to fill inside the
+        //limit; the remainder rests at the cheapest venue
+        routing::VenueRouter router;
+        int lit = router.add_venue(0.003);              // taker fee
+        int rebate = router.add_venue(-0.002, 0.5);     // rebate, fills half of what it shows
+        int cheap = router.add_venue(0.0);
+        int empty = router.add_venue(-0.01);            // best fee, no liquidity
+        router.update_quote(lit, 10.00, 100, 10.02, 100);
+        router.update_quote(rebate, 10.00, 100, 10.02, 400);
+        router.update_quote(cheap, 9.99, 500, 10.01, 50);
+        router.update_quote(empty, 0, 0, 0, 0);
+        routing::ChildOrder children[routing::MAX_VENUES];
+
+        size_t count = router.route(order_state::make_order(1, 10.02, 1000, true), children);
+        assert(count == 3);
+        assert(children[0].venue == cheap && children[0].quantity == 50 + 650);
+        assert(children[1].venue == rebate && children[1].quantity == 200);
+        assert(children[2].venue == lit && children[2].quantity == 100);
+        assert(children[0].price == 10.02);
+
+        count = router.route(order_state::make_order(2, 10.015, 1000, true), children);
+        assert(count == 1 && children[0].venue == cheap && children[0].quantity == 1000);
+
+        count = router.route(order_state::make_order(3, 10.00, 300, false), children);
+        assert(count == 2);
+        assert(children[0].venue == rebate && children[0].quantity == 50 + 150);
+        assert(children[1].venue == lit && children[1].quantity == 100);
+        std::cout << "######VENUE ROUTER TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_venue_router_tests()
+    {
+        test_venue_router_split();
+    }
@@ -0,0 +1,82 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include "../wait_strategy.hpp"
+
+    void test_wake_signal_park()
+    {
+        //park returns at once when the epoch already moved, after the timeout when nobody
+        //notifies, and as soon as a notify comes otherwise
+        wait::WakeSignal signal;
+        uint32_t seen = signal.current();
+        signal.notify();
+        assert(signal.current() == seen + 1);
+        auto start = std::chrono::steady_clock::now();
+        signal.park(seen, 900000000L);                 // stale: no sleep
+        assert(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500));
+
+        start = std::chrono::steady_clock::now();
+        signal.park(signal.current(), 5000000L);       // 5 ms, nobody notifies
+        assert(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(4));
+
+        start = std::chrono::steady_clock::now();
+        signal.park(signal.current(), 1010000000L);    // over a second: still a valid timeout
+        assert(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(1000));
+
+        std::atomic<bool> woken{false};
+        seen = signal.current();
+        std::thread sleeper([&] {
+            wait::WaitStrategy parking(wait::Mode::SPIN_PARK, 0, 900000000L);
+            assert(parking.wait_for(signal, seen) == seen + 1);
+            woken.store(true);
+        });
+        start = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        signal.notify();
+        sleeper.join();
+        assert(woken.load() && std::chrono::steady_clock::now() - start < std::chrono::milliseconds(800));
+        std::cout << "######WAIT STRATEGY TEST CASE 1 PASSED" << std::endl<< std::endl;
+    }
+
+    void test_wait_strategy_modes()
+    {
+        //Every mode returns once the condition holds, whichever thread makes it true
+        const wait::Mode modes[] = {wait::Mode::BUSY_SPIN, wait::Mode::PAUSE_SPIN, wait::Mode::SPIN_YIELD,
+                                    wait::Mode::SPIN_PARK};
+        for (wait::Mode mode : modes) {
+            wait::WaitStrategy waiter(mode, 10, 1000000L);
+            assert(waiter.get_mode() == mode);
+            assert(std::strcmp(wait::mode_name(mode), "unknown") != 0);
+            int polls = 0;
+            waiter.wait_until([&]() { return ++polls == 50; });
+            assert(polls == 50);
+
+            wait::WakeSignal signal;
+            std::atomic<bool> ready{false};
+            std::thread setter([&] {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                ready.store(true);
+                signal.notify();
+            });
+            waiter.wait_until([&]() { return ready.load(); }, &signal);
+            setter.join();
+        }
+        assert(std::strcmp(wait::mode_name(wait::Mode::SPIN_PARK), "spin_park") == 0);
+
+        //SPIN_PARK with no signal to wake it sleeps the timeout once past the spins
+        wait::WaitStrategy parking(wait::Mode::SPIN_PARK, 1, 3000000L);
+        auto start = std::chrono::steady_clock::now();
+        parking.idle(0);
+        parking.idle(1);
+        assert(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(2));
+        std::cout << "######WAIT STRATEGY TEST CASE 2 PASSED" << std::endl<< std::endl;
+    }
+
+    void run_wait_strategy_tests()
+    {
+        test_wake_signal_park();
+        test_wait_strategy_modes();
+    }
@@ -0,0 +1,233 @@
+#pragma once
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "latency_tracer.hpp"
+#include "order_state.hpp"
+
+// Outbound message-rate limits. Venues cap the messages a firm may send per second, across all
+// of its sessions and per session, and disconnect on a breach; every message therefore needs a
+// token from its session's bucket and from its venue's bucket. Buckets keep their credit in TSC
+// cycles, so refilling is a subtraction and a min with no conversion to time. Messages that find
+// no token wait in per-session rings, cancels ahead of new orders: pulling liquidity is never
+// held up behind adding it. The rings are allocated at setup, nothing is allocated per message.
+namespace throttle
+{
+
+const int MAX_SESSIONS = 64; // one bit each in the pending mask
+
+class TokenBucket {
+private:
+    uint64_t cycles_per_token = 0; // 0: unlimited
+    uint64_t capacity = 0;         // burst tokens worth of cycles
+    uint64_t credit = 0;
+    uint64_t last = 0;
+
+public:
+    TokenBucket() = default;
+    // Allows messages_per_second on average and up to burst back to back; starts full
+    TokenBucket(double messages_per_second, uint32_t burst, double cycles_per_ns, uint64_t now) {
+        if (messages_per_second <= 0.0 || burst == 0)
+            throw std::invalid_argument("token bucket needs a positive rate and burst");
+        cycles_per_token = static_cast<uint64_t>(1e9 * cycles_per_ns / messages_per_second);
+        cycles_per_token = cycles_per_token ? cycles_per_token : 1;
+        capacity = credit = cycles_per_token * burst;
+        last = now;
+    }
+
+    // Credits the cycles since the last refill, up to the burst
+    void refill(uint64_t now) {
+        uint64_t elapsed = now > last ? now - last : 0;
+        last = now > last ? now : last;
+        credit = capacity - credit > elapsed ? credit + elapsed : capacity;
+    }
+    bool ready() const { return credit >= cycles_per_token; }
+    void take() { credit -= cycles_per_token; }
+
+    bool try_acquire(uint64_t now) {
+        refill(now);
+        if (!ready())
+            return false;
+        take();
+        return true;
+    }
+    uint64_t tokens() const { return cycles_per_token ? credit / cycles_per_token : UINT64_MAX; }
+};
+
+enum class Priority : uint8_t {
+    CANCEL, // sent first
+    NEW,
+};
+const int PRIORITY_COUNT = 2;
+
+// Single-threaded FIFO of a power-of-two capacity
+class OrderRing {
+private:
+    std::vector<order_state::OrderRecord> slots;
+    uint64_t mask = 0;
+    uint64_t head = 0;
+    uint64_t tail = 0;
+
+public:
+    explicit OrderRing(size_t capacity = 0) {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        slots.resize(capacity ? size : 0);
+        mask = size - 1;
+    }
+    bool empty() const { return head == tail; }
+    size_t size() const { return tail - head; }
+    bool push(const order_state::OrderRecord& order) {
+        if (tail - head == slots.size())
+            return false;
+        slots[tail++ & mask] = order;
+        return true;
+    }
+    order_state::OrderRecord& front() { return slots[head & mask]; }
+    void pop() { head++; }
+    void clear() { head = tail; }
+    // Oldest first; fn(OrderRecord&) may modify in place
+    template <typename Fn>
+    void for_each(Fn&& fn) {
+        for (uint64_t i = head; i != tail; i++)
+            fn(slots[i & mask]);
+    }
+};
+
+enum class SubmitResult : uint8_t {
+    QUEUED,
+    WITHDRAWN, // a cancel for a new order that had not left yet: neither is sent
+    FULL,
+};
+
+// Sessions submit and dispatch from one thread. Order ids must be non-negative: a withdrawn
+// new order is marked with a negative id and skipped when it reaches the front.
+class OrderThrottle {
+private:
+    struct Session {
+        TokenBucket bucket;
+        int venue;
+        OrderRing queues[PRIORITY_COUNT];
+    };
+
+    double cycles_per_ns;
+    size_t queue_capacity;
+    std::vector<TokenBucket> venues;
+    std::vector<Session> sessions;
+    uint64_t pending = 0; // sessions with queued messages
+    uint64_t withdrawn = 0;
+
+    // Sends the session's queued messages of priority while both its buckets have tokens
+    template <typename Send>
+    size_t send_queued(int index, Priority priority, Send& send) {
+        Session& s = sessions[index];
+        TokenBucket& venue = venues[s.venue];
+        OrderRing& ring = s.queues[static_cast<int>(priority)];
+        size_t sent = 0;
+        while (true) {
+            while (!ring.empty() && ring.front().id < 0) // withdrawn
+                ring.pop();
+            if (ring.empty() || !(s.bucket.ready() & venue.ready()))
+                return sent;
+            s.bucket.take();
+            venue.take();
+            send(index, priority, ring.front());
+            ring.pop();
+            sent++;
+        }
+    }
+
+public:
+    explicit OrderThrottle(size_t queue_capacity = 4096,
+                           double cycles_per_ns = latency::TscClock::instance().cycles_per_ns())
+        : cycles_per_ns(cycles_per_ns), queue_capacity(queue_capacity) {
+        sessions.reserve(MAX_SESSIONS);
+    }
+
+    // A rate of 0 leaves the venue (or session) unlimited; returns the index for add_session
+    int add_venue(double messages_per_second, uint32_t burst, uint64_t now) {
+        venues.push_back(messages_per_second > 0.0 ? TokenBucket(messages_per_second, burst, cycles_per_ns, now)
+                                                   : TokenBucket());
+        return static_cast<int>(venues.size() - 1);
+    }
+    int add_session(int venue, double messages_per_second, uint32_t burst, uint64_t now) {
+        if (sessions.size() == MAX_SESSIONS)
+            throw std::length_error("throttle session table is full");
+        if (venue < 0 || venue >= static_cast<int>(venues.size()))
+            throw std::out_of_range("unknown venue");
+        sessions.push_back(Session{messages_per_second > 0.0 ? TokenBucket(messages_per_second, burst, cycles_per_ns, now)
+                                                             : TokenBucket(),
+                                   venue, {OrderRing(queue_capacity), OrderRing(queue_capacity)}});
+        return static_cast<int>(sessions.size() - 1);
+    }
+
+    // Queues order; nothing is sent before the next dispatch. FULL leaves the order with the
+    // caller, who should dispatch and retry rather than drop it.
+    SubmitResult submit(int session, Priority priority, const order_state::OrderRecord& order) {
+        Session& s = sessions[session];
+        if (priority == Priority::CANCEL) {
+            // Overtaking its own new order would cancel an order the venue does not know yet
+            bool found = false;
+            s.queues[static_cast<int>(Priority::NEW)].for_each([&](order_state::OrderRecord& queued) {
+                if (queued.id == order.id && !found) {
+                    queued.id = -1;
+                    found = true;
+                }
+            });
+            if (found) {
+                withdrawn++;
+                return SubmitResult::WITHDRAWN;
+            }
+        }
+        if (!s.queues[static_cast<int>(priority)].push(order))
+            return SubmitResult::FULL;
+        pending |= uint64_t(1) << session;
+        return SubmitResult::QUEUED;
+    }
+
+    // Sends every queued message that has tokens at now, the cancels of every session before
+    // any new order, so one session's new orders never spend a shared venue bucket ahead of
+    // another session's cancels: send(session, priority, order) is called in that order.
+    // Returns the number sent.
+    template <typename Send>
+    size_t dispatch(uint64_t now, Send&& send) {
+        size_t sent = 0;
+        for (uint64_t waiting = pending; waiting; waiting &= waiting - 1) {
+            Session& s = sessions[__builtin_ctzll(waiting)];
+            s.bucket.refill(now);
+            venues[s.venue].refill(now); // again for each of its sessions: no cycles have passed, a no-op
+        }
+        for (uint64_t waiting = pending; waiting; waiting &= waiting - 1)
+            sent += send_queued(__builtin_ctzll(waiting), Priority::CANCEL, send);
+        for (uint64_t waiting = pending; waiting; waiting &= waiting - 1) {
+            int index = __builtin_ctzll(waiting);
+            sent += send_queued(index, Priority::NEW, send);
+            OrderRing* queues = sessions[index].queues;
+            if (queues[static_cast<int>(Priority::CANCEL)].empty() && queues[static_cast<int>(Priority::NEW)].empty())
+                pending &= ~(uint64_t(1) << index);
+        }
+        return sent;
+    }
+
+    // Drops every queued message of priority, e.g. the new orders when trading halts; returns
+    // how many orders were dropped, withdrawn ones not counted again
+    size_t discard(Priority priority) {
+        size_t dropped = 0;
+        for (Session& s : sessions) {
+            OrderRing& ring = s.queues[static_cast<int>(priority)];
+            ring.for_each([&](order_state::OrderRecord& queued) { dropped += queued.id >= 0; });
+            ring.clear();
+        }
+        return dropped; // pending bits of emptied sessions clear on the next dispatch
+    }
+
+    bool idle() const { return pending == 0; }
+    size_t queued(int session, Priority priority) const {
+        return sessions[session].queues[static_cast<int>(priority)].size();
+    }
+    uint64_t withdrawn_orders() const { return withdrawn; }
+    const TokenBucket& session_bucket(int session) const { return sessions[session].bucket; }
+};
+
+} // namespace throttle
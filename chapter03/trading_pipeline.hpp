@@ -0,0 +1,172 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include "disruptor.hpp"
+#include "exploring_circular_array.hpp"
+#include "hub_messages.hpp"
+#include "latency_histogram.hpp"
+#include "latency_tracer.hpp"
+
+// feed -> book -> strategy -> risk -> EMS as dependent consumers of one disruptor ring.
+// The feed handler thread publishes market data events; every other stage has its own thread
+// and writes only its own fields of the event, so a slot is never copied between stages.
+// Only the book stage touches the book: it copies the top of book after the event into the
+// event, so the strategy sees the book as of its own event while the book moves on.
+namespace pipeline
+{
+    enum class StageId : int { FEED, BOOK, STRATEGY, RISK, EMS, STAGE_COUNT };
+
+    inline const char* stage_name(StageId stage) {
+        switch (stage) {
+            case StageId::FEED: return "feed";
+            case StageId::BOOK: return "book";
+            case StageId::STRATEGY: return "strategy";
+            case StageId::RISK: return "risk";
+            case StageId::EMS: return "ems";
+            default: return "unknown";
+        }
+    }
+
+    const int STAGE_COUNT = static_cast<int>(StageId::STAGE_COUNT);
+
+    struct alignas(64) MarketEvent {
+        // feed
+        circular_array::Order update;
+        bool is_bid;
+        wire::DepthAction action;
+        // book: top of book once the update is applied, zeroed for an empty side
+        circular_array::Order best_bid;
+        circular_array::Order best_offer;
+        // strategy
+        bool has_order;
+        circular_array::Order child_order;
+        bool child_is_bid;
+        // risk
+        bool risk_passed;
+        // rdtsc when each stage finished with the event
+        uint64_t stamps[STAGE_COUNT];
+    };
+
+    // Strategy: bool(const MarketEvent&, Order& child, bool& child_is_bid), true when it wants
+    //           to send child; the book it sees is event.best_bid and event.best_offer
+    // Risk:     bool(const Order& child, bool child_is_bid), true when the order may go out
+    // Execution: void(const Order& child, bool child_is_bid), hands the order to a venue
+    template <typename Strategy, typename Risk, typename Execution>
+    class TradingPipeline {
+    private:
+        struct BookStage {
+            circular_array::LimitOrderBook& book;
+            void on_event(MarketEvent& event, int64_t, bool) {
+                switch (event.action) {
+                    case wire::DepthAction::NEW: book.add_order(event.update, event.is_bid); break;
+                    case wire::DepthAction::CHANGE: book.update_order(event.update, event.is_bid); break;
+                    case wire::DepthAction::DELETE: book.delete_order(event.update, event.is_bid); break;
+                }
+                event.best_bid = event.best_offer = circular_array::Order();
+                book.get_depth(true, &event.best_bid, 1);
+                book.get_depth(false, &event.best_offer, 1);
+                event.stamps[static_cast<int>(StageId::BOOK)] = latency::rdtsc();
+            }
+        };
+        struct StrategyStage {
+            Strategy strategy;
+            void on_event(MarketEvent& event, int64_t, bool) {
+                event.has_order = strategy(event, event.child_order, event.child_is_bid);
+                event.stamps[static_cast<int>(StageId::STRATEGY)] = latency::rdtsc();
+            }
+        };
+        struct RiskStage {
+            Risk risk;
+            void on_event(MarketEvent& event, int64_t, bool) {
+                event.risk_passed = event.has_order && risk(event.child_order, event.child_is_bid);
+                event.stamps[static_cast<int>(StageId::RISK)] = latency::rdtsc();
+            }
+        };
+        // Last stage: also keeps the latency histograms, it is the only thread writing them
+        struct ExecutionStage {
+            Execution execution;
+            latency::Histogram per_stage[STAGE_COUNT];
+            latency::Histogram end_to_end;
+            void on_event(MarketEvent& event, int64_t, bool) {
+                if (event.risk_passed)
+                    execution(event.child_order, event.child_is_bid);
+                uint64_t* stamps = event.stamps;
+                stamps[static_cast<int>(StageId::EMS)] = latency::rdtsc();
+                const latency::TscClock& tsc = latency::TscClock::instance();
+                for (int stage = 1; stage < STAGE_COUNT; stage++)
+                    per_stage[stage].record(tsc.to_ns(stamps[stage] - stamps[stage - 1]));
+                end_to_end.record(tsc.to_ns(stamps[STAGE_COUNT - 1] - stamps[0]));
+            }
+        };
+
+        std::atomic<bool> running{true};
+        disruptor::RingBuffer<MarketEvent> ring;
+        BookStage book_stage;
+        StrategyStage strategy_stage;
+        RiskStage risk_stage;
+        ExecutionStage execution_stage;
+        disruptor::BatchEventProcessor<MarketEvent, BookStage> book_processor;
+        disruptor::BatchEventProcessor<MarketEvent, StrategyStage> strategy_processor;
+        disruptor::BatchEventProcessor<MarketEvent, RiskStage> risk_processor;
+        disruptor::BatchEventProcessor<MarketEvent, ExecutionStage> execution_processor;
+        std::thread threads[4];
+
+    public:
+        static const size_t DEFAULT_CAPACITY = 1 << 14;
+
+        TradingPipeline(circular_array::LimitOrderBook& book, Strategy strategy, Risk risk, Execution execution,
+                        wait::WaitStrategy waiter = wait::WaitStrategy(),
+                        size_t capacity = DEFAULT_CAPACITY)
+            : ring(capacity), book_stage{book}, strategy_stage{strategy}, risk_stage{risk},
+              execution_stage{execution, {}, {}},
+              book_processor(ring, {&ring.cursor()}, book_stage, running, waiter),
+              strategy_processor(ring, {&book_processor.sequence()}, strategy_stage, running, waiter),
+              risk_processor(ring, {&strategy_processor.sequence()}, risk_stage, running, waiter),
+              execution_processor(ring, {&risk_processor.sequence()}, execution_stage, running, waiter) {
+            ring.add_gating_sequence(execution_processor.sequence());
+        }
+        ~TradingPipeline() { stop(); }
+
+        void start() {
+            threads[0] = std::thread([this]() { book_processor.run(); });
+            threads[1] = std::thread([this]() { strategy_processor.run(); });
+            threads[2] = std::thread([this]() { risk_processor.run(); });
+            threads[3] = std::thread([this]() { execution_processor.run(); });
+        }
+
+        // Stages finish what is already available to them, then return. Wait for completed()
+        // to reach the last published sequence first to drain the whole pipeline.
+        void stop() {
+            running.store(false, std::memory_order_relaxed);
+            ring.signal().notify();
+            for (std::thread& t : threads)
+                if (t.joinable())
+                    t.join();
+        }
+
+        // Feed handler thread only: writes the update straight into the next slot
+        int64_t publish(const circular_array::Order& update, bool is_bid, wire::DepthAction action) {
+            int64_t sequence = ring.next();
+            MarketEvent& event = ring[sequence];
+            event.update = update;
+            event.is_bid = is_bid;
+            event.action = action;
+            event.has_order = false;
+            event.risk_passed = false;
+            event.stamps[static_cast<int>(StageId::FEED)] = latency::rdtsc();
+            ring.publish(sequence);
+            return sequence;
+        }
+
+        // Sequence the last stage has finished, for callers that wait for the pipeline to drain
+        int64_t completed() const { return execution_processor.sequence().get(); }
+
+        // Read after stop(): time each stage took since the previous one finished, in ns
+        const latency::Histogram& stage_latency(StageId stage) const {
+            return execution_stage.per_stage[static_cast<int>(stage)];
+        }
+        const latency::Histogram& end_to_end_latency() const { return execution_stage.end_to_end; }
+    };
+
+} // namespace pipeline
@@ -0,0 +1,212 @@
+#pragma once
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+
+namespace multicast
+{
+
+struct ReceiverConfig {
+    std::string group;                      // e.g. "239.1.1.1"
+    uint16_t port = 0;
+    std::string interface_addr = "0.0.0.0"; // local interface to join on ("127.0.0.1" for loopback)
+    int batch_size = 64;                    // datagrams per recvmmsg call
+    int ring_batches = 4;                   // batches kept before a buffer is reused
+    size_t max_datagram = 2048;
+    int busy_poll_us = 0;                   // SO_BUSY_POLL budget, 0 = off
+    bool timestamping = false;              // SO_TIMESTAMPING, hardware when the NIC supports it
+    int receive_buffer = 0;                 // SO_RCVBUF, 0 = kernel default
+};
+
+// Zero-copy view handed to the decoder. It points into the receiver ring and stays valid
+// for ring_batches - 1 further poll() calls.
+struct DatagramView {
+    const char* data;
+    uint32_t length;
+    uint64_t rx_timestamp_ns; // 0 when timestamping is off or not reported
+    bool hardware_timestamp;
+};
+
+class UdpMulticastReceiver {
+private:
+    static const size_t CONTROL_SIZE = 256;
+
+    int fd = -1;
+    ReceiverConfig config;
+    std::vector<char> buffers;
+    std::vector<char> control;
+    std::vector<iovec> iovecs;
+    std::vector<mmsghdr> headers;
+    int next_batch = 0;
+    uint64_t received = 0;
+    uint64_t truncated = 0;
+
+    [[noreturn]] void fail(const char* what) {
+        int err = errno;
+        if (fd >= 0)
+            ::close(fd);
+        throw std::system_error(err, std::generic_category(), what);
+    }
+
+    static void read_timestamp(msghdr& hdr, DatagramView& view) {
+        for (cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+            if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPING)
+                continue;
+            scm_timestamping ts;
+            std::memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            // ts[2] is the raw hardware stamp, ts[0] the software one
+            if (ts.ts[2].tv_sec || ts.ts[2].tv_nsec) {
+                view.rx_timestamp_ns = ts.ts[2].tv_sec * 1000000000ULL + ts.ts[2].tv_nsec;
+                view.hardware_timestamp = true;
+            } else {
+                view.rx_timestamp_ns = ts.ts[0].tv_sec * 1000000000ULL + ts.ts[0].tv_nsec;
+            }
+        }
+    }
+
+public:
+    explicit UdpMulticastReceiver(const ReceiverConfig& cfg) : config(cfg) {
+        const size_t slots = static_cast<size_t>(config.batch_size) * config.ring_batches;
+        buffers.resize(slots * config.max_datagram);
+        control.resize(slots * CONTROL_SIZE);
+        iovecs.resize(slots);
+        headers.resize(slots);
+        for (size_t i = 0; i < slots; i++) {
+            iovecs[i].iov_base = &buffers[i * config.max_datagram];
+            iovecs[i].iov_len = config.max_datagram;
+            std::memset(&headers[i], 0, sizeof(mmsghdr));
+            headers[i].msg_hdr.msg_iov = &iovecs[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0)
+            fail("socket");
+        int one = 1;
+        if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0)
+            fail("SO_REUSEADDR");
+        if (config.receive_buffer > 0 &&
+            setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &config.receive_buffer, sizeof(config.receive_buffer)) < 0)
+            fail("SO_RCVBUF");
+        if (config.busy_poll_us > 0 &&
+            setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &config.busy_poll_us, sizeof(config.busy_poll_us)) < 0)
+            fail("SO_BUSY_POLL");
+        if (config.timestamping) {
+            int flags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE |
+                        SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+            if (setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0)
+                fail("SO_TIMESTAMPING");
+        }
+
+        // Binding to the group address keeps other groups on the same port out of this socket
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(config.port);
+        if (inet_pton(AF_INET, config.group.c_str(), &addr.sin_addr) != 1) {
+            errno = EINVAL;
+            fail("multicast group");
+        }
+        if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+            fail("bind");
+
+        ip_mreq mreq{};
+        mreq.imr_multiaddr = addr.sin_addr;
+        if (inet_pton(AF_INET, config.interface_addr.c_str(), &mreq.imr_interface) != 1) {
+            errno = EINVAL;
+            fail("interface address");
+        }
+        if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0)
+            fail("IP_ADD_MEMBERSHIP");
+    }
+
+    ~UdpMulticastReceiver() {
+        if (fd >= 0)
+            ::close(fd);
+    }
+    UdpMulticastReceiver(const UdpMulticastReceiver&) = delete;
+    UdpMulticastReceiver& operator=(const UdpMulticastReceiver&) = delete;
+
+    // Pulls up to batch_size datagrams with a single non-blocking recvmmsg and calls
+    // on_datagram(const DatagramView&) for each. A datagram longer than max_datagram arrives
+    // cut short: it is counted and dropped rather than decoded. Returns how many were read off
+    // the socket (0 if none), dropped ones included.
+    template <typename Handler>
+    int poll(Handler&& on_datagram) {
+        const size_t first = static_cast<size_t>(next_batch) * config.batch_size;
+        for (size_t i = first; i < first + config.batch_size; i++) {
+            msghdr& hdr = headers[i].msg_hdr;
+            hdr.msg_control = config.timestamping ? &control[i * CONTROL_SIZE] : nullptr;
+            hdr.msg_controllen = config.timestamping ? CONTROL_SIZE : 0;
+            hdr.msg_flags = 0;
+        }
+        int n = recvmmsg(fd, &headers[first], config.batch_size, MSG_DONTWAIT, nullptr);
+        if (n <= 0) {
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                throw std::system_error(errno, std::generic_category(), "recvmmsg");
+            return 0;
+        }
+        for (int i = 0; i < n; i++) {
+            mmsghdr& msg = headers[first + i];
+            if (msg.msg_hdr.msg_flags & MSG_TRUNC) {
+                truncated++;
+                continue;
+            }
+            DatagramView view{static_cast<const char*>(iovecs[first + i].iov_base), msg.msg_len, 0, false};
+            if (config.timestamping)
+                read_timestamp(msg.msg_hdr, view);
+            on_datagram(view);
+        }
+        next_batch = (next_batch + 1) % config.ring_batches;
+        received += n;
+        return n;
+    }
+
+    // Every datagram read, truncated ones included
+    uint64_t datagrams_received() const { return received; }
+    // Longer than max_datagram, dropped; a non-zero count means max_datagram is too small
+    uint64_t datagrams_truncated() const { return truncated; }
+    int native_handle() const { return fd; }
+};
+
+// Minimal publisher, used to drive the receiver over loopback in tests and benchmarks
+class UdpMulticastSender {
+private:
+    int fd;
+    sockaddr_in destination{};
+
+public:
+    UdpMulticastSender(const std::string& group, uint16_t port, const std::string& interface_addr = "127.0.0.1") {
+        fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "socket");
+        destination.sin_family = AF_INET;
+        destination.sin_port = htons(port);
+        inet_pton(AF_INET, group.c_str(), &destination.sin_addr);
+        in_addr iface{};
+        inet_pton(AF_INET, interface_addr.c_str(), &iface);
+        unsigned char loop = 1;
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface));
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    }
+    ~UdpMulticastSender() { ::close(fd); }
+    UdpMulticastSender(const UdpMulticastSender&) = delete;
+    UdpMulticastSender& operator=(const UdpMulticastSender&) = delete;
+
+    bool send(const void* data, size_t length) {
+        return ::sendto(fd, data, length, 0, reinterpret_cast<const sockaddr*>(&destination),
+                        sizeof(destination)) == static_cast<ssize_t>(length);
+    }
+};
+
+} // namespace multicast
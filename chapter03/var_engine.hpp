@@ -0,0 +1,214 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+// Value at Risk and Expected Shortfall by full revaluation over scenarios of per-symbol returns:
+// historical (returns observed on past days) or Monte Carlo (a one-factor model drawn from a
+// counter-based generator). A scenario's PnL is the sum of exposure x return over the symbols
+// held, so the portfolio is revalued one symbol column at a time into a block of scenarios,
+// blocks spread over the TBB workers. The per-scenario PnL is kept: the risk of a candidate
+// order is that vector plus the order's own column, no revaluation of the rest.
+namespace var
+{
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3"): the output is a
+// function of (counter, key) only, so a draw does not depend on which thread made it or when
+struct Philox4x32 {
+    uint32_t v[4];
+
+    static Philox4x32 generate(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, uint64_t key) {
+        uint32_t k0 = static_cast<uint32_t>(key), k1 = static_cast<uint32_t>(key >> 32);
+        for (int round = 0; round < 10; round++) {
+            uint64_t p0 = uint64_t(0xD2511F53) * c0;
+            uint64_t p1 = uint64_t(0xCD9E8D57) * c2;
+            uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+            uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+            c0 = n0;
+            c1 = static_cast<uint32_t>(p1);
+            c2 = n2;
+            c3 = static_cast<uint32_t>(p0);
+            k0 += 0x9E3779B9;
+            k1 += 0xBB67AE85;
+        }
+        return Philox4x32{{c0, c1, c2, c3}};
+    }
+};
+
+// Two independent standard normals for (stream, index, key), by Box-Muller
+inline void normal_pair(uint32_t stream, uint64_t index, uint64_t key, double& z0, double& z1) {
+    Philox4x32 bits = Philox4x32::generate(static_cast<uint32_t>(index), static_cast<uint32_t>(index >> 32), stream,
+                                           0, key);
+    const double SCALE = 1.0 / 9007199254740992.0; // 2^-53
+    double u0 = ((((uint64_t(bits.v[0]) << 32) | bits.v[1]) >> 11) + 0.5) * SCALE; // (0, 1)
+    double u1 = (((uint64_t(bits.v[2]) << 32) | bits.v[3]) >> 11) * SCALE;
+    double radius = std::sqrt(-2.0 * std::log(u0));
+    double angle = 6.283185307179586 * u1;
+    z0 = radius * std::cos(angle);
+    z1 = radius * std::sin(angle);
+}
+
+// Scenario returns, one column of scenarios per symbol. Sources are read from several threads.
+class Scenarios {
+public:
+    virtual ~Scenarios() {}
+    virtual size_t symbols() const = 0;
+    virtual size_t scenarios() const = 0;
+    // Returns of symbol in scenarios [first, first + count): a pointer into the source, or
+    // scratch (count entries) filled in
+    virtual const double* returns(uint32_t symbol, size_t first, size_t count, double* scratch) const = 0;
+};
+
+// Observed returns, column per symbol: returns[symbol * scenarios + day]
+class HistoricalScenarios : public Scenarios {
+private:
+    size_t symbol_count;
+    size_t scenario_count;
+    std::vector<double> history;
+
+public:
+    HistoricalScenarios(size_t symbols, size_t days, std::vector<double> returns)
+        : symbol_count(symbols), scenario_count(days), history(std::move(returns)) {
+        if (history.size() != symbols * days)
+            throw std::invalid_argument("historical returns must be symbols x days");
+    }
+    size_t symbols() const override { return symbol_count; }
+    size_t scenarios() const override { return scenario_count; }
+    const double* returns(uint32_t symbol, size_t first, size_t, double*) const override {
+        return history.data() + symbol * scenario_count + first;
+    }
+};
+
+// return = beta x market + volatility x own shock, all standard normal. The market factor is
+// drawn once per scenario; own shocks are drawn on demand from (symbol, scenario, seed), so
+// nothing of size symbols x scenarios is stored.
+class MonteCarloScenarios : public Scenarios {
+private:
+    size_t scenario_count;
+    std::vector<double> beta;
+    std::vector<double> volatility;
+    std::vector<double> market;
+    uint64_t seed;
+
+public:
+    MonteCarloScenarios(std::vector<double> betas, std::vector<double> volatilities, size_t scenarios,
+                        uint64_t seed)
+        : scenario_count(scenarios), beta(std::move(betas)), volatility(std::move(volatilities)),
+          market(scenarios + 1), seed(seed) {
+        if (beta.size() != volatility.size())
+            throw std::invalid_argument("one beta and one volatility per symbol");
+        const uint32_t MARKET_STREAM = UINT32_MAX;
+        for (size_t s = 0; s < scenarios; s += 2)
+            normal_pair(MARKET_STREAM, s / 2, seed, market[s], market[s + 1]);
+    }
+    size_t symbols() const override { return beta.size(); }
+    size_t scenarios() const override { return scenario_count; }
+    const double* returns(uint32_t symbol, size_t first, size_t count, double* scratch) const override {
+        const double b = beta[symbol], sigma = volatility[symbol];
+        size_t s = first & ~size_t(1); // draws come in pairs: start on the pair holding first
+        for (; s < first + count; s += 2) {
+            double z0, z1;
+            normal_pair(symbol, s / 2, seed, z0, z1);
+            if (s >= first)
+                scratch[s - first] = b * market[s] + sigma * z0;
+            if (s + 1 < first + count)
+                scratch[s + 1 - first] = b * market[s + 1] + sigma * z1;
+        }
+        return scratch;
+    }
+};
+
+struct RiskEstimate {
+    double value_at_risk;      // loss not exceeded with the engine's confidence, positive
+    double expected_shortfall; // average loss in the scenarios at or beyond it
+};
+
+// Revaluation and what-if from one thread at a time; the revaluation itself runs on the TBB
+// workers
+class VarEngine {
+private:
+    static constexpr size_t BLOCK = 512; // scenarios per task, the returns of a block stay in L1
+
+    const Scenarios& scenarios;
+    double confidence;
+    std::vector<double> pnl;       // per scenario, of the last revalued portfolio
+    std::vector<double> tail;      // scratch for the quantile of a revaluation
+    std::vector<double> trial;     // and of a what-if, which leaves the revaluation's alone
+    std::vector<uint32_t> held;    // symbols with exposure
+    std::vector<double> exposure;  // of those symbols
+    std::vector<double> scratch;
+
+    // Sorts the worst tail of values to the front: VaR is the loss at its last scenario
+    RiskEstimate estimate(std::vector<double>& values) const {
+        const size_t n = values.size();
+        // The scenarios strictly beyond VaR; the epsilon keeps 0.2 x 10 from rounding down to 1
+        size_t k = static_cast<size_t>((1.0 - confidence) * n + 1e-9);
+        k = std::min(k, n - 1);
+        std::nth_element(values.begin(), values.begin() + k, values.end());
+        double sum = 0.0;
+        for (size_t i = 0; i <= k; i++)
+            sum += values[i];
+        return RiskEstimate{-values[k], -sum / (k + 1)};
+    }
+
+public:
+    VarEngine(const Scenarios& source, double confidence = 0.99)
+        : scenarios(source), confidence(confidence), pnl(source.scenarios(), 0.0), tail(source.scenarios()),
+          trial(source.scenarios()), scratch(source.scenarios()) {
+        if (source.scenarios() == 0 || confidence <= 0.0 || confidence >= 1.0)
+            throw std::invalid_argument("VaR needs scenarios and a confidence in (0, 1)");
+        held.reserve(source.symbols());
+        exposure.reserve(source.symbols());
+    }
+
+    // Revalues quantity x mark of every symbol (the PositionBook columns) in every scenario
+    RiskEstimate revalue(const double* quantities, const double* marks) {
+        held.clear();
+        exposure.clear();
+        for (uint32_t symbol = 0; symbol < scenarios.symbols(); symbol++) {
+            if (quantities[symbol] != 0.0 && marks[symbol] > 0.0) {
+                held.push_back(symbol);
+                exposure.push_back(quantities[symbol] * marks[symbol]);
+            }
+        }
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, pnl.size(), BLOCK), [&](const tbb::blocked_range<size_t>& range) {
+            double block_scratch[BLOCK];
+            const size_t first = range.begin(), count = range.size();
+            for (size_t begin = first; begin < first + count; begin += BLOCK) {
+                const size_t n = std::min(BLOCK, first + count - begin);
+                double* __restrict out = pnl.data() + begin;
+                std::fill(out, out + n, 0.0);
+                for (size_t h = 0; h < held.size(); h++) {
+                    const double* __restrict r = scenarios.returns(held[h], begin, n, block_scratch);
+                    const double e = exposure[h];
+                    for (size_t s = 0; s < n; s++)
+                        out[s] += e * r[s];
+                }
+            }
+        });
+        tail = pnl;
+        return estimate(tail);
+    }
+
+    // Risk of the last revalued portfolio plus quantity (negative to sell) of symbol at price,
+    // from the cached scenario PnL: one column of returns instead of a full revaluation
+    RiskEstimate what_if(uint32_t symbol, double quantity, double price) {
+        if (symbol >= scenarios.symbols())
+            throw std::out_of_range("symbol outside the scenario set");
+        const size_t n = pnl.size();
+        const double* r = scenarios.returns(symbol, 0, n, scratch.data());
+        const double e = quantity * price;
+        for (size_t s = 0; s < n; s++)
+            trial[s] = pnl[s] + e * r[s];
+        return estimate(trial);
+    }
+
+    // Per scenario, of the last revalued portfolio
+    const std::vector<double>& scenario_pnl() const { return pnl; }
+};
+
+} // namespace var
@@ -0,0 +1,138 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include "order_state.hpp"
+
+// Splits a parent order across venues. Every venue is one column of a flat table (top of book,
+// fee per unit, and the execution quality stats chapter04/SOR.cpp keeps in VenueMetrics); a
+// route is a branch-light scoring pass over it, then repeated min-selections over one packed key
+// per venue, handing out the size each venue is expected to fill until the order is placed.
+// Nothing is allocated: child orders go into a buffer of MAX_VENUES the caller owns.
+namespace routing
+{
+
+const int MAX_VENUES = 64;
+
+struct ChildOrder {
+    int32_t venue;
+    int32_t quantity;
+    double price; // the parent's limit: the child takes what it can and rests the rest
+};
+
+// Child order ids stay unique per parent and venue while parent ids are below 2^57
+inline int64_t child_order_id(int64_t parent_id, int32_t venue) { return parent_id * MAX_VENUES + venue; }
+
+// Venue updates and routes must come from the same thread, or be synchronized by the caller
+class VenueRouter {
+private:
+    static const uint64_t NOT_MARKETABLE = UINT64_MAX;
+
+    // Maps a double to an unsigned integer with the same ordering
+    static uint64_t sortable_bits(double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits ^ ((bits >> 63) ? ~uint64_t(0) : uint64_t(1) << 63);
+    }
+
+    int venue_count = 0;
+    // top of book
+    alignas(64) double bid_price[MAX_VENUES];
+    alignas(64) double bid_size[MAX_VENUES];
+    alignas(64) double ask_price[MAX_VENUES];
+    alignas(64) double ask_size[MAX_VENUES];
+    // cost and quality
+    alignas(64) double fee[MAX_VENUES];         // per unit, negative for a rebate
+    alignas(64) double slippage_rate[MAX_VENUES];
+    alignas(64) double fill_rate[MAX_VENUES];   // historical share of displayed size we get
+    alignas(64) double rejection_rate[MAX_VENUES];
+
+public:
+    // Returns the venue index, used by update_* and in ChildOrder::venue
+    int add_venue(double fee_per_unit, double historical_fill_rate = 1.0, double slippage = 0.0,
+                  double rejection = 0.0) {
+        if (venue_count == MAX_VENUES)
+            throw std::length_error("venue table is full");
+        int venue = venue_count++;
+        bid_price[venue] = ask_price[venue] = 0.0;
+        bid_size[venue] = ask_size[venue] = 0.0;
+        fee[venue] = fee_per_unit;
+        update_statistics(venue, historical_fill_rate, slippage, rejection);
+        return venue;
+    }
+
+    void update_quote(int venue, double bid, double bid_quantity, double ask, double ask_quantity) {
+        bid_price[venue] = bid;
+        bid_size[venue] = bid_quantity;
+        ask_price[venue] = ask;
+        ask_size[venue] = ask_quantity;
+    }
+
+    void update_statistics(int venue, double historical_fill_rate, double slippage, double rejection) {
+        fill_rate[venue] = historical_fill_rate;
+        slippage_rate[venue] = slippage;
+        rejection_rate[venue] = rejection;
+    }
+
+    int venues() const { return venue_count; }
+
+    // Writes at most venues() child orders to children and returns how many. Venues are taken
+    // cheapest first (price + fee + expected slippage), each for the part of its displayed size
+    // inside the limit it is expected to fill; what no venue is expected to fill rests at the
+    // cheapest venue with liquidity. With no liquidity anywhere nothing is routed.
+    size_t route(const order_state::OrderRecord& parent, ChildOrder* children) const {
+        const int n = venue_count;
+        if (n == 0 || parent.quantity <= 0)
+            return 0;
+        // Buys take offers and want the lowest cost, sells hit bids and want the highest
+        // proceeds: with sign = -1 for sells both become "lowest cost first"
+        const double* price = parent.is_bid ? ask_price : bid_price;
+        const double* size = parent.is_bid ? ask_size : bid_size;
+        const double sign = parent.is_bid ? 1.0 : -1.0;
+        const double limit = sign * parent.price;
+
+        // One sortable key per marketable venue: the cost's order-preserving bits with the venue
+        // index in the low 6 bits, so ties go to the lower index and a min is a single compare
+        uint64_t keys[MAX_VENUES];
+        double fillable[MAX_VENUES];
+        uint64_t resting_key = NOT_MARKETABLE; // cheapest venue with liquidity, for the remainder
+        for (int i = 0; i < n; i++) {
+            double signed_price = sign * price[i];
+            uint64_t key = (sortable_bits(signed_price + fee[i] + slippage_rate[i] * price[i]) & ~uint64_t(63)) | i;
+            bool has_liquidity = size[i] > 0.0;
+            bool marketable = has_liquidity & (signed_price <= limit);
+            keys[i] = marketable ? key : NOT_MARKETABLE;
+            resting_key = has_liquidity & (key < resting_key) ? key : resting_key;
+            fillable[i] = std::floor(size[i] * fill_rate[i] * (1.0 - rejection_rate[i]));
+        }
+
+        // Partial selection: a parent order usually needs a few venues, not a full sort
+        double remaining = parent.quantity;
+        size_t count = 0;
+        while (remaining > 0.0) {
+            int best = 0;
+            for (int i = 1; i < n; i++)
+                best = keys[i] < keys[best] ? i : best;
+            if (keys[best] == NOT_MARKETABLE)
+                break;
+            keys[best] = NOT_MARKETABLE;
+            double quantity = std::fmin(remaining, fillable[best]);
+            children[count] = ChildOrder{best, static_cast<int32_t>(quantity), parent.price};
+            count += quantity > 0.0;
+            remaining -= quantity;
+        }
+        if (remaining > 0.0 && resting_key != NOT_MARKETABLE) {
+            int venue = static_cast<int>(resting_key & 63);
+            size_t child = 0;
+            while (child < count && children[child].venue != venue)
+                child++;
+            if (child == count)
+                children[count++] = ChildOrder{venue, 0, parent.price};
+            children[child].quantity += static_cast<int32_t>(remaining);
+        }
+        return count;
+    }
+};
+
+} // namespace routing
@@ -0,0 +1,130 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <thread>
+#include <sched.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace wait
+{
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// Event counter a producer bumps after publishing work. Consumers that ran out of spins
+// sleep on it with a futex; notify() only enters the kernel when somebody is asleep.
+class WakeSignal {
+private:
+    alignas(64) std::atomic<uint32_t> epoch{0};
+    alignas(64) std::atomic<uint32_t> sleepers{0};
+
+public:
+    uint32_t current() const { return epoch.load(std::memory_order_acquire); }
+
+    void notify() {
+        epoch.fetch_add(1, std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_seq_cst) != 0)
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+    }
+
+    // Sleeps while the epoch is still `seen`, at most timeout_ns
+    void park(uint32_t seen, long timeout_ns) {
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        if (epoch.load(std::memory_order_seq_cst) == seen) {
+            timespec timeout{timeout_ns / 1000000000L, timeout_ns % 1000000000L};
+            syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch), FUTEX_WAIT_PRIVATE, seen, &timeout, nullptr, 0);
+        }
+        sleepers.fetch_sub(1, std::memory_order_seq_cst);
+    }
+};
+
+enum class Mode {
+    BUSY_SPIN,  // lowest latency, burns the core
+    PAUSE_SPIN, // same, but _mm_pause eases the sibling hyperthread and power
+    SPIN_YIELD, // spin for a while, then give the core away with sched_yield
+    SPIN_PARK   // spin for a while, then sleep on the WakeSignal futex
+};
+
+inline const char* mode_name(Mode mode) {
+    switch (mode) {
+        case Mode::BUSY_SPIN: return "busy_spin";
+        case Mode::PAUSE_SPIN: return "pause_spin";
+        case Mode::SPIN_YIELD: return "spin_yield";
+        case Mode::SPIN_PARK: return "spin_park";
+        default: return "unknown";
+    }
+}
+
+// Idle policy shared by every consumer loop. Pick the mode per loop: latency-critical
+// symbols busy spin, the rest can park and give the CPU back.
+class WaitStrategy {
+private:
+    Mode mode;
+    uint32_t spin_limit;
+    long park_timeout_ns;
+
+public:
+    explicit WaitStrategy(Mode mode = Mode::BUSY_SPIN, uint32_t spin_limit = 10000, long park_timeout_ns = 1000000)
+        : mode(mode), spin_limit(spin_limit), park_timeout_ns(park_timeout_ns) {}
+
+    Mode get_mode() const { return mode; }
+
+    // One idle step of a loop that found no work for `iteration` consecutive rounds.
+    // `seen` must be read from the signal before the loop checked for work.
+    void idle(uint32_t iteration, WakeSignal* signal = nullptr, uint32_t seen = 0) const {
+        switch (mode) {
+            case Mode::BUSY_SPIN:
+                break;
+            case Mode::PAUSE_SPIN:
+                cpu_relax();
+                break;
+            case Mode::SPIN_YIELD:
+                if (iteration < spin_limit)
+                    cpu_relax();
+                else
+                    sched_yield();
+                break;
+            case Mode::SPIN_PARK:
+                if (iteration < spin_limit)
+                    cpu_relax();
+                else if (signal)
+                    signal->park(seen, park_timeout_ns);
+                else
+                    std::this_thread::sleep_for(std::chrono::nanoseconds(park_timeout_ns)); // nobody can wake us
+                break;
+        }
+    }
+
+    // Returns once ready() is true
+    template <typename Ready>
+    void wait_until(Ready&& ready, WakeSignal* signal = nullptr) const {
+        for (uint32_t i = 0;; i++) {
+            uint32_t seen = signal ? signal->current() : 0;
+            if (ready())
+                return;
+            idle(i, signal, seen);
+        }
+    }
+
+    // Returns the new epoch once the signal moved past `seen`
+    uint32_t wait_for(WakeSignal& signal, uint32_t seen) const {
+        uint32_t now;
+        for (uint32_t i = 0; (now = signal.current()) == seen; i++)
+            idle(i, &signal, seen);
+        return now;
+    }
+};
+
+} // namespace wait